@@ -0,0 +1,13 @@
+rem Project2.vcxproj compiles the shaders as part of the build, this rebuilds them without it
+%VULKAN_SDK%\Bin\glslc.exe shader.vert -o vert.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.vert -DVERTEX_COLOR -o vert_color.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.vert -DVERTEX_UV -o vert_uv.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.vert -DVERTEX_COLOR -DVERTEX_UV -o vert_color_uv.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.frag -o frag.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.frag -DVERTEX_COLOR -o frag_color.spv
+%VULKAN_SDK%\Bin\glslc.exe indirect.vert -o indirect_vert.spv
+%VULKAN_SDK%\Bin\glslc.exe indirect.frag -o indirect_frag.spv
+%VULKAN_SDK%\Bin\glslc.exe cull.comp -o cull_comp.spv
+%VULKAN_SDK%\Bin\glslc.exe field.comp -o field_comp.spv
+%VULKAN_SDK%\Bin\glslc.exe heatmap.vert -o heatmap_vert.spv
+%VULKAN_SDK%\Bin\glslc.exe heatmap.frag -o heatmap_frag.spv
@@ -0,0 +1,182 @@
+#include "field_compute_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <stdexcept>
+
+namespace vefp {
+
+	struct FieldPushConstantData {
+		float strengthGravity;
+		uint32_t bodyCount;
+		uint32_t objectCount;
+	};
+
+	static constexpr uint32_t FIELD_WORKGROUP_SIZE = 64;
+
+	FieldComputeSystem::FieldComputeSystem(VefpDevice& device, uint32_t framesInFlight, uint32_t maxBodyCount)
+		: vefpDevice{ device }, maxBodies{ maxBodyCount }, frames{ framesInFlight } {
+		createDescriptorSetLayout();
+		createPipelineLayout();
+		fieldPipeline = std::make_unique<VefpComputePipeline>(vefpDevice, "field_comp.spv", pipelineLayout);
+		createFrameResources();
+	}
+
+	FieldComputeSystem::~FieldComputeSystem() {
+		for (auto& frame : frames) {
+			vkUnmapMemory(vefpDevice.device(), frame.bodyBufferMemory);
+			vkDestroyBuffer(vefpDevice.device(), frame.bodyBuffer, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.bodyBufferMemory, nullptr);
+		}
+
+		vkDestroyDescriptorPool(vefpDevice.device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(vefpDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(vefpDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void FieldComputeSystem::createDescriptorSetLayout() {
+		// 0: bodies, 1: objects
+		std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(vefpDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+	}
+
+	void FieldComputeSystem::createPipelineLayout() {
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(FieldPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(vefpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void FieldComputeSystem::createFrameResources() {
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = 2 * frames.size();
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = frames.size();
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(vefpDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		for (auto& frame : frames) {
+			vefpDevice.createBuffer(
+				sizeof(glm::vec4) * maxBodies,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				frame.bodyBuffer,
+				frame.bodyBufferMemory);
+			vkMapMemory(vefpDevice.device(), frame.bodyBufferMemory, 0, VK_WHOLE_SIZE, 0, &frame.mappedBodies);
+
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &descriptorSetLayout;
+			if (vkAllocateDescriptorSets(vefpDevice.device(), &allocInfo, &frame.descriptorSet) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+
+			VkDescriptorBufferInfo bufferInfo{ frame.bodyBuffer, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = frame.descriptorSet;
+			write.dstBinding = 0;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.pBufferInfo = &bufferInfo;
+			vkUpdateDescriptorSets(vefpDevice.device(), 1, &write, 0, nullptr);
+		}
+	}
+
+	void FieldComputeSystem::updateField(
+		VkCommandBuffer commandBuffer,
+		int frameIndex,
+		const GravityPhysicsSystem& physicsSystem,
+		VefpWorld& world,
+		VkBuffer objectBuffer,
+		uint32_t objectCount) {
+		auto bodyQuery = world.query<Transform2dComponent, RigidBody2dComponent>();
+		const uint32_t bodyCount = bodyQuery.count();
+		if (bodyCount > maxBodies) {
+			throw std::runtime_error("too many bodies for field compute system!");
+		}
+		auto& frame = frames[frameIndex];
+		if (objectCount == 0) {
+			return;
+		}
+
+		auto* bodies = static_cast<glm::vec4*>(frame.mappedBodies);
+		bodyQuery.each([&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody) {
+			*bodies++ = glm::vec4(transform.translation, rigidBody.mass, 0.f);
+		});
+
+		// the frame slot is idle while it is recorded, so its set can be pointed at a new buffer
+		if (frame.boundObjectBuffer != objectBuffer) {
+			VkDescriptorBufferInfo bufferInfo{ objectBuffer, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = frame.descriptorSet;
+			write.dstBinding = 1;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.pBufferInfo = &bufferInfo;
+			vkUpdateDescriptorSets(vefpDevice.device(), 1, &write, 0, nullptr);
+			frame.boundObjectBuffer = objectBuffer;
+		}
+
+		fieldPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			pipelineLayout,
+			0,
+			1,
+			&frame.descriptorSet,
+			0,
+			nullptr);
+
+		FieldPushConstantData push{};
+		push.strengthGravity = physicsSystem.strengthGravity;
+		push.bodyCount = bodyCount;
+		push.objectCount = objectCount;
+		vkCmdPushConstants(
+			commandBuffer,
+			pipelineLayout,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0,
+			sizeof(FieldPushConstantData),
+			&push);
+
+		vkCmdDispatch(commandBuffer, (objectCount + FIELD_WORKGROUP_SIZE - 1) / FIELD_WORKGROUP_SIZE, 1, 1);
+	}
+
+}
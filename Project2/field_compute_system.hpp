@@ -0,0 +1,60 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_pipeline.hpp"
+#include "vefp_components.hpp"
+#include "vefp_frame_ring.hpp"
+#include "physics_and_field.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace vefp {
+
+	// GPU version of Vec2FieldSystem. Orients and scales the objects in an IndirectRenderSystem object
+	// buffer along the gravity field of the physics bodies. Recorded into a VefpAsyncCompute command
+	// buffer it runs on the async compute queue next to the previous frame's rendering.
+	class FieldComputeSystem {
+	private:
+		struct FrameResources {
+			VkBuffer bodyBuffer;
+			VkDeviceMemory bodyBufferMemory;
+			void* mappedBodies = nullptr;
+			VkDescriptorSet descriptorSet;
+			VkBuffer boundObjectBuffer = VK_NULL_HANDLE;
+		};
+
+		void createDescriptorSetLayout();
+		void createPipelineLayout();
+		void createFrameResources();
+
+		VefpDevice& vefpDevice;
+		const uint32_t maxBodies;
+
+		std::unique_ptr<VefpComputePipeline> fieldPipeline;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipelineLayout pipelineLayout;
+
+		VefpFrameRing<FrameResources> frames;
+
+	public:
+
+		FieldComputeSystem(VefpDevice& device, uint32_t framesInFlight, uint32_t maxBodies);
+		~FieldComputeSystem();
+
+		FieldComputeSystem(const FieldComputeSystem&) = delete;
+		FieldComputeSystem& operator=(const FieldComputeSystem&) = delete;
+
+		// Bodies are the world's entities with a RigidBody2dComponent. objectBuffer has to be created
+		// with sharedWithCompute when recorded for the async queue
+		void updateField(
+			VkCommandBuffer commandBuffer,
+			int frameIndex,
+			const GravityPhysicsSystem& physicsSystem,
+			VefpWorld& world,
+			VkBuffer objectBuffer,
+			uint32_t objectCount);
+	};
+
+}
@@ -0,0 +1,173 @@
+#include "field_heatmap_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <stdexcept>
+
+namespace vefp {
+
+	struct HeatmapPushConstantData {
+		glm::vec2 viewCenter;
+		glm::vec2 viewHalfExtent;
+		float strengthGravity;
+		uint32_t bodyCount;
+	};
+
+	FieldHeatmapSystem::FieldHeatmapSystem(
+		VefpDevice& device,
+		VkRenderPass renderPass,
+		VefpFrameRing<VefpTransientBuffer>& transientBuffers,
+		uint32_t maxBodyCount)
+		: vefpDevice{ device }, transientBuffers{ transientBuffers }, maxBodies{ maxBodyCount }, frames{ transientBuffers.size() } {
+		createDescriptorSetLayout();
+		createPipelineLayout();
+		createPipeline(renderPass);
+		createFrameResources();
+	}
+
+	FieldHeatmapSystem::~FieldHeatmapSystem() {
+		vkDestroyDescriptorPool(vefpDevice.device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(vefpDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(vefpDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void FieldHeatmapSystem::createDescriptorSetLayout() {
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(vefpDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+	}
+
+	void FieldHeatmapSystem::createPipelineLayout() {
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(HeatmapPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(vefpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void FieldHeatmapSystem::createPipeline(VkRenderPass renderPass) {
+		PipelineConfigInfo pipelineConfig{};
+		VefpPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		// the full screen triangle is generated from the vertex index
+		pipelineConfig.bindingDescriptions.clear();
+		pipelineConfig.attributeDescriptions.clear();
+		pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+		pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = pipelineLayout;
+		heatmapPipeline = std::make_unique<VefpPipeline>(
+			vefpDevice,
+			"heatmap_vert.spv",
+			"heatmap_frag.spv",
+			pipelineConfig);
+	}
+
+	void FieldHeatmapSystem::createFrameResources() {
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		poolSize.descriptorCount = frames.size();
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = frames.size();
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(vefpDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		for (uint32_t i = 0; i < frames.size(); i++) {
+			auto& frame = frames[i];
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &descriptorSetLayout;
+			if (vkAllocateDescriptorSets(vefpDevice.device(), &allocInfo, &frame.descriptorSet) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+
+			// the range is fixed by the descriptor, the offset of the frame's bodies is given when binding
+			VkDescriptorBufferInfo bufferInfo{ transientBuffers[i].getBuffer(), 0, sizeof(glm::vec4) * maxBodies };
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = frame.descriptorSet;
+			write.dstBinding = 0;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+			write.pBufferInfo = &bufferInfo;
+			vkUpdateDescriptorSets(vefpDevice.device(), 1, &write, 0, nullptr);
+		}
+	}
+
+	void FieldHeatmapSystem::render(
+		VkCommandBuffer commandBuffer,
+		int frameIndex,
+		const GravityPhysicsSystem& physicsSystem,
+		VefpWorld& world,
+		const VefpCamera2d& camera) {
+		auto bodyQuery = world.query<Transform2dComponent, RigidBody2dComponent>();
+		const uint32_t bodyCount = bodyQuery.count();
+		if (bodyCount > maxBodies) {
+			throw std::runtime_error("too many bodies for field heatmap system!");
+		}
+
+		// a full range is allocated so the descriptor's range stays inside the buffer
+		auto allocation = transientBuffers[frameIndex].allocate(
+			sizeof(glm::vec4) * maxBodies,
+			vefpDevice.properties.limits.minStorageBufferOffsetAlignment);
+		auto* bodies = static_cast<glm::vec4*>(allocation.mapped);
+		bodyQuery.each([&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody) {
+			*bodies++ = glm::vec4(transform.translation, rigidBody.mass, 0.f);
+		});
+
+		heatmapPipeline->bind(commandBuffer);
+		const uint32_t bodyOffset = static_cast<uint32_t>(allocation.offset);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			1,
+			&frames[frameIndex].descriptorSet,
+			1,
+			&bodyOffset);
+
+		HeatmapPushConstantData push{};
+		push.viewCenter = camera.getCenter();
+		push.viewHalfExtent = camera.getHalfExtent();
+		push.strengthGravity = physicsSystem.strengthGravity;
+		push.bodyCount = bodyCount;
+		vkCmdPushConstants(
+			commandBuffer,
+			pipelineLayout,
+			VK_SHADER_STAGE_FRAGMENT_BIT,
+			0,
+			sizeof(HeatmapPushConstantData),
+			&push);
+
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_pipeline.hpp"
+#include "vefp_components.hpp"
+#include "vefp_camera.hpp"
+#include "vefp_frame_ring.hpp"
+#include "vefp_transient_buffer.hpp"
+#include "physics_and_field.hpp"
+
+#include <memory>
+
+namespace vefp {
+
+	// Draws the gravity field of the physics bodies as a full screen background instead of arrows.
+	// Every pixel evaluates the field at its world position in the fragment shader, the hue shows
+	// the direction and the brightness the magnitude. The cost depends on the pixel and body count
+	// only, not on how many field points the scene has. Bodies are uploaded to the frame's transient
+	// buffer every frame and bound with a dynamic offset.
+	class FieldHeatmapSystem {
+	private:
+		struct FrameResources {
+			// points at the frame slot's transient buffer
+			VkDescriptorSet descriptorSet;
+		};
+
+		void createDescriptorSetLayout();
+		void createPipelineLayout();
+		void createPipeline(VkRenderPass renderPass);
+		void createFrameResources();
+
+		VefpDevice& vefpDevice;
+		VefpFrameRing<VefpTransientBuffer>& transientBuffers;
+		const uint32_t maxBodies;
+
+		std::unique_ptr<VefpPipeline> heatmapPipeline;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipelineLayout pipelineLayout;
+
+		VefpFrameRing<FrameResources> frames;
+
+	public:
+
+		FieldHeatmapSystem(
+			VefpDevice& device,
+			VkRenderPass renderPass,
+			VefpFrameRing<VefpTransientBuffer>& transientBuffers,
+			uint32_t maxBodies);
+		~FieldHeatmapSystem();
+
+		FieldHeatmapSystem(const FieldHeatmapSystem&) = delete;
+		FieldHeatmapSystem& operator=(const FieldHeatmapSystem&) = delete;
+
+		// Bodies are the world's entities with a RigidBody2dComponent. Depth is neither tested nor
+		// written, so it has to be recorded before anything else in the render pass.
+		void render(
+			VkCommandBuffer commandBuffer,
+			int frameIndex,
+			const GravityPhysicsSystem& physicsSystem,
+			VefpWorld& world,
+			const VefpCamera2d& camera);
+	};
+
+}
@@ -2,17 +2,34 @@
 #include "physics_and_field.hpp"
 
 #include "simple_render_system.hpp"
+#include "lod_system.hpp"
+#include "transform_system.hpp"
+#include "indirect_render_system.hpp"
+#include "field_compute_system.hpp"
+#include "field_heatmap_system.hpp"
+#include "vefp_async_compute.hpp"
+#include "vefp_alloc_counter.hpp"
+#include "vefp_render_graph.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <stdexcept>
 #include <array>
+#include <cstdio>
+#include <iostream>
+#include <utility>
 
 namespace vefp {
 
+	// the built in models are flat colored, 16 bit positions are plenty for them
+	static constexpr VefpVertexLayout SCENE_MODEL_LAYOUT{ VefpVertexLayout::PositionFormat::Snorm16 };
+
 	std::unique_ptr<VefpModel> FirstApp::createSquareModel(VefpDevice& device, glm::vec2 offset) {
 		std::vector<VefpModel::Vertex> vertices = {
 			{{-0.5f, -0.5f}},
@@ -26,7 +43,7 @@ namespace vefp {
 			v.position += offset;
 		}
 
-		return std::make_unique<VefpModel>(device, vertices);
+		return std::make_unique<VefpModel>(device, uploadService, vertices, SCENE_MODEL_LAYOUT);
 	}
 
 	std::unique_ptr<VefpModel> FirstApp::createCircleModel(VefpDevice& device, unsigned int numSides) {
@@ -43,11 +60,56 @@ namespace vefp {
 			vertices.push_back(uniqueVertices[(i + 1) % numSides]);
 			vertices.push_back(uniqueVertices[numSides]);
 		}
-		return std::make_unique<VefpModel>(device, vertices);
+		return std::make_unique<VefpModel>(device, uploadService, vertices, SCENE_MODEL_LAYOUT);
 	}
 
-	FirstApp::FirstApp() {
-		loadAppObjects();
+	std::shared_ptr<VefpLodModel> FirstApp::createCircleLodModel(VefpDevice& device, unsigned int maxSides, unsigned int minSides) {
+		assert(minSides >= 3 && minSides <= maxSides && "Invalid circle side range");
+		std::vector<VefpLodModel::Level> levels{};
+		for (unsigned int sides = maxSides; sides >= minSides; sides /= 2) {
+			// a level is needed once the next coarser one would deviate too far
+			const unsigned int coarserSides = sides / 2;
+			const float minPixelSize = coarserSides >= minSides
+				? VefpLodModel::maxCirclePixelSize(coarserSides, LOD_TOLERANCE_PIXELS)
+				: 0.f;
+			levels.push_back({ createCircleModel(device, sides), minPixelSize });
+		}
+		return std::make_shared<VefpLodModel>(std::move(levels));
+	}
+
+	FirstApp::FirstApp() : FirstApp(Settings{}) {}
+
+	FirstApp::FirstApp(const Settings& settings)
+		: vefpRenderer{ vefpWindow, vefpDevice, settings.framesInFlight, settings.presentMode },
+		framePacer{ settings.targetFps },
+		checkpointPath{ settings.checkpointPath },
+		replaySpeed{ settings.replaySpeed } {
+		fieldSettings.method = settings.fieldMethod;
+		fieldSettings.errorTolerance = settings.fieldErrorTolerance;
+		showFieldHeatmap = settings.fieldHeatmap;
+		// a pipelined run takes its scratch from the frame that launched it, which with a single frame
+		// in flight is rewound by the next beginFrame while the run still uses it
+		pipelineUpdates = settings.pipelineUpdates && vefpRenderer.getFramesInFlight() > 1;
+		updateWorkers = settings.updateWorkers;
+		if (settings.gpuBudgetMs > 0.f) {
+			VefpResolutionScaler::Settings resolutionSettings{};
+			resolutionSettings.targetFrameMs = settings.gpuBudgetMs;
+			if (!vefpRenderer.enableDynamicResolution(resolutionSettings)) {
+				std::cout << "Dynamic resolution is not supported, rendering at full resolution" << std::endl;
+			}
+		}
+		loadAppObjects(settings.scenePath);
+
+		const uint32_t bodyCount = world.query<Transform2dComponent, RigidBody2dComponent>().count();
+		if (!settings.replayPath.empty()) {
+			trajectoryReplay = std::make_unique<VefpTrajectoryReader>(settings.replayPath);
+			if (trajectoryReplay->bodyCount() != bodyCount) {
+				throw std::runtime_error("trajectory does not match the bodies of the scene!");
+			}
+		}
+		else if (!settings.recordPath.empty()) {
+			trajectoryRecorder = std::make_unique<VefpTrajectoryRecorder>(settings.recordPath, bodyCount, SIMULATION_TIME_STEP);
+		}
 	}
 	
 	FirstApp::~FirstApp() {
@@ -57,86 +119,633 @@ namespace vefp {
 
 	void FirstApp::run() {
 
-		// create some models
-		std::shared_ptr<VefpModel> squareModel = createSquareModel(
-			vefpDevice,
-			{ .7f, .0f });  // offset model by .5 so rotation occurs at edge rather than center of square
-		std::shared_ptr<VefpModel> circleModel = createCircleModel(vefpDevice, 64);
+		GravityPhysicsSystem gravitySystem{ .81 };
+		// the simulation thread steps its own copy of the bodies, the world follows its snapshots
+		GravityPhysicsSystem simulationGravity{ gravitySystem.strengthGravity };
+		VefpSimulationThread::Settings simulationSettings{};
+		simulationSettings.timeStep = SIMULATION_TIME_STEP;
+		VefpSimulationThread simulation{
+			captureBodies(),
+			[&](VefpSimulationThread::Snapshot& state, float timeStep) { simulateStep(simulationGravity, state, timeStep); },
+			simulationSettings };
+		Vec2FieldSystem vecFieldSystem{ fieldSettings };
 
-		// create physics objects
-		std::vector<VefpAppObject> physicsObjects{};
-		auto yellow = VefpAppObject::createAppObject();
-		yellow.transform2d.scale = glm::vec2{ .05f };
-		yellow.transform2d.translation = { .5f, .5f };
-		yellow.color = { .8f, 0.5f, 0.f };
-		yellow.rigidBody2d.velocity = { -.5f, .0f };
-		yellow.model = circleModel;
-		physicsObjects.push_back(std::move(yellow));
-		auto blue = VefpAppObject::createAppObject();
-		blue.transform2d.scale = glm::vec2{ .05f };
-		blue.transform2d.translation = { -.45f, -.25f };
-		blue.color = { 0.f, 0.1f, 0.9f };
-		blue.rigidBody2d.velocity = { .5f, .0f };
-		blue.model = circleModel;
-		physicsObjects.push_back(std::move(blue));
+		TransformSystem transformSystem{};
+		LodSystem lodSystem{};
+		SimpleRenderSystem simpleRenderSystem(vefpDevice, vefpRenderer.getSwapChainRenderPass());
+		VefpCamera2d camera{};
 
-		// create vector field
-		std::vector<VefpAppObject> vectorField{};
-		int gridCount = 40;
-		for (int i = 0; i < gridCount; i++) {
-			for (int j = 0; j < gridCount; j++) {
-				auto vf = VefpAppObject::createAppObject();
-				vf.transform2d.scale = glm::vec2(0.005f);
-				vf.transform2d.translation = {
-					-1.0f + (i + 0.5f) * 2.0f / gridCount,
-					-1.0f + (j + 0.5f) * 2.0f / gridCount };
-				vf.color = glm::vec3(1.0f);
-				vf.model = squareModel;
-				vectorField.push_back(std::move(vf));
-			}
+		// the vector field is culled and drawn on the gpu when the device allows it
+		std::unique_ptr<IndirectRenderSystem> indirectRenderSystem{};
+		if (vefpDevice.supportsGpuDrivenRendering()) {
+			indirectRenderSystem = std::make_unique<IndirectRenderSystem>(
+				vefpDevice,
+				vefpRenderer.getSwapChainRenderPass(),
+				vefpRenderer.getFramesInFlight(),
+				world.query<FieldPointComponent>().count());
 		}
 
-		GravityPhysicsSystem gravitySystem{ .81 };
-		Vec2FieldSystem vecFieldSystem{};
+		// with gpu driven rendering the field is evaluated on the async compute queue as well
+		std::unique_ptr<VefpAsyncCompute> asyncCompute{};
+		std::unique_ptr<FieldComputeSystem> fieldComputeSystem{};
+		if (indirectRenderSystem) {
+			asyncCompute = std::make_unique<VefpAsyncCompute>(vefpDevice, vefpRenderer.getFramesInFlight());
+			fieldComputeSystem = std::make_unique<FieldComputeSystem>(
+				vefpDevice,
+				vefpRenderer.getFramesInFlight(),
+				world.query<RigidBody2dComponent>().count());
+		}
 
-		SimpleRenderSystem simpleRenderSystem(vefpDevice, vefpRenderer.getSwapChainRenderPass());
+		FieldHeatmapSystem fieldHeatmapSystem{
+			vefpDevice,
+			vefpRenderer.getSwapChainRenderPass(),
+			vefpRenderer.getTransientBuffers(),
+			std::max(world.query<RigidBody2dComponent>().count(), 1u) };
+
+		// orders the gpu work of a frame and places the barriers between it
+		VefpRenderGraph renderGraph{ vefpDevice, vefpRenderer.getFramesInFlight() };
+
+		// The cpu side of a frame. Systems declare the components they touch and the graph runs the
+		// ones that do not conflict side by side. While it runs the render thread keeps out of the
+		// world, the tasks read the frame's settings from these copies instead.
+		bool updateFieldArrows = false;
+		VkExtent2D updateExtent{};
+		// taken once the update has finished, a pipelined one is still running when they are reported
+		std::optional<Vec2FieldSystem::Stats> fieldStats{};
+		VefpTaskGraph::Settings updateSettings{};
+		updateSettings.workerCount = updateWorkers;
+		VefpTaskGraph updateGraph{ vefpRenderer.getFrameAllocator(), updateSettings };
+		updateGraph.addTask("apply snapshot", [&](VefpFrameArena&) {
+			// between the two newest finished steps, the simulation does not wait for the frame to take
+			// them. Applied every frame, frames faster than the step rate still move the bodies.
+			applySnapshot(simulation.interpolated());
+		})
+			.writes<Transform2dComponent, RigidBody2dComponent>();
+		updateGraph.addTask("vector field", [&](VefpFrameArena& scratch) {
+			// the heatmap evaluates the field itself, the arrows are neither updated nor drawn
+			if (updateFieldArrows && !fieldComputeSystem) {
+				vecFieldSystem.update(gravitySystem, world, &scratch);
+			}
+		})
+			.reads<RigidBody2dComponent, FieldPointComponent>()
+			.writes<Transform2dComponent>();
+		updateGraph.addTask("spin bodies", [&](VefpFrameArena&) {
+			// bodies slowly spin in place
+			world.query<Transform2dComponent>().with<RigidBody2dComponent>().each([](Transform2dComponent& transform) {
+				transform.setRotation(glm::mod(transform.rotation + 0.01f, glm::two_pi<float>()));
+			});
+		})
+			.reads<RigidBody2dComponent>()
+			.writes<Transform2dComponent>();
+		updateGraph.addTask("world transforms", [&](VefpFrameArena& scratch) { transformSystem.update(world, &scratch); })
+			.reads<ParentComponent>()
+			.writes<Transform2dComponent, WorldTransform2dComponent>();
+		updateGraph.addTask("levels of detail", [&](VefpFrameArena&) { lodSystem.update(world, camera, updateExtent); })
+			.reads<WorldTransform2dComponent, LodComponent>()
+			.writes<ModelComponent>();
+		auto launchUpdate = [&] {
+			updateFieldArrows = !showFieldHeatmap;
+			updateExtent = vefpRenderer.getSceneExtent();
+			updateGraph.launch();
+		};
 
+		simulation.start();
 		while (!vefpWindow.shouldClose()) {
+			// counts the allocations of the render thread and of the work it waits for
+			const uint64_t frameStartAllocations = VefpAllocCounter::threadAllocations();
+
+			// sleep before sampling input so the frame is built from the freshest input possible
+			framePacer.waitForNextFrame();
 			glfwPollEvents();
+			handleLatencyControls();
+			handleCheckpointControls();
+			handleFieldViewControls();
+			handleReplayControls();
+
+			// nothing gets presented while minimized, sleep until something happens instead of spinning
+			if (vefpWindow.isMinimized()) {
+				resetAllocationCheck();
+				glfwWaitEventsTimeout(MINIMIZED_POLL_INTERVAL);
+				continue;
+			}
 
 			if (auto commandBuffer = vefpRenderer.beginFrame()) {
+				// hand finished uploads over to the graphics queue before anything draws with them
+				vefpRenderer.addFrameDependency(uploadService.acquireUploads(commandBuffer));
+
 				//update systems
-				gravitySystem.update(physicsObjects, 1.f / 60, 5);
-				vecFieldSystem.update(gravitySystem, physicsObjects, vectorField);
-
-				//render systems
-				vefpRenderer.beginSwapChainRenderPass(commandBuffer);
-				simpleRenderSystem.renderAppObjects(commandBuffer, physicsObjects);
-				simpleRenderSystem.renderAppObjects(commandBuffer, vectorField);
-				vefpRenderer.endSwapChainRenderPass(commandBuffer);
+				// already running since the last frame was recorded when updates are pipelined
+				if (!updateGraph.isRunning()) {
+					launchUpdate();
+				}
+				updateGraph.wait();
+				fieldStats.reset();
+				if (updateFieldArrows && !fieldComputeSystem) {
+					fieldStats = vecFieldSystem.getStats();
+				}
+				if (checkpointRequested) {
+					// a failed checkpoint leaves the previous one in place, the session keeps running
+					try {
+						saveCheckpoint();
+					}
+					catch (const std::exception& e) {
+						std::cerr << "failed to save checkpoint: " << e.what() << std::endl;
+					}
+					checkpointRequested = false;
+					resetAllocationCheck();
+				}
+				// field point buffers are rebuilt when points or models change. Both versions only
+				// grow, so their sum moves on whenever either does.
+				const uint64_t sceneVersion = world.getStructureVersion() + lodSystem.getModelVersion();
+				if (sceneVersion != checkedSceneVersion) {
+					checkedSceneVersion = sceneVersion;
+					resetAllocationCheck();
+				}
+				const bool drawFieldArrows = updateFieldArrows;
+
+				int frameIndex = vefpRenderer.getFrameIndex();
+				VefpFrameArena& frameArena = vefpRenderer.getFrameArena();
+				const bool drawIndirect = drawFieldArrows && indirectRenderSystem;
+				auto recordScene = [&](VkCommandBuffer commandBuffer) {
+					simpleRenderSystem.resetStats();
+					auto renderQuery = world.query<Transform2dComponent, WorldTransform2dComponent, ModelComponent, ColorComponent>();
+					if (!drawFieldArrows) {
+						fieldHeatmapSystem.render(commandBuffer, frameIndex, gravitySystem, world, camera);
+						simpleRenderSystem.renderEntities(commandBuffer, renderQuery.exclude<FieldPointComponent>(), camera, frameArena);
+					}
+					else if (drawIndirect) {
+						simpleRenderSystem.renderEntities(commandBuffer, renderQuery.exclude<FieldPointComponent>(), camera, frameArena);
+						indirectRenderSystem->renderObjects(commandBuffer, frameIndex, camera);
+					}
+					else {
+						simpleRenderSystem.renderEntities(commandBuffer, renderQuery, camera, frameArena);
+					}
+				};
+
+				renderGraph.beginFrame(frameIndex, frameArena);
+				if (drawIndirect) {
+					// field points only move on the gpu
+					indirectRenderSystem->updateObjects(
+						frameIndex,
+						world.query<Transform2dComponent, WorldTransform2dComponent, ModelComponent, ColorComponent>()
+							.with<FieldPointComponent>()
+							.exclude<ParentComponent>(),
+						sceneVersion);
+
+					// culling and drawing read the field, the rest of the frame does not wait for it
+					auto computeCommandBuffer = asyncCompute->beginFrame(frameIndex);
+					fieldComputeSystem->updateField(
+						computeCommandBuffer,
+						frameIndex,
+						gravitySystem,
+						world,
+						indirectRenderSystem->getObjectBuffer(frameIndex),
+						indirectRenderSystem->getObjectCount(frameIndex));
+					vefpRenderer.addFrameDependency(
+						asyncCompute->submit(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT));
+
+					auto drawCommands = renderGraph.importBuffer(indirectRenderSystem->getDrawCommandBuffer(frameIndex), false);
+					auto drawCount = renderGraph.importBuffer(indirectRenderSystem->getDrawCountBuffer(frameIndex), false);
+					renderGraph.addPass([&](VkCommandBuffer commandBuffer) {
+						indirectRenderSystem->resetDrawCount(commandBuffer, frameIndex);
+					})
+						.write(drawCount, RenderGraphUsage::TransferDst);
+					renderGraph.addPass([&](VkCommandBuffer commandBuffer) {
+						indirectRenderSystem->cullObjects(commandBuffer, frameIndex, camera);
+					})
+						.write(drawCommands, RenderGraphUsage::StorageWriteCompute)
+						.write(drawCount, RenderGraphUsage::StorageWriteCompute);
+					vefpRenderer.addScenePasses(renderGraph, [&](VkCommandBuffer commandBuffer) { recordScene(commandBuffer); })
+						.read(drawCommands, RenderGraphUsage::IndirectRead)
+						.read(drawCount, RenderGraphUsage::IndirectRead);
+				}
+				else {
+					vefpRenderer.addScenePasses(renderGraph, [&](VkCommandBuffer commandBuffer) { recordScene(commandBuffer); });
+				}
+				renderGraph.compile();
+				renderGraph.execute(commandBuffer);
+				// the next frame's systems overlap submitting and presenting this one and acquiring the
+				// next image, recording is done with the world
+				if (pipelineUpdates) {
+					launchUpdate();
+				}
 				vefpRenderer.endFrame();
+				framePacer.frameSubmitted(vefpRenderer.getFrameTimeline().lastSubmittedValue());
 			}
+			else {
+				// the swap chain was recreated
+				resetAllocationCheck();
+			}
+
+			reportFrameStats(updateGraph.getStats(), simpleRenderSystem.getStats(), fieldStats);
+			checkFrameAllocations(VefpAllocCounter::threadAllocations() - frameStartAllocations);
 		}
 
+		if (updateGraph.isRunning()) {
+			updateGraph.wait();
+		}
+		simulation.stop();
 		vkDeviceWaitIdle(vefpDevice.device());
+		// the simulation thread is done with the recorder, failing to complete the file is reported
+		if (trajectoryRecorder) {
+			trajectoryRecorder->finish();
+		}
 	}
 
-	void FirstApp::loadAppObjects() {
-		std::vector<VefpModel::Vertex> vertices{
-			{ { 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
-			{ { 0.5f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
-			{ { -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }
-		};
-		auto vefpModel = std::make_shared<VefpModel>(vefpDevice, vertices);
+	void FirstApp::handleLatencyControls() {
+		static constexpr std::array<std::pair<int, VkPresentModeKHR>, 4> presentModeKeys{ {
+			{ GLFW_KEY_1, VK_PRESENT_MODE_FIFO_KHR },
+			{ GLFW_KEY_2, VK_PRESENT_MODE_FIFO_RELAXED_KHR },
+			{ GLFW_KEY_3, VK_PRESENT_MODE_MAILBOX_KHR },
+			{ GLFW_KEY_4, VK_PRESENT_MODE_IMMEDIATE_KHR },
+		} };
+
+		for (const auto& [key, presentMode] : presentModeKeys) {
+			if (glfwGetKey(vefpWindow.getGLFWwindow(), key) == GLFW_PRESS) {
+				vefpRenderer.setPresentMode(presentMode);
+			}
+		}
+	}
 
-		auto triangle = VefpAppObject::createAppObject();
-		triangle.model = vefpModel;
-		triangle.color = { .1f, .8f, .1f };
-		triangle.transform2d.translation.x = .2f;
-		triangle.transform2d.scale = { 2.f, .5f };
-		triangle.transform2d.rotation = .25f * glm::two_pi<float>();
+	void FirstApp::reportFrameStats(
+		const VefpTaskGraph::Stats& updateStats,
+		const RenderStats& renderStats,
+		const std::optional<Vec2FieldSystem::Stats>& fieldStats) {
+		if (!framePacer.update(vefpRenderer.getFrameTimeline())) {
+			return;
+		}
+
+		const auto& stats = framePacer.getStats();
+		char title[384];
+		int length = std::snprintf(
+			title,
+			sizeof(title),
+			"%s | %.2f ms | latency %.1f ms (%.1f - %.1f)",
+			VefpSwapChain::presentModeName(vefpRenderer.getPresentMode()),
+			stats.frameTimeMs,
+			stats.latencyAvgMs,
+			stats.latencyMinMs,
+			stats.latencyMaxMs);
+
+		// gpu time and the resolution it was reached at, once the device provides timestamps
+		if (vefpRenderer.getGpuFrameTime() > 0.f && length > 0 && length < static_cast<int>(sizeof(title))) {
+			length += std::snprintf(
+				title + length,
+				sizeof(title) - length,
+				" | gpu %.2f ms @ %d%%",
+				vefpRenderer.getGpuFrameTime(),
+				static_cast<int>(vefpRenderer.getResolutionScale() * 100.f + 0.5f));
+		}
+
+		// cpu time of the last frame's systems, and how much of it is a chain no worker count can shorten
+		if (updateStats.tasks > 0 && length > 0 && length < static_cast<int>(sizeof(title))) {
+			length += std::snprintf(
+				title + length,
+				sizeof(title) - length,
+				" | update %.2f ms, critical path %.2f ms",
+				updateStats.wallMs,
+				updateStats.criticalPathMs);
+		}
+
+		// objects of the last recorded frame that survived culling, and those that did not, then the
+		// pipeline and model binds it took and the ones sorting the draws saved
+		if (length > 0 && length < static_cast<int>(sizeof(title))) {
+			length += std::snprintf(
+				title + length,
+				sizeof(title) - length,
+				" | drawn %u, culled %u | binds %u + %u, saved %u",
+				renderStats.drawnObjects,
+				renderStats.culledObjects,
+				renderStats.pipelineBinds,
+				renderStats.modelBinds,
+				renderStats.skippedBinds);
+		}
 
-		appObjects.push_back(std::move(triangle));
+		// field points the cpu evaluated for the arrows, and how accurate the multipole expansion was
+		// at its last check against the direct sum
+		if (fieldStats && length > 0 && length < static_cast<int>(sizeof(title))) {
+			if (fieldStats->multipole) {
+				length += std::snprintf(
+					title + length,
+					sizeof(title) - length,
+					" | field %u points, order %u, error %.1e",
+					fieldStats->evaluatedPoints,
+					fieldStats->multipoleOrder,
+					fieldStats->measuredError);
+			}
+			else {
+				length += std::snprintf(title + length, sizeof(title) - length, " | field %u points", fieldStats->evaluatedPoints);
+			}
+		}
+
+		// debug builds show how often the heap was hit per frame, steady state should be close to 0
+		if (VefpAllocCounter::ENABLED && stats.frames > 0 && length > 0 && length < static_cast<int>(sizeof(title))) {
+			uint64_t allocations = VefpAllocCounter::allocations();
+			std::snprintf(
+				title + length,
+				sizeof(title) - length,
+				" | heap %.1f/frame",
+				static_cast<float>(allocations - lastAllocationCount) / stats.frames);
+			lastAllocationCount = allocations;
+		}
+		vefpWindow.setTitleSuffix(title);
+	}
+
+	void FirstApp::checkFrameAllocations(uint64_t frameAllocations) {
+		if (!VefpAllocCounter::ENABLED) {
+			return;
+		}
+
+		// recreating the swap chain reallocates, also for a new present mode at the same size, and so
+		// does the first frame at a new scene extent, which needs framebuffers of its own
+		const VkExtent2D extent = vefpRenderer.getSceneExtent();
+		const VkPresentModeKHR presentMode = vefpRenderer.getPresentMode();
+		if (extent.width != checkedExtent.width || extent.height != checkedExtent.height || presentMode != checkedPresentMode) {
+			checkedExtent = extent;
+			checkedPresentMode = presentMode;
+			resetAllocationCheck();
+		}
+
+		if (allocationSettleFrames > 0) {
+			allocationSettleFrames--;
+			return;
+		}
+		if (frameAllocations > 0) {
+			std::cerr << "steady state frame made " << frameAllocations << " heap allocations" << std::endl;
+			// reported at most once per settle period instead of every frame
+			resetAllocationCheck();
+		}
+	}
+
+	void FirstApp::loadAppObjects(const std::string& scenePath) {
+		// create some models
+		sceneModels.push_back({
+			"square",
+			createSquareModel(
+				vefpDevice,
+				{ .7f, .0f }) });  // offset model by .5 so rotation occurs at edge rather than center of square
+		// 64 sides are only needed once a body covers a few hundred pixels
+		std::shared_ptr<VefpLodModel> circleLod = createCircleLodModel(vefpDevice, 64, 8);
+		sceneModels.push_back({ "circle", circleLod->getModel(0), circleLod });
+		// copies run on the transfer queue while the rest of the scene is set up
+		uploadService.flush();
+
+		if (scenePath.empty()) {
+			loadDefaultScene();
+		}
+		else {
+			loadSnapshot(scenePath);
+		}
+	}
+
+	void FirstApp::loadDefaultScene() {
+		const uint32_t circleIndex = sceneModelIndex(findSceneModel("circle").model.get());
+		std::shared_ptr<VefpModel> circleModel = sceneModels[circleIndex].model;
+
+		// create physics objects
+		Transform2dComponent yellowTransform{};
+		yellowTransform.scale = glm::vec2{ .05f };
+		yellowTransform.translation = { .5f, .5f };
+		EntityId yellow = world.createEntity(
+			yellowTransform,
+			WorldTransform2dComponent{},
+			RigidBody2dComponent{ { -.5f, .0f } },
+			ModelComponent{ circleModel },
+			ColorComponent{ { .8f, 0.5f, 0.f } });
+		attachLod(yellow, circleIndex);
+		Transform2dComponent blueTransform{};
+		blueTransform.scale = glm::vec2{ .05f };
+		blueTransform.translation = { -.45f, -.25f };
+		EntityId blue = world.createEntity(
+			blueTransform,
+			WorldTransform2dComponent{},
+			RigidBody2dComponent{ { .5f, .0f } },
+			ModelComponent{ circleModel },
+			ColorComponent{ { 0.f, 0.1f, 0.9f } });
+		attachLod(blue, circleIndex);
+
+		// create vector field
+		VefpSceneSnapshot::FieldGrid grid{};
+		grid.min = { -1.f, -1.f };
+		grid.max = { 1.f, 1.f };
+		grid.columns = 40;
+		grid.rows = 40;
+		grid.model = sceneModelIndex(findSceneModel("square").model.get());
+		grid.pointScale = 0.005f;
+		grid.color = glm::vec3(1.0f);
+		spawnFieldGrid(grid);
+	}
+
+	void FirstApp::loadSnapshot(const std::string& filepath) {
+		VefpSceneSnapshot snapshot{ filepath };
+
+		// snapshot model indices are translated once instead of looking names up per body
+		std::vector<uint32_t> modelIndices;
+		for (uint32_t i = 0; i < snapshot.modelRefs().size(); i++) {
+			modelIndices.push_back(sceneModelIndex(findSceneModel(snapshot.modelName(i)).model.get()));
+		}
+		const uint32_t circleIndex = sceneModelIndex(findSceneModel("circle").model.get());
+
+		// optional sections fall back to the defaults of the built in scene
+		auto positions = snapshot.bodyPositions();
+		auto velocities = snapshot.bodyVelocities();
+		auto masses = snapshot.bodyMasses();
+		auto scales = snapshot.bodyScales();
+		auto colors = snapshot.bodyColors();
+		auto models = snapshot.bodyModels();
+		for (size_t i = 0; i < positions.size(); i++) {
+			Transform2dComponent transform{};
+			transform.translation = positions[i];
+			transform.scale = scales.empty() ? glm::vec2{ .05f } : scales[i];
+
+			RigidBody2dComponent rigidBody{};
+			rigidBody.velocity = velocities.empty() ? glm::vec2{ 0.f } : velocities[i];
+			rigidBody.mass = masses.empty() ? 1.f : masses[i];
+
+			const uint32_t model = models.empty() ? circleIndex : modelIndices[models[i]];
+			EntityId body = world.createEntity(
+				transform,
+				WorldTransform2dComponent{},
+				rigidBody,
+				ModelComponent{ sceneModels[model].model },
+				ColorComponent{ colors.empty() ? glm::vec3{ 1.f } : colors[i] });
+			attachLod(body, model);
+		}
+
+		for (VefpSceneSnapshot::FieldGrid grid : snapshot.fieldGrids()) {
+			grid.model = modelIndices[grid.model];
+			spawnFieldGrid(grid);
+		}
+	}
+
+	void FirstApp::spawnFieldGrid(const VefpSceneSnapshot::FieldGrid& grid) {
+		const glm::vec2 spacing = (grid.max - grid.min) / glm::vec2(grid.columns, grid.rows);
+		for (uint32_t i = 0; i < grid.columns; i++) {
+			for (uint32_t j = 0; j < grid.rows; j++) {
+				Transform2dComponent transform{};
+				transform.scale = glm::vec2(grid.pointScale);
+				transform.translation = grid.min + (glm::vec2(i, j) + 0.5f) * spacing;
+				EntityId point = world.createEntity(
+					transform,
+					WorldTransform2dComponent{},
+					ModelComponent{ sceneModels[grid.model].model },
+					ColorComponent{ grid.color },
+					FieldPointComponent{});
+				attachLod(point, grid.model);
+			}
+		}
+		// grids are kept with scene model indices so checkpoints can write them back
+		fieldGrids.push_back(grid);
+	}
+
+	void FirstApp::attachLod(EntityId entity, uint32_t sceneModel) {
+		if (sceneModels[sceneModel].lod) {
+			world.addComponent(entity, LodComponent{ sceneModels[sceneModel].lod });
+		}
+	}
+
+	void FirstApp::saveCheckpoint() {
+		std::vector<glm::vec2> positions;
+		std::vector<glm::vec2> velocities;
+		std::vector<float> masses;
+		std::vector<glm::vec2> scales;
+		std::vector<glm::vec3> colors;
+		std::vector<uint32_t> models;
+		world.query<Transform2dComponent, RigidBody2dComponent, ModelComponent, ColorComponent>().each(
+			[&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody, ModelComponent& model, ColorComponent& color) {
+				positions.push_back(transform.translation);
+				velocities.push_back(rigidBody.velocity);
+				masses.push_back(rigidBody.mass);
+				scales.push_back(transform.scale);
+				colors.push_back(color.color);
+				models.push_back(sceneModelIndex(model.model.get()));
+			});
+
+		std::vector<VefpSceneSnapshot::ModelRef> modelRefs;
+		for (auto& sceneModel : sceneModels) {
+			modelRefs.push_back(VefpSceneSnapshot::makeModelRef(sceneModel.name));
+		}
+
+		VefpSceneSnapshot::Contents contents{};
+		contents.bodyPositions = positions;
+		contents.bodyVelocities = velocities;
+		contents.bodyMasses = masses;
+		contents.bodyScales = scales;
+		contents.bodyColors = colors;
+		contents.bodyModels = models;
+		contents.fieldGrids = fieldGrids;
+		contents.modelRefs = modelRefs;
+		VefpSceneSnapshot::write(checkpointPath, contents);
+	}
+
+	void FirstApp::handleCheckpointControls() {
+		bool keyDown = glfwGetKey(vefpWindow.getGLFWwindow(), GLFW_KEY_F5) == GLFW_PRESS;
+		if (keyDown && !checkpointKeyDown) {
+			checkpointRequested = true;
+		}
+		checkpointKeyDown = keyDown;
+	}
+
+	void FirstApp::handleFieldViewControls() {
+		bool keyDown = glfwGetKey(vefpWindow.getGLFWwindow(), GLFW_KEY_H) == GLFW_PRESS;
+		if (keyDown && !heatmapKeyDown) {
+			showFieldHeatmap = !showFieldHeatmap;
+			// the other view's buffers grow on its first frames
+			resetAllocationCheck();
+		}
+		heatmapKeyDown = keyDown;
+	}
+
+	VefpSimulationThread::Snapshot FirstApp::captureBodies() {
+		VefpSimulationThread::Snapshot state{};
+		bodyMasses.clear();
+		world.query<Transform2dComponent, RigidBody2dComponent>().each(
+			[&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody) {
+				state.positions.push_back(transform.translation);
+				state.velocities.push_back(rigidBody.velocity);
+				bodyMasses.push_back(rigidBody.mass);
+			});
+		return state;
+	}
+
+	void FirstApp::simulateStep(GravityPhysicsSystem& gravitySystem, VefpSimulationThread::Snapshot& state, float timeStep) {
+		if (trajectoryReplay) {
+			replayTrajectory(state, timeStep);
+			return;
+		}
+
+		gravitySystem.update(state.positions, state.velocities, bodyMasses, timeStep, 5);
+		if (trajectoryRecorder) {
+			trajectoryRecorder->record(state.positions, state.velocities);
+		}
+	}
+
+	void FirstApp::replayTrajectory(VefpSimulationThread::Snapshot& state, float timeStep) {
+		const uint32_t frameCount = trajectoryReplay->frameCount();
+		if (frameCount == 0) {
+			return;
+		}
+
+		// loops back to the start once the end of the recording is reached
+		const double duration = frameCount * static_cast<double>(trajectoryReplay->timeStep());
+		replayTime += replaySeeks.exchange(0, std::memory_order_relaxed) * REPLAY_SEEK_SECONDS;
+		replayTime = std::fmod(replayTime + timeStep * replaySpeed, duration);
+		if (replayTime < 0.0) {
+			replayTime += duration;
+		}
+		const uint32_t frame = std::min(
+			static_cast<uint32_t>(replayTime / trajectoryReplay->timeStep()),
+			frameCount - 1);
+		trajectoryReplay->readFrame(frame, state.positions, state.velocities);
+	}
+
+	void FirstApp::applySnapshot(const VefpSimulationThread::Snapshot& snapshot) {
+		// bodies are iterated in the same order captureBodies put them into the state
+		size_t i = 0;
+		world.query<Transform2dComponent, RigidBody2dComponent>().each(
+			[&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody) {
+				transform.setTranslation(snapshot.positions[i]);
+				rigidBody.velocity = snapshot.velocities[i];
+				i++;
+			});
+	}
+
+	void FirstApp::handleReplayControls() {
+		if (!trajectoryReplay) {
+			return;
+		}
+
+		int seek = 0;
+		if (glfwGetKey(vefpWindow.getGLFWwindow(), GLFW_KEY_LEFT) == GLFW_PRESS) {
+			seek--;
+		}
+		if (glfwGetKey(vefpWindow.getGLFWwindow(), GLFW_KEY_RIGHT) == GLFW_PRESS) {
+			seek++;
+		}
+		// the next replay step wraps the time back into the recording
+		if (seek != 0 && seek != replaySeekKeyDown) {
+			replaySeeks.fetch_add(seek, std::memory_order_relaxed);
+		}
+		replaySeekKeyDown = seek;
+	}
+
+	const FirstApp::SceneModel& FirstApp::findSceneModel(const std::string& name) const {
+		for (auto& sceneModel : sceneModels) {
+			if (sceneModel.name == name) {
+				return sceneModel;
+			}
+		}
+		throw std::runtime_error("unknown scene model: " + name);
+	}
+
+	uint32_t FirstApp::sceneModelIndex(const VefpModel* model) const {
+		for (uint32_t i = 0; i < sceneModels.size(); i++) {
+			// entities with levels of detail may hold any of the levels
+			if (sceneModels[i].model.get() == model || (sceneModels[i].lod && sceneModels[i].lod->containsModel(model))) {
+				return i;
+			}
+		}
+		throw std::runtime_error("model is not a scene model!");
 	}
 
 }
\ No newline at end of file
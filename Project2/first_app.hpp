@@ -3,28 +3,144 @@
 #include "vefp_window.hpp"
 #include "vefp_device.hpp"
 #include "vefp_swap_chain.hpp"
-#include "vefp_app_object.hpp"
+#include "vefp_components.hpp"
 #include "vefp_renderer.hpp"
+#include "vefp_frame_pacer.hpp"
+#include "vefp_upload_service.hpp"
+#include "vefp_scene_snapshot.hpp"
+#include "vefp_trajectory.hpp"
+#include "vefp_simulation_thread.hpp"
+#include "vefp_task_graph.hpp"
+#include "physics_and_field.hpp"
+#include "simple_render_system.hpp"
 
+#include <atomic>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace vefp {
 	class FirstApp {
 	 private:
-		void loadAppObjects();
+		// models scenes can refer to by name
+		struct SceneModel {
+			std::string name;
+			std::shared_ptr<VefpModel> model;
+			// set when the model has levels of detail, model is then the finest level
+			std::shared_ptr<VefpLodModel> lod;
+		};
+
+		// loads the snapshot at scenePath, or the built in scene when it is empty
+		void loadAppObjects(const std::string& scenePath);
+		void loadDefaultScene();
+		void loadSnapshot(const std::string& filepath);
+		void spawnFieldGrid(const VefpSceneSnapshot::FieldGrid& grid);
+		// gives the entity a LodComponent if the scene model has levels of detail
+		void attachLod(EntityId entity, uint32_t sceneModel);
+		void saveCheckpoint();
+		void handleCheckpointControls();
+		void handleFieldViewControls();
+		// copies the bodies of the world into the first simulation state
+		VefpSimulationThread::Snapshot captureBodies();
+		// runs on the simulation thread, which owns the trajectory recorder and reader while it runs
+		void simulateStep(GravityPhysicsSystem& gravitySystem, VefpSimulationThread::Snapshot& state, float timeStep);
+		// moves the bodies to where the trajectory has them after timeStep more seconds of replay
+		void replayTrajectory(VefpSimulationThread::Snapshot& state, float timeStep);
+		void applySnapshot(const VefpSimulationThread::Snapshot& snapshot);
+		void handleReplayControls();
+		const SceneModel& findSceneModel(const std::string& name) const;
+		uint32_t sceneModelIndex(const VefpModel* model) const;
+		void handleLatencyControls();
+		void reportFrameStats(
+			const VefpTaskGraph::Stats& updateStats,
+			const RenderStats& renderStats,
+			// empty while the cpu does not evaluate the field
+			const std::optional<Vec2FieldSystem::Stats>& fieldStats);
+		// debug builds log frames that allocated once nothing has changed for ALLOCATION_SETTLE_FRAMES
+		void checkFrameAllocations(uint64_t frameAllocations);
+		// for changes that are expected to allocate, e.g. growing buffers for a different view
+		void resetAllocationCheck() { allocationSettleFrames = ALLOCATION_SETTLE_FRAMES; }
 		
 		VefpWindow vefpWindow{WIDTH, HEIGHT, "Vulkan Engine For Practice"};
 		VefpDevice vefpDevice{ vefpWindow };
-		VefpRenderer vefpRenderer{ vefpWindow, vefpDevice };
+		VefpRenderer vefpRenderer;
+		VefpFramePacer framePacer;
+		uint64_t lastAllocationCount = 0;
+		uint32_t allocationSettleFrames = ALLOCATION_SETTLE_FRAMES;
+		// what the frames were checked with, changing any of it reallocates
+		uint64_t checkedSceneVersion = 0;
+		VkExtent2D checkedExtent{};
+		VkPresentModeKHR checkedPresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+		std::string checkpointPath;
+		bool checkpointKeyDown = false;
+		// saved once the systems of the frame are done with the world
+		bool checkpointRequested = false;
+		bool pipelineUpdates = true;
+		uint32_t updateWorkers = 0;
+		Vec2FieldSystem::Settings fieldSettings{};
+		bool showFieldHeatmap = false;
+		bool heatmapKeyDown = false;
+
+		std::unique_ptr<VefpTrajectoryRecorder> trajectoryRecorder;
+		std::unique_ptr<VefpTrajectoryReader> trajectoryReplay;
+		float replaySpeed = 1.f;
+		double replayTime = 0.0;
+		int replaySeekKeyDown = 0;
+		// seeks requested by the input, taken by the next simulation step
+		std::atomic<int> replaySeeks{ 0 };
+		// bodies never change mass, so only the simulation state carries positions and velocities
+		std::vector<float> bodyMasses;
+		VefpUploadService uploadService{ vefpDevice };
 
-		std::vector<VefpAppObject> appObjects;
+		// declared after everything the components reference so models are released first
+		std::vector<SceneModel> sceneModels;
+		std::vector<VefpSceneSnapshot::FieldGrid> fieldGrids;
+		VefpWorld world;
 
 	public:
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
+		static constexpr double MINIMIZED_POLL_INTERVAL = 0.1;
+		static constexpr float SIMULATION_TIME_STEP = 1.f / 60;
+		static constexpr double REPLAY_SEEK_SECONDS = 5.0;
+		// how far circle outlines may deviate from a true circle on screen before a finer level is used
+		static constexpr float LOD_TOLERANCE_PIXELS = 0.5f;
+		// frames after startup or a change until the heap allocations of a frame are expected to stop
+		static constexpr uint32_t ALLOCATION_SETTLE_FRAMES = 240;
+
+		struct Settings {
+			// more frames in flight trade input latency for cpu/gpu overlap
+			uint32_t framesInFlight = VefpSwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+			// can also be switched at runtime with keys 1-4 (fifo, fifo relaxed, mailbox, immediate)
+			VkPresentModeKHR presentMode = VefpSwapChain::DEFAULT_PRESENT_MODE;
+			// 0 disables the frame limiter
+			float targetFps = 0.f;
+			// scene snapshot to start from, empty for the built in scene
+			std::string scenePath;
+			// F5 writes the current scene here, start with it as scenePath to restart from the checkpoint
+			std::string checkpointPath = "checkpoint.vsnap";
+			// records every simulation step of the bodies when set
+			std::string recordPath;
+			// plays a recorded trajectory instead of simulating, left and right arrow keys seek
+			std::string replayPath;
+			float replaySpeed = 1.f;
+			// gpu frame time to hold by lowering the render resolution, 0 always renders at full resolution
+			float gpuBudgetMs = 0.f;
+			// how the cpu evaluates the vector field when it is not computed on the gpu
+			Vec2FieldSystem::Method fieldMethod = Vec2FieldSystem::Method::Automatic;
+			float fieldErrorTolerance = 1e-3f;
+			// draws the field per pixel behind the scene instead of as arrows, H toggles it at runtime
+			bool fieldHeatmap = false;
+			// runs the next frame's systems while the current one is submitted and presented, input
+			// then reaches them a frame later. Needs more than one frame in flight.
+			bool pipelineUpdates = true;
+			// threads running the systems besides the render thread, 0 picks from the hardware
+			uint32_t updateWorkers = 0;
+		};
 
 		FirstApp();
+		explicit FirstApp(const Settings& settings);
 		~FirstApp();
 
 		FirstApp(const FirstApp&) = delete;
@@ -32,6 +148,8 @@ namespace vefp {
 
 		std::unique_ptr<VefpModel> createSquareModel(VefpDevice& device, glm::vec2 offset);
 		std::unique_ptr<VefpModel> createCircleModel(VefpDevice& device, unsigned int numSides);
+		// circle levels halve the side count from maxSides down to minSides
+		std::shared_ptr<VefpLodModel> createCircleLodModel(VefpDevice& device, unsigned int maxSides, unsigned int minSides);
 
 		void run();
 	};
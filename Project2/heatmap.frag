@@ -0,0 +1,40 @@
+#version 450
+
+layout(location = 0) in vec2 clipPosition;
+
+layout(location = 0) out vec4 outColor;
+
+// xy position, z mass
+layout(std430, set = 0, binding = 0) readonly buffer BodyBuffer { vec4 bodies[]; };
+
+layout(push_constant) uniform Push {
+	vec2 viewCenter;
+	vec2 viewHalfExtent;
+	float strengthGravity;
+	uint bodyCount;
+} push;
+
+vec3 hueToRgb(float hue) {
+	return clamp(abs(fract(hue + vec3(0.0, 2.0 / 3.0, 1.0 / 3.0)) * 6.0 - 3.0) - 1.0, 0.0, 1.0);
+}
+
+void main() {
+	// same force as GravityPhysicsSystem::computeForce on a unit mass at this pixel
+	vec2 position = push.viewCenter + clipPosition * push.viewHalfExtent;
+	vec2 direction = vec2(0.0);
+	for (uint i = 0; i < push.bodyCount; i++) {
+		vec2 offset = bodies[i].xy - position;
+		float distanceSquared = dot(offset, offset);
+		if (distanceSquared < 1e-10) {
+			continue;
+		}
+		float force = push.strengthGravity * bodies[i].z / distanceSquared;
+		direction += force * offset / sqrt(distanceSquared);
+	}
+
+	// hue follows the direction, brightness the magnitude with the mapping the field arrows use,
+	// kept dim so the scene drawn on top stays readable
+	float magnitude = clamp(log(length(direction) + 1.0) / 3.0, 0.0, 1.0);
+	float hue = atan(direction.y, direction.x) / 6.28318530718 + 0.5;
+	outColor = vec4(hueToRgb(hue) * magnitude * 0.6, 1.0);
+}
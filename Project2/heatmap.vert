@@ -0,0 +1,10 @@
+#version 450
+
+// one triangle covering the whole viewport, drawn without any vertex input
+layout(location = 0) out vec2 clipPosition;
+
+void main() {
+	vec2 corner = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	clipPosition = corner * 2.0 - 1.0;
+	gl_Position = vec4(clipPosition, 0.0, 1.0);
+}
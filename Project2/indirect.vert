@@ -0,0 +1,37 @@
+#version 450
+
+// only the position is read, one pipeline per vertex layout feeds it from any VefpVertexLayout
+layout(location = 0) in vec2 position;
+
+layout(location = 0) out vec3 fragColor;
+
+// VefpPackedInstance
+struct ObjectData {
+	uint offset;
+	uint scale;
+	uint rotationBatch;
+	uint color;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+mat2 objectTransform(ObjectData obj) {
+	float angle = float(obj.rotationBatch & 0xffffu) * (6.28318530718 / 65536.0);
+	vec2 scale = unpackHalf2x16(obj.scale);
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(vec2(c, s) * scale.x, vec2(-s, c) * scale.y);
+}
+
+layout(push_constant) uniform Push {
+	vec2 viewCenter;
+	vec2 viewInvHalfExtent;
+	float positionScale;  // VefpModel::getPositionScale of the batch
+} push;
+
+void main() {
+	ObjectData obj = objects[gl_InstanceIndex];
+	vec2 world = objectTransform(obj) * (position * push.positionScale) + unpackHalf2x16(obj.offset);
+	gl_Position = vec4((world - push.viewCenter) * push.viewInvHalfExtent, 0.0, 1.0);
+	fragColor = unpackUnorm4x8(obj.color).rgb;
+}
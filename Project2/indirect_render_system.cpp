@@ -0,0 +1,397 @@
+#include "indirect_render_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <stdexcept>
+
+namespace vefp {
+
+	// std430 layouts shared with cull.comp and indirect.vert
+	struct GpuBatchData {
+		glm::vec4 localBounds;  // min.xy, max.xy
+		uint32_t firstObject;
+		uint32_t vertexCount;
+		uint32_t objectCount;
+		uint32_t padding;
+	};
+	static_assert(sizeof(GpuBatchData) == 32, "GpuBatchData must match BatchData in cull.comp");
+
+	struct CullPushConstantData {
+		glm::vec4 viewBounds;  // min.xy, max.xy
+		uint32_t objectCount;
+		uint32_t compact;
+	};
+
+	struct IndirectPushConstantData {
+		glm::vec2 viewCenter;
+		glm::vec2 viewInvHalfExtent;
+		float positionScale;
+	};
+
+	static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+	IndirectRenderSystem::IndirectRenderSystem(
+		VefpDevice& device,
+		VkRenderPass renderPass,
+		uint32_t framesInFlight,
+		uint32_t maxObjectCount)
+		: vefpDevice{ device },
+		maxObjects{ maxObjectCount },
+		compactDraws{ device.supportsDrawIndirectCount() },
+		renderPass{ renderPass },
+		frames{ framesInFlight } {
+		assert(vefpDevice.supportsGpuDrivenRendering() && "Device does not support gpu driven rendering");
+		createDescriptorSetLayout();
+		createPipelineLayouts();
+		createPipelines();
+		createFrameResources();
+		createDescriptorSets();
+	}
+
+	IndirectRenderSystem::~IndirectRenderSystem() {
+		for (auto& frame : frames) {
+			vkUnmapMemory(vefpDevice.device(), frame.objectBufferMemory);
+			vkUnmapMemory(vefpDevice.device(), frame.batchBufferMemory);
+
+			vkDestroyBuffer(vefpDevice.device(), frame.objectBuffer, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.objectBufferMemory, nullptr);
+			vkDestroyBuffer(vefpDevice.device(), frame.batchBuffer, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.batchBufferMemory, nullptr);
+			vkDestroyBuffer(vefpDevice.device(), frame.drawCommandBuffer, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.drawCommandBufferMemory, nullptr);
+			vkDestroyBuffer(vefpDevice.device(), frame.drawCountBuffer, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.drawCountBufferMemory, nullptr);
+		}
+
+		vkDestroyDescriptorPool(vefpDevice.device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(vefpDevice.device(), graphicsPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(vefpDevice.device(), cullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(vefpDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void IndirectRenderSystem::createDescriptorSetLayout() {
+		// 0: objects, 1: batches, 2: draw commands, 3: draw counts
+		std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(vefpDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+	}
+
+	void IndirectRenderSystem::createPipelineLayouts() {
+		VkPushConstantRange graphicsPushConstantRange{};
+		graphicsPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		graphicsPushConstantRange.offset = 0;
+		graphicsPushConstantRange.size = sizeof(IndirectPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &graphicsPushConstantRange;
+		if (vkCreatePipelineLayout(vefpDevice.device(), &pipelineLayoutInfo, nullptr, &graphicsPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+
+		VkPushConstantRange cullPushConstantRange{};
+		cullPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		cullPushConstantRange.offset = 0;
+		cullPushConstantRange.size = sizeof(CullPushConstantData);
+
+		pipelineLayoutInfo.pPushConstantRanges = &cullPushConstantRange;
+		if (vkCreatePipelineLayout(vefpDevice.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void IndirectRenderSystem::createPipelines() {
+		getGraphicsPipeline(VefpVertexLayout{});
+		cullPipeline = std::make_unique<VefpComputePipeline>(vefpDevice, "cull_comp.spv", cullPipelineLayout);
+	}
+
+	VefpPipeline& IndirectRenderSystem::getGraphicsPipeline(const VefpVertexLayout& layout) {
+		for (auto& [vertexLayout, pipeline] : graphicsPipelines) {
+			if (vertexLayout == layout) {
+				return *pipeline;
+			}
+		}
+
+		// the shaders only read positions, the layout just decides the vertex input state
+		PipelineConfigInfo pipelineConfig{};
+		VefpPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		VefpPipeline::setVertexLayout(pipelineConfig, layout);
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = graphicsPipelineLayout;
+		graphicsPipelines.emplace_back(layout, std::make_unique<VefpPipeline>(
+			vefpDevice,
+			"indirect_vert.spv",
+			"indirect_frag.spv",
+			pipelineConfig));
+		return *graphicsPipelines.back().second;
+	}
+
+	void IndirectRenderSystem::createFrameResources() {
+		for (auto& frame : frames) {
+			vefpDevice.createBuffer(
+				sizeof(VefpPackedInstance) * maxObjects,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				frame.objectBuffer,
+				frame.objectBufferMemory,
+				true);
+			vkMapMemory(vefpDevice.device(), frame.objectBufferMemory, 0, VK_WHOLE_SIZE, 0, &frame.mappedObjects);
+
+			vefpDevice.createBuffer(
+				sizeof(GpuBatchData) * MAX_BATCHES,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				frame.batchBuffer,
+				frame.batchBufferMemory);
+			vkMapMemory(vefpDevice.device(), frame.batchBufferMemory, 0, VK_WHOLE_SIZE, 0, &frame.mappedBatches);
+
+			vefpDevice.createBuffer(
+				sizeof(VkDrawIndirectCommand) * maxObjects,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				frame.drawCommandBuffer,
+				frame.drawCommandBufferMemory);
+
+			vefpDevice.createBuffer(
+				sizeof(uint32_t) * MAX_BATCHES,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				frame.drawCountBuffer,
+				frame.drawCountBufferMemory);
+		}
+	}
+
+	void IndirectRenderSystem::createDescriptorSets() {
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = static_cast<uint32_t>(4 * frames.size());
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = static_cast<uint32_t>(frames.size());
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(vefpDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		for (auto& frame : frames) {
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &descriptorSetLayout;
+			if (vkAllocateDescriptorSets(vefpDevice.device(), &allocInfo, &frame.descriptorSet) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+
+			std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+			bufferInfos[0] = { frame.objectBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[1] = { frame.batchBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[2] = { frame.drawCommandBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[3] = { frame.drawCountBuffer, 0, VK_WHOLE_SIZE };
+
+			std::array<VkWriteDescriptorSet, 4> writes{};
+			for (uint32_t i = 0; i < writes.size(); i++) {
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = frame.descriptorSet;
+				writes[i].dstBinding = i;
+				writes[i].descriptorCount = 1;
+				writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+			vkUpdateDescriptorSets(vefpDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+	}
+
+	void IndirectRenderSystem::updateObjects(int frameIndex, RenderQuery& entities, uint64_t version) {
+		static_assert(MAX_BATCHES <= VefpPackedInstance::MAX_BATCHES, "Batch index must fit into the packed instance");
+		auto& frame = frames[frameIndex];
+		if (frame.objectsVersion == version) {
+			return;
+		}
+
+		objectItems.clear();
+		entities.each([&](Transform2dComponent& transform, WorldTransform2dComponent&, ModelComponent& model, ColorComponent& color) {
+			objectItems.push_back({ transform, color.color, model.model.get() });
+		});
+		if (objectItems.size() > maxObjects) {
+			throw std::runtime_error("too many objects for indirect render system!");
+		}
+
+		// one batch per distinct model, objects of a batch are stored contiguously
+		frame.batchModels.clear();
+		frame.batchObjectCount.clear();
+		modelBatches.clear();
+		objectBatch.resize(objectItems.size());
+		for (size_t i = 0; i < objectItems.size(); i++) {
+			VefpModel* model = objectItems[i].model;
+			auto [batchIter, added] = modelBatches.try_emplace(model, static_cast<uint32_t>(frame.batchModels.size()));
+			if (added) {
+				if (frame.batchModels.size() == MAX_BATCHES) {
+					throw std::runtime_error("too many distinct models for indirect render system!");
+				}
+				frame.batchModels.push_back(model);
+				frame.batchObjectCount.push_back(0);
+			}
+			uint32_t batch = batchIter->second;
+			frame.batchObjectCount[batch]++;
+			objectBatch[i] = batch;
+		}
+
+		std::array<uint32_t, MAX_BATCHES> cursor{};
+		frame.batchFirstObject.resize(frame.batchModels.size());
+		uint32_t firstObject = 0;
+		for (size_t b = 0; b < frame.batchModels.size(); b++) {
+			frame.batchFirstObject[b] = firstObject;
+			cursor[b] = firstObject;
+			firstObject += frame.batchObjectCount[b];
+		}
+
+		auto* objects = static_cast<VefpPackedInstance*>(frame.mappedObjects);
+		for (size_t i = 0; i < objectItems.size(); i++) {
+			const ObjectItem& item = objectItems[i];
+			objects[cursor[objectBatch[i]]++] = VefpPackedInstance::pack(item.transform, item.color, objectBatch[i]);
+		}
+
+		auto* batches = static_cast<GpuBatchData*>(frame.mappedBatches);
+		for (size_t b = 0; b < frame.batchModels.size(); b++) {
+			const Aabb2d& bounds = frame.batchModels[b]->getBounds();
+
+			GpuBatchData data{};
+			data.localBounds = glm::vec4(bounds.min, bounds.max);
+			data.firstObject = frame.batchFirstObject[b];
+			data.vertexCount = frame.batchModels[b]->getVertexCount();
+			data.objectCount = frame.batchObjectCount[b];
+			batches[b] = data;
+		}
+
+		frame.objectCount = static_cast<uint32_t>(objectItems.size());
+		frame.objectsVersion = version;
+	}
+
+	void IndirectRenderSystem::resetDrawCount(VkCommandBuffer commandBuffer, int frameIndex) {
+		auto& frame = frames[frameIndex];
+		if (frame.objectCount == 0) {
+			return;
+		}
+		vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+	}
+
+	void IndirectRenderSystem::cullObjects(VkCommandBuffer commandBuffer, int frameIndex, const VefpCamera2d& camera) {
+		auto& frame = frames[frameIndex];
+		if (frame.objectCount == 0) {
+			return;
+		}
+
+		cullPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			cullPipelineLayout,
+			0,
+			1,
+			&frame.descriptorSet,
+			0,
+			nullptr);
+
+		Aabb2d view = camera.getViewBounds();
+		CullPushConstantData push{};
+		push.viewBounds = glm::vec4(view.min, view.max);
+		push.objectCount = frame.objectCount;
+		push.compact = compactDraws ? 1 : 0;
+		vkCmdPushConstants(
+			commandBuffer,
+			cullPipelineLayout,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0,
+			sizeof(CullPushConstantData),
+			&push);
+
+		vkCmdDispatch(commandBuffer, (frame.objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	}
+
+	void IndirectRenderSystem::renderObjects(VkCommandBuffer commandBuffer, int frameIndex, const VefpCamera2d& camera) {
+		auto& frame = frames[frameIndex];
+		if (frame.objectCount == 0) {
+			return;
+		}
+
+		// all pipelines share the layout, so the descriptor set stays bound across pipeline switches
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			graphicsPipelineLayout,
+			0,
+			1,
+			&frame.descriptorSet,
+			0,
+			nullptr);
+
+		IndirectPushConstantData push{};
+		push.viewCenter = camera.getCenter();
+		push.viewInvHalfExtent = 1.f / camera.getHalfExtent();
+
+		constexpr uint32_t stride = sizeof(VkDrawIndirectCommand);
+		const VefpVertexLayout* boundLayout = nullptr;
+		for (size_t b = 0; b < frame.batchModels.size(); b++) {
+			VefpModel* model = frame.batchModels[b];
+			const VefpVertexLayout& layout = model->getVertexLayout();
+			if (boundLayout == nullptr || *boundLayout != layout) {
+				getGraphicsPipeline(layout).bind(commandBuffer);
+				boundLayout = &layout;
+			}
+
+			push.positionScale = model->getPositionScale();
+			vkCmdPushConstants(
+				commandBuffer,
+				graphicsPipelineLayout,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(IndirectPushConstantData),
+				&push);
+			model->bind(commandBuffer);
+
+			const VkDeviceSize offset = frame.batchFirstObject[b] * stride;
+			const uint32_t drawCount = frame.batchObjectCount[b];
+			if (compactDraws) {
+				vefpDevice.cmdDrawIndirectCount(
+					commandBuffer,
+					frame.drawCommandBuffer,
+					offset,
+					frame.drawCountBuffer,
+					b * sizeof(uint32_t),
+					drawCount,
+					stride);
+			}
+			else if (vefpDevice.enabledFeatures().multiDrawIndirect) {
+				vkCmdDrawIndirect(commandBuffer, frame.drawCommandBuffer, offset, drawCount, stride);
+			}
+			else {
+				for (uint32_t i = 0; i < drawCount; i++) {
+					vkCmdDrawIndirect(commandBuffer, frame.drawCommandBuffer, offset + i * stride, 1, stride);
+				}
+			}
+		}
+	}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_pipeline.hpp"
+#include "vefp_components.hpp"
+#include "vefp_packed_instance.hpp"
+#include "vefp_camera.hpp"
+#include "vefp_frame_ring.hpp"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vefp {
+
+	// GPU driven counterpart of SimpleRenderSystem. Object data lives in a storage buffer, a compute
+	// pass culls it against the camera view and writes one indirect draw per surviving object, so
+	// recording a frame costs the same regardless of how many objects there are.
+	class IndirectRenderSystem {
+	private:
+		static constexpr uint32_t MAX_BATCHES = 64;
+
+		struct FrameResources {
+			VkBuffer objectBuffer;
+			VkDeviceMemory objectBufferMemory;
+			VkBuffer batchBuffer;
+			VkDeviceMemory batchBufferMemory;
+			VkBuffer drawCommandBuffer;
+			VkDeviceMemory drawCommandBufferMemory;
+			VkBuffer drawCountBuffer;
+			VkDeviceMemory drawCountBufferMemory;
+			VkDescriptorSet descriptorSet;
+
+			void* mappedObjects = nullptr;
+			void* mappedBatches = nullptr;
+
+			uint32_t objectCount = 0;
+			// version of the objects in the buffers, nothing has been uploaded while unset
+			std::optional<uint64_t> objectsVersion;
+			std::vector<VefpModel*> batchModels;
+			std::vector<uint32_t> batchFirstObject;
+			std::vector<uint32_t> batchObjectCount;
+		};
+
+		void createDescriptorSetLayout();
+		void createPipelineLayouts();
+		void createPipelines();
+		// graphics pipelines are created on first use, one per vertex layout the batches use
+		VefpPipeline& getGraphicsPipeline(const VefpVertexLayout& layout);
+		void createFrameResources();
+		void createDescriptorSets();
+
+		VefpDevice& vefpDevice;
+		const uint32_t maxObjects;
+		// without VK_KHR_draw_indirect_count every object keeps its slot and culled ones get instanceCount 0
+		const bool compactDraws;
+		VkRenderPass renderPass;
+
+		std::vector<std::pair<VefpVertexLayout, std::unique_ptr<VefpPipeline>>> graphicsPipelines;
+		std::unique_ptr<VefpComputePipeline> cullPipeline;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipelineLayout graphicsPipelineLayout;
+		VkPipelineLayout cullPipelineLayout;
+
+		VefpFrameRing<FrameResources> frames;
+		struct ObjectItem {
+			Transform2dComponent transform;
+			glm::vec3 color;
+			VefpModel* model;
+		};
+
+		std::vector<ObjectItem> objectItems;
+		std::vector<uint32_t> objectBatch;
+		std::unordered_map<VefpModel*, uint32_t> modelBatches;
+
+	public:
+
+		IndirectRenderSystem(VefpDevice& device, VkRenderPass renderPass, uint32_t framesInFlight, uint32_t maxObjects);
+		~IndirectRenderSystem();
+
+		IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+		IndirectRenderSystem& operator=(const IndirectRenderSystem&) = delete;
+
+		// Packs transforms and colors into the frame's object buffer. Each frame slot keeps its last
+		// upload, which is only redone when version differs from the one it was made with, so the
+		// caller's version has to move on whenever the matching entities or their models change.
+		// Anything else that changes per frame has to be written on the gpu, as FieldComputeSystem
+		// does. Objects are packed from their local transform, so they can not have a parent.
+		void updateObjects(int frameIndex, RenderQuery& entities, uint64_t version);
+		// object buffer of a frame slot, shared with the async compute queue
+		VkBuffer getObjectBuffer(int frameIndex) { return frames[frameIndex].objectBuffer; }
+		uint32_t getObjectCount(int frameIndex) { return frames[frameIndex].objectCount; }
+
+		// buffers cullObjects writes and renderObjects reads as indirect commands
+		VkBuffer getDrawCommandBuffer(int frameIndex) { return frames[frameIndex].drawCommandBuffer; }
+		VkBuffer getDrawCountBuffer(int frameIndex) { return frames[frameIndex].drawCountBuffer; }
+
+		// Both must be recorded outside of the render pass and place no barriers: culling has to wait
+		// for the transfer write of the reset, the draws for the compute writes to both draw buffers.
+		void resetDrawCount(VkCommandBuffer commandBuffer, int frameIndex);
+		void cullObjects(VkCommandBuffer commandBuffer, int frameIndex, const VefpCamera2d& camera);
+		void renderObjects(VkCommandBuffer commandBuffer, int frameIndex, const VefpCamera2d& camera);
+
+	};
+
+}
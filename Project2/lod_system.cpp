@@ -0,0 +1,36 @@
+#include "lod_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace vefp {
+
+	void LodSystem::update(VefpWorld& world, const VefpCamera2d& camera, VkExtent2D viewportExtent) {
+		stats = {};
+
+		// the camera may stretch one axis more than the other, size against the larger scale
+		const glm::vec2 pixelsPerUnit = glm::vec2(viewportExtent.width, viewportExtent.height) / (2.f * camera.getHalfExtent());
+		const float pixelScale = glm::max(pixelsPerUnit.x, pixelsPerUnit.y);
+
+		world.query<WorldTransform2dComponent, ModelComponent, LodComponent>().each(
+			[&](WorldTransform2dComponent& transform, ModelComponent& model, LodComponent& lod) {
+				// world scale along the local axes, includes the scale of any parents
+				const float scale = glm::max(glm::length(transform.matrix[0]), glm::length(transform.matrix[1]));
+				const float pixelSize = 2.f * lod.lod->getRadius() * scale * pixelScale;
+
+				const uint32_t level = lod.lod->selectLevel(pixelSize, lod.level);
+				// only touch the shared pointer when the level changes
+				if (level != lod.level || model.model != lod.lod->getModel(level)) {
+					model.model = lod.lod->getModel(level);
+					lod.level = level;
+					stats.switchedObjects++;
+				}
+				stats.lodObjects++;
+			});
+		if (stats.switchedObjects > 0) {
+			modelVersion++;
+		}
+	}
+
+}
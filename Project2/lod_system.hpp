@@ -0,0 +1,31 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_components.hpp"
+#include "vefp_camera.hpp"
+
+namespace vefp {
+
+	struct LodStats {
+		uint32_t lodObjects = 0;
+		uint32_t switchedObjects = 0;
+	};
+
+	// Picks the level of detail of every entity with a LodComponent from its diameter on screen.
+	// Runs after TransformSystem and before the render systems, which then just draw whatever
+	// ModelComponent holds.
+	class LodSystem {
+	public:
+		void update(VefpWorld& world, const VefpCamera2d& camera, VkExtent2D viewportExtent);
+
+		// counters of the last update
+		const LodStats& getStats() const { return stats; }
+		// moves on whenever an update switches the model of an entity
+		uint64_t getModelVersion() const { return modelVersion; }
+
+	private:
+		LodStats stats{};
+		uint64_t modelVersion = 0;
+	};
+
+}
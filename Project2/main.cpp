@@ -1,13 +1,89 @@
 #include "first_app.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-	vefp::FirstApp app{};
+int main(int argc, char* argv[]) {
+	vefp::FirstApp::Settings settings{};
+	for (int i = 1; i < argc; i++) {
+		// --heatmap is the only option without a value
+		if (std::strcmp(argv[i], "--heatmap") == 0) {
+			settings.fieldHeatmap = true;
+			continue;
+		}
+		if (i + 1 == argc) {
+			std::cerr << "ignoring option without a value: " << argv[i] << '\n';
+			break;
+		}
 
+		if (std::strcmp(argv[i], "--frames-in-flight") == 0) {
+			settings.framesInFlight = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (std::strcmp(argv[i], "--fps") == 0) {
+			settings.targetFps = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--scene") == 0) {
+			settings.scenePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--checkpoint") == 0) {
+			settings.checkpointPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--record") == 0) {
+			settings.recordPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay") == 0) {
+			settings.replayPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay-speed") == 0) {
+			settings.replaySpeed = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--gpu-budget") == 0) {
+			settings.gpuBudgetMs = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--field-method") == 0) {
+			const char* method = argv[++i];
+			if (std::strcmp(method, "direct") == 0) {
+				settings.fieldMethod = vefp::Vec2FieldSystem::Method::Direct;
+			}
+			else if (std::strcmp(method, "multipole") == 0) {
+				settings.fieldMethod = vefp::Vec2FieldSystem::Method::Multipole;
+			}
+			else if (std::strcmp(method, "auto") == 0) {
+				settings.fieldMethod = vefp::Vec2FieldSystem::Method::Automatic;
+			}
+		}
+		else if (std::strcmp(argv[i], "--field-tolerance") == 0) {
+			settings.fieldErrorTolerance = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--pipeline-updates") == 0) {
+			settings.pipelineUpdates = std::strcmp(argv[++i], "off") != 0;
+		}
+		else if (std::strcmp(argv[i], "--update-workers") == 0) {
+			settings.updateWorkers = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+		}
+		else if (std::strcmp(argv[i], "--present-mode") == 0) {
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "fifo") == 0) {
+				settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+			}
+			else if (std::strcmp(mode, "fifo-relaxed") == 0) {
+				settings.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			}
+			else if (std::strcmp(mode, "mailbox") == 0) {
+				settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			}
+			else if (std::strcmp(mode, "immediate") == 0) {
+				settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			}
+		}
+	}
+
+	// the constructor loads --scene and --replay files, so it can fail like run()
 	try {
+		vefp::FirstApp app{ settings };
 		app.run();
 	}
 	catch (const std::exception& e) {
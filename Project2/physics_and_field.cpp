@@ -1,27 +1,35 @@
 #include "physics_and_field.hpp";
 #include "simple_render_system.hpp"
+#include "vefp_parallel.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <limits>
 #include <stdexcept>
 
 namespace vefp {
 
-	void GravityPhysicsSystem::update(std::vector<VefpAppObject>& objs, float dt, unsigned int substeps) {
-	
+	void GravityPhysicsSystem::update(
+		std::span<glm::vec2> bodyPositions,
+		std::span<glm::vec2> bodyVelocities,
+		std::span<const float> bodyMasses,
+		float dt,
+		unsigned int substeps) {
+		assert(bodyPositions.size() == bodyVelocities.size() && bodyPositions.size() == bodyMasses.size() && "Body arrays differ in size");
 		const float stepDelta = dt / substeps;
-		for (int i = 0; i < substeps; ++i) {
-			stepSimulation(objs, stepDelta);
+		for (unsigned int i = 0; i < substeps; ++i) {
+			stepSimulation(bodyPositions, bodyVelocities, bodyMasses, stepDelta);
 		}
 	}
 
-	glm::vec2 GravityPhysicsSystem::computeForce(VefpAppObject& fromObj, VefpAppObject& toObj) const {
-		auto offset = fromObj.transform2d.translation - toObj.transform2d.translation;
+	glm::vec2 GravityPhysicsSystem::computeForce(glm::vec2 fromPosition, float fromMass, glm::vec2 toPosition, float toMass) const {
+		auto offset = fromPosition - toPosition;
 		float distranceSquared = glm::dot(offset, offset);
 
 
@@ -30,44 +38,290 @@ namespace vefp {
 			return { .0f, .0f };
 		}
 
-		float force = strengthGravity * toObj.rigidBody2d.mass * fromObj.rigidBody2d.mass / distranceSquared;
+		float force = strengthGravity * toMass * fromMass / distranceSquared;
 
 		return force * offset / glm::sqrt(distranceSquared);
 	}
 
-	void GravityPhysicsSystem::stepSimulation(std::vector<VefpAppObject>& physicsObjs, float dt) {
+	void GravityPhysicsSystem::stepSimulation(
+		std::span<glm::vec2> positions,
+		std::span<glm::vec2> velocities,
+		std::span<const float> masses,
+		float dt) {
 		// Loops through all pairs of objects and applies attractive force between them
-		for (auto iterA = physicsObjs.begin(); iterA != physicsObjs.end(); ++iterA) {
-			auto& objA = *iterA;
-			for (auto iterB = iterA; iterB != physicsObjs.end(); ++iterB) {
-				if (iterA == iterB) continue;
-				auto& objB = *iterB;
-
-				auto force = computeForce(objA, objB);
-				objA.rigidBody2d.velocity += dt * -force / objA.rigidBody2d.mass;
-				objB.rigidBody2d.velocity += dt * force / objB.rigidBody2d.mass;
+		const size_t count = positions.size();
+		for (size_t a = 0; a < count; ++a) {
+			for (size_t b = a + 1; b < count; ++b) {
+				auto force = computeForce(positions[a], masses[a], positions[b], masses[b]);
+				velocities[a] += dt * -force / masses[a];
+				velocities[b] += dt * force / masses[b];
 			}
 		}
 
-		for (auto& obj : physicsObjs) {
-			obj.transform2d.translation += dt * obj.rigidBody2d.velocity;
+		for (size_t i = 0; i < count; ++i) {
+			positions[i] += dt * velocities[i];
 		}
 	}
 
-	void Vec2FieldSystem::update(
-		const GravityPhysicsSystem& physicsSystem,
-		std::vector<VefpAppObject>& physicsObjs,
-		std::vector<VefpAppObject>& vectorField) 
-	{
-		for (auto& vf : vectorField) {
-			glm::vec2 direction{};
-			for (auto& obj : physicsObjs) {
-				direction += physicsSystem.computeForce(obj, vf);
+	Vec2FieldSystem::Vec2FieldSystem(const Settings& settings) : settings{ settings }, fmm{ settings.multipole } {}
+
+	void Vec2FieldSystem::update(const GravityPhysicsSystem& physicsSystem, VefpWorld& world, std::pmr::memory_resource* scratch) {
+		bodyPositions.clear();
+		bodyMasses.clear();
+		world.query<Transform2dComponent, RigidBody2dComponent>().each(
+			[&](Transform2dComponent& transform, RigidBody2dComponent& rigidBody) {
+				bodyPositions.push_back(transform.translation);
+				bodyMasses.push_back(rigidBody.mass);
+			});
+
+		switch (settings.method) {
+		case Method::Direct:
+			multipoleUsed = false;
+			break;
+		case Method::Multipole:
+			multipoleUsed = true;
+			break;
+		case Method::Automatic: {
+			const uint64_t interactions = static_cast<uint64_t>(bodyPositions.size())
+				* world.query<Transform2dComponent>().with<FieldPointComponent>().count();
+			multipoleUsed = interactions > settings.multipoleThreshold;
+			break;
+		}
+		}
+
+		if (multipoleUsed) {
+			updateMultipole(physicsSystem, world);
+		}
+		else if (settings.incremental) {
+			updateIncremental(physicsSystem, world);
+			return;
+		}
+		else {
+			updateDirect(physicsSystem, world, scratch);
+		}
+		// the other paths do not keep the incremental state up to date
+		incrementalValid = false;
+	}
+
+	void Vec2FieldSystem::updateDirect(const GravityPhysicsSystem& physicsSystem, VefpWorld& world, std::pmr::memory_resource* scratch) {
+		// every field point only depends on the bodies, so chunks are evaluated in parallel
+		auto fieldPoints = world.query<Transform2dComponent>().with<FieldPointComponent>();
+		evaluatedPoints = fieldPoints.count();
+		fieldPoints.parallelEachChunk(
+			[&](uint32_t count, Transform2dComponent* transforms) {
+				for (uint32_t i = 0; i < count; i++) {
+					auto& transform = transforms[i];
+					glm::vec2 direction{};
+					for (size_t body = 0; body < bodyPositions.size(); body++) {
+						direction += physicsSystem.computeForce(bodyPositions[body], bodyMasses[body], transform.translation, 1.f);
+					}
+					orientArrow(transform, direction);
+				}
+			},
+			scratch);
+	}
+
+	void Vec2FieldSystem::updateMultipole(const GravityPhysicsSystem& physicsSystem, VefpWorld& world) {
+		// the evaluator works on all points at once, positions go out and forces come back in query order
+		auto fieldPoints = world.query<Transform2dComponent>().with<FieldPointComponent>();
+		fieldPositions.clear();
+		fieldPoints.each([&](Transform2dComponent& transform) {
+			fieldPositions.push_back(transform.translation);
+		});
+		fieldValues.resize(fieldPositions.size());
+
+		fmm.evaluate(bodyPositions, bodyMasses, fieldPositions, physicsSystem.strengthGravity, fieldValues);
+		evaluatedPoints = static_cast<uint32_t>(fieldPositions.size());
+
+		// the first evaluation is always verified
+		if (updatesSinceVerify == 0) {
+			verifyMultipole(physicsSystem.strengthGravity);
+		}
+		updatesSinceVerify = (updatesSinceVerify + 1) % std::max(settings.verifyInterval, 1u);
+
+		size_t i = 0;
+		fieldPoints.each([&](Transform2dComponent& transform) {
+			orientArrow(transform, fieldValues[i++]);
+		});
+	}
+
+	void Vec2FieldSystem::verifyMultipole(float strength) {
+		measuredError = VefpFmmEvaluator::measureError(
+			bodyPositions, bodyMasses, fieldPositions, strength, fieldValues, settings.verifySamples);
+
+		// every order shrinks the error about twofold, so one order lower is safe below a quarter
+		const uint32_t order = fmm.getOrder();
+		if (measuredError > settings.errorTolerance && order < VefpFmmEvaluator::MAX_ORDER) {
+			fmm.setOrder(order + 1);
+		}
+		else if (measuredError < settings.errorTolerance * 0.25f && order > settings.multipole.order) {
+			fmm.setOrder(order - 1);
+		}
+	}
+
+	void Vec2FieldSystem::updateIncremental(const GravityPhysicsSystem& physicsSystem, VefpWorld& world) {
+		const float strength = physicsSystem.strengthGravity;
+		auto fieldPoints = world.query<Transform2dComponent>().with<FieldPointComponent>();
+
+		// field points are expected to stay put, any that moved invalidate the tiles
+		const uint32_t pointCount = fieldPoints.count();
+		bool pointsMoved = pointCount != fieldPositions.size();
+		fieldPositions.resize(pointCount);
+		fieldValues.resize(pointCount);
+		size_t i = 0;
+		fieldPoints.each([&](Transform2dComponent& transform) {
+			if (fieldPositions[i] != transform.translation) {
+				fieldPositions[i] = transform.translation;
+				pointsMoved = true;
 			}
+			i++;
+		});
+		if (pointsMoved) {
+			buildTiles();
+		}
 
-			vf.transform2d.scale.x = 0.005f + 0.045f * glm::clamp(glm::log(glm::length(direction) + 1) / 3.f, 0.f, 1.f);
-			vf.transform2d.rotation = atan2(direction.y, direction.x);
+		// a change of the bodies themselves or of the gravity constant can not be bounded
+		const bool fullUpdate = !incrementalValid
+			|| pointsMoved
+			|| bodyMasses != evaluatedMasses
+			|| strength != evaluatedStrength;
+		const uint32_t tileCount = static_cast<uint32_t>(tiles.size());
+		tileEvaluated.assign(tileCount, fullUpdate ? 1 : 0);
+		if (!fullUpdate) {
+			boundFieldChanges(strength);
+			for (uint32_t tile = 0; tile < tileCount; tile++) {
+				if (tiles[tile].changeBound > settings.changeTolerance * tiles[tile].minMagnitude) {
+					tileEvaluated[tile] = 1;
+				}
+			}
+
+			// amortized refresh, every tile is evaluated once per refreshFrames updates even if nothing moved
+			const uint32_t refreshFrames = std::max(settings.refreshFrames, 1u);
+			const uint32_t refreshCount = (tileCount + refreshFrames - 1) / refreshFrames;
+			for (uint32_t refreshed = 0; refreshed < refreshCount && tileCount > 0; refreshed++) {
+				tileEvaluated[nextRefreshTile] = 1;
+				nextRefreshTile = (nextRefreshTile + 1) % tileCount;
+			}
 		}
+
+		staleTiles.clear();
+		for (uint32_t tile = 0; tile < tileCount; tile++) {
+			if (tileEvaluated[tile]) {
+				staleTiles.push_back(tile);
+			}
+		}
+		VefpParallel::forEach(staleTiles.begin(), staleTiles.end(), [&](uint32_t tile) {
+			float minMagnitude = std::numeric_limits<float>::max();
+			for (uint32_t index = tileStart[tile]; index < tileStart[tile + 1]; index++) {
+				const uint32_t point = tilePoints[index];
+				glm::vec2 direction{};
+				for (size_t body = 0; body < bodyPositions.size(); body++) {
+					direction += physicsSystem.computeForce(bodyPositions[body], bodyMasses[body], fieldPositions[point], 1.f);
+				}
+				fieldValues[point] = direction;
+				minMagnitude = std::min(minMagnitude, glm::length(direction));
+			}
+			tiles[tile].minMagnitude = minMagnitude;
+			tiles[tile].changeBound = 0.f;
+		});
+
+		evaluatedPoints = 0;
+		for (uint32_t tile : staleTiles) {
+			evaluatedPoints += tileStart[tile + 1] - tileStart[tile];
+		}
+		previousBodyPositions = bodyPositions;
+		evaluatedMasses = bodyMasses;
+		evaluatedStrength = strength;
+		incrementalValid = true;
+
+		i = 0;
+		fieldPoints.each([&](Transform2dComponent& transform) {
+			if (tileEvaluated[pointTiles[i]]) {
+				orientArrow(transform, fieldValues[i]);
+			}
+			i++;
+		});
+	}
+
+	void Vec2FieldSystem::buildTiles() {
+		const uint32_t pointCount = static_cast<uint32_t>(fieldPositions.size());
+		glm::vec2 minBounds{ std::numeric_limits<float>::max() };
+		glm::vec2 maxBounds{ std::numeric_limits<float>::lowest() };
+		for (const glm::vec2& position : fieldPositions) {
+			minBounds = glm::min(minBounds, position);
+			maxBounds = glm::max(maxBounds, position);
+		}
+
+		// square grid over the bounds with about pointsPerTile points per tile for an even spread
+		const uint32_t tilesPerAxis = std::max(1u, static_cast<uint32_t>(
+			glm::ceil(glm::sqrt(static_cast<float>(pointCount) / std::max(settings.pointsPerTile, 1u)))));
+		const glm::vec2 tileSize = glm::max((maxBounds - minBounds) / static_cast<float>(tilesPerAxis), glm::vec2{ 1e-6f });
+		const uint32_t tileCount = pointCount > 0 ? tilesPerAxis * tilesPerAxis : 0;
+
+		// counting sort of the points into tiles
+		pointTiles.resize(pointCount);
+		tileStart.assign(tileCount + 1, 0);
+		for (uint32_t point = 0; point < pointCount; point++) {
+			const glm::uvec2 cell = glm::min(
+				glm::uvec2{ (fieldPositions[point] - minBounds) / tileSize },
+				glm::uvec2{ tilesPerAxis - 1 });
+			pointTiles[point] = cell.y * tilesPerAxis + cell.x;
+			tileStart[pointTiles[point] + 1]++;
+		}
+		for (uint32_t tile = 0; tile < tileCount; tile++) {
+			tileStart[tile + 1] += tileStart[tile];
+		}
+		tilePoints.resize(pointCount);
+		std::vector<uint32_t> fill(tileStart.begin(), tileStart.end() - (tileCount > 0 ? 1 : 0));
+		for (uint32_t point = 0; point < pointCount; point++) {
+			tilePoints[fill[pointTiles[point]]++] = point;
+		}
+
+		// bounding circle of the points actually in each tile
+		tiles.assign(tileCount, FieldTile{});
+		for (uint32_t tile = 0; tile < tileCount; tile++) {
+			glm::vec2 tileMin{ std::numeric_limits<float>::max() };
+			glm::vec2 tileMax{ std::numeric_limits<float>::lowest() };
+			for (uint32_t index = tileStart[tile]; index < tileStart[tile + 1]; index++) {
+				tileMin = glm::min(tileMin, fieldPositions[tilePoints[index]]);
+				tileMax = glm::max(tileMax, fieldPositions[tilePoints[index]]);
+			}
+			if (tileStart[tile] != tileStart[tile + 1]) {
+				tiles[tile].center = 0.5f * (tileMin + tileMax);
+				tiles[tile].radius = 0.5f * glm::length(tileMax - tileMin);
+			}
+		}
+		nextRefreshTile = 0;
+	}
+
+	void Vec2FieldSystem::boundFieldChanges(float strength) {
+		bodyDisplacements.resize(bodyPositions.size());
+		for (size_t body = 0; body < bodyPositions.size(); body++) {
+			bodyDisplacements[body] = glm::length(bodyPositions[body] - previousBodyPositions[body]);
+		}
+
+		// The derivative of m * r / |r|^3 with respect to the body position is at most 2m / |r|^3 in
+		// any direction. Along the path of a body that moved by d the distance to any point of a tile
+		// is at least its distance to the tile center minus d and the tile radius.
+		VefpParallel::forEach(tiles.begin(), tiles.end(), [&](FieldTile& tile) {
+			for (size_t body = 0; body < bodyPositions.size(); body++) {
+				const float displacement = bodyDisplacements[body];
+				if (displacement == 0.f) {
+					continue;
+				}
+				const float distance = glm::length(bodyPositions[body] - tile.center) - displacement - tile.radius;
+				if (distance <= 0.f) {
+					tile.changeBound = std::numeric_limits<float>::infinity();
+					return;
+				}
+				tile.changeBound += 2.f * strength * bodyMasses[body] * displacement / (distance * distance * distance);
+			}
+		});
+	}
+
+	void Vec2FieldSystem::orientArrow(Transform2dComponent& transform, glm::vec2 direction) {
+		transform.setScale({ 0.005f + 0.045f * glm::clamp(glm::log(glm::length(direction) + 1) / 3.f, 0.f, 1.f), transform.scale.y });
+		transform.setRotation(atan2(direction.y, direction.x));
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "simple_render_system.hpp"
+#include "vefp_fmm.hpp"
+
+#include <span>
 
 
 namespace vefp {
@@ -13,22 +16,108 @@ namespace vefp {
 
 	    const float strengthGravity;
 
-		void update(std::vector<VefpAppObject>& objs, float dt, unsigned int substeps);
-		glm::vec2 computeForce(VefpAppObject& fromObj, VefpAppObject& toObj) const;
+		// integrates bodies kept outside of a world, positions and velocities are updated in place
+		void update(std::span<glm::vec2> bodyPositions, std::span<glm::vec2> bodyVelocities, std::span<const float> bodyMasses, float dt, unsigned int substeps);
+		glm::vec2 computeForce(glm::vec2 fromPosition, float fromMass, glm::vec2 toPosition, float toMass) const;
 		
 	private:
 		
-		void stepSimulation(std::vector<VefpAppObject>& physicsObjs, float dt);
+		void stepSimulation(std::span<glm::vec2> positions, std::span<glm::vec2> velocities, std::span<const float> masses, float dt);
 
 	};
 
 	class Vec2FieldSystem {
 	
 	public:
-		void update(
-			const GravityPhysicsSystem& physicsSystem,
-			std::vector<VefpAppObject>& physicsObjs,
-			std::vector<VefpAppObject>& vectorField);
+		enum class Method {
+			Direct,
+			Multipole,
+			// multipole once bodies * field points passes multipoleThreshold
+			Automatic,
+		};
+
+		struct Settings {
+			Method method = Method::Automatic;
+			uint64_t multipoleThreshold = 1 << 20;
+			VefpFmmEvaluator::Settings multipole{};
+			// Every verifyInterval updates verifySamples field points are checked against the direct sum.
+			// The expansion order is raised while the error relative to the field there is above
+			// errorTolerance and lowered again once it is well below, never under multipole.order.
+			float errorTolerance = 1e-3f;
+			uint32_t verifyInterval = 120;
+			uint32_t verifySamples = 32;
+
+			// Direct evaluation only recomputes tiles of field points whose field may have changed by more
+			// than changeTolerance relative to its magnitude, bounded from how far each body moved.
+			// Every tile is refreshed at least once per refreshFrames updates regardless.
+			bool incremental = true;
+			float changeTolerance = 0.01f;
+			uint32_t refreshFrames = 60;
+			uint32_t pointsPerTile = 64;
+		};
+
+		Vec2FieldSystem() : Vec2FieldSystem(Settings{}) {}
+		// of the last update
+		struct Stats {
+			bool multipole = false;
+			uint32_t multipoleOrder = 0;
+			// of the last verification, 0 before the first one
+			float measuredError = 0.f;
+			uint32_t evaluatedPoints = 0;
+		};
+
+		explicit Vec2FieldSystem(const Settings& settings);
+
+		// orients every FieldPointComponent entity along the force a unit mass would feel there
+		void update(const GravityPhysicsSystem& physicsSystem, VefpWorld& world, std::pmr::memory_resource* scratch);
+
+		Stats getStats() const { return { multipoleUsed, fmm.getOrder(), measuredError, evaluatedPoints }; }
+
+	private:
+		struct FieldTile {
+			glm::vec2 center;
+			float radius;
+			// smallest field magnitude in the tile when it was last evaluated
+			float minMagnitude;
+			// how far the field in the tile may have drifted since
+			float changeBound;
+		};
+
+		void updateDirect(const GravityPhysicsSystem& physicsSystem, VefpWorld& world, std::pmr::memory_resource* scratch);
+		void updateMultipole(const GravityPhysicsSystem& physicsSystem, VefpWorld& world);
+		void verifyMultipole(float strength);
+		void updateIncremental(const GravityPhysicsSystem& physicsSystem, VefpWorld& world);
+		void buildTiles();
+		// adds the largest change the body movement since the last update can cause to every tile
+		void boundFieldChanges(float strength);
+
+		static void orientArrow(Transform2dComponent& transform, glm::vec2 direction);
+
+		const Settings settings;
+		VefpFmmEvaluator fmm;
+		bool multipoleUsed = false;
+		uint32_t updatesSinceVerify = 0;
+		float measuredError = 0.f;
+
+		std::vector<glm::vec2> bodyPositions;
+		std::vector<float> bodyMasses;
+		std::vector<glm::vec2> fieldPositions;
+		std::vector<glm::vec2> fieldValues;
+
+		// incremental evaluation, fieldValues hold the field as of each tile's last evaluation
+		bool incrementalValid = false;
+		uint32_t evaluatedPoints = 0;
+		uint32_t nextRefreshTile = 0;
+		float evaluatedStrength = 0.f;
+		std::vector<glm::vec2> previousBodyPositions;
+		std::vector<float> evaluatedMasses;
+		std::vector<float> bodyDisplacements;
+		std::vector<FieldTile> tiles;
+		std::vector<uint32_t> tileStart;
+		std::vector<uint32_t> tilePoints;
+		std::vector<uint32_t> pointTiles;
+		std::vector<uint32_t> staleTiles;
+		std::vector<uint8_t> tileEvaluated;
 	};
 
 }
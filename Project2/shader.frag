@@ -1,5 +1,8 @@
 #version 450
 
+#ifdef VERTEX_COLOR
+layout(location = 0) in vec3 fragColor;
+#endif
 
 layout (location = 0) out vec4 outColor;
 
@@ -10,5 +13,9 @@ layout(push_constant) uniform Push {
 } push;
 
 void main() {
+#ifdef VERTEX_COLOR
+    outColor = vec4(push.color * fragColor, 1.0);
+#else
     outColor = vec4(push.color, 1.0); 	
-}
\ No newline at end of file
+#endif
+}
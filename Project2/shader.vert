@@ -1,7 +1,15 @@
 #version 450
 
+// compile.bat builds a variant per VefpVertexLayout, VERTEX_COLOR and VERTEX_UV select the attributes
 layout(location = 0) in vec2 position;
-layout(location = 1) in vec3 color;
+#ifdef VERTEX_COLOR
+layout(location = 1) in vec4 color;
+layout(location = 0) out vec3 fragColor;
+#endif
+#ifdef VERTEX_UV
+layout(location = 2) in vec2 uv;
+layout(location = 1) out vec2 fragUv;
+#endif
 
 layout(push_constant) uniform Push {
 	mat2 transform;
@@ -11,5 +19,10 @@ layout(push_constant) uniform Push {
 
 void main() {
 	gl_Position = vec4(push.transform * position + push.offset, 0.0, 1.0); 
-
-}
\ No newline at end of file
+#ifdef VERTEX_COLOR
+	fragColor = color.rgb;
+#endif
+#ifdef VERTEX_UV
+	fragUv = uv;
+#endif
+}
@@ -16,9 +16,10 @@ namespace vefp {
 		alignas(16) glm::vec3 color;
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(VefpDevice& device, VkRenderPass renderPass) : vefpDevice{ device } {
+	SimpleRenderSystem::SimpleRenderSystem(VefpDevice& device, VkRenderPass renderPass)
+		: vefpDevice{ device }, renderPass{ renderPass } {
 		createPipelineLayout();
-		createPipeline(renderPass);
+		getPipelineIndex(VefpVertexLayout{});
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem() {
@@ -44,28 +45,106 @@ namespace vefp {
 		}
 	}
 
-	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+	uint32_t SimpleRenderSystem::getPipelineIndex(const VefpVertexLayout& layout) {
+		for (uint32_t i = 0; i < pipelines.size(); i++) {
+			if (pipelines[i].first == layout) {
+				return i;
+			}
+		}
+
 		PipelineConfigInfo pipelineConfig{};
 		VefpPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		VefpPipeline::setVertexLayout(pipelineConfig, layout);
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = pipelineLayout;
-		vefpPipeline = std::make_unique<VefpPipeline>(
+		pipelines.emplace_back(layout, std::make_unique<VefpPipeline>(
 			vefpDevice,
-			"vert.spv",
-			"frag.spv",
-			pipelineConfig);
+			"vert" + layout.shaderSuffix() + ".spv",
+			layout.color ? "frag_color.spv" : "frag.spv",
+			pipelineConfig));
+		return static_cast<uint32_t>(pipelines.size() - 1);
 	}
 
-	void SimpleRenderSystem::renderAppObjects(VkCommandBuffer commandBuffer, std::vector<VefpAppObject>& appObjects) {
-		vefpPipeline->bind(commandBuffer);
+	uint32_t SimpleRenderSystem::getModelIndex(std::pmr::vector<VefpModel*>& queueModels, VefpModel* model) {
+		// consecutive draws mostly share their model, so the last one is checked first
+		if (!queueModels.empty() && queueModels.back() == model) {
+			return static_cast<uint32_t>(queueModels.size() - 1);
+		}
+		for (uint32_t i = 0; i < queueModels.size(); i++) {
+			if (queueModels[i] == model) {
+				return i;
+			}
+		}
+		queueModels.push_back(model);
+		return static_cast<uint32_t>(queueModels.size() - 1);
+	}
 
-		for (auto& obj : appObjects) {
-			obj.transform2d.rotation = glm::mod(obj.transform2d.rotation + 0.01f, glm::two_pi<float>());
+	void SimpleRenderSystem::renderEntities(
+		VkCommandBuffer commandBuffer,
+		RenderQuery& entities,
+		const VefpCamera2d& camera,
+		VefpFrameArena& scratch)
+	{
+		// sized up front, growing would leave the outgrown storage behind in the arena
+		const uint32_t entityCount = entities.count();
+		std::pmr::vector<DrawItem> drawItems{ &scratch };
+		std::pmr::vector<Aabb2d> objectBounds{ &scratch };
+		drawItems.reserve(entityCount);
+		objectBounds.reserve(entityCount);
+		entities.each([&](Transform2dComponent&, WorldTransform2dComponent& transform, ModelComponent& model, ColorComponent& color) {
+			drawItems.push_back({ transform.matrix, transform.translation, color.color, model.model.get() });
+			objectBounds.push_back(model.model->getBounds().transformed(transform.matrix, transform.translation));
+		});
+
+		VefpSpatialGrid cullingGrid{ &scratch };
+		cullingGrid.build(objectBounds);
+		std::pmr::vector<uint32_t> visibleObjects{ &scratch };
+		visibleObjects.reserve(drawItems.size());
+		cullingGrid.query(camera.getViewBounds(), visibleObjects);
+
+		stats.drawnObjects += static_cast<uint32_t>(visibleObjects.size());
+		stats.culledObjects += static_cast<uint32_t>(drawItems.size() - visibleObjects.size());
+		if (visibleObjects.empty()) {
+			return;
+		}
+
+		// no layers or depth in this scene yet, equal keys keep the query order
+		VefpRenderQueue renderQueue{ &scratch };
+		renderQueue.reserve(visibleObjects.size());
+		std::pmr::vector<VefpModel*> queueModels{ &scratch };
+		for (uint32_t index : visibleObjects) {
+			VefpModel* model = drawItems[index].model;
+			renderQueue.push(
+				VefpRenderQueue::makeKey(0, getPipelineIndex(model->getVertexLayout()), getModelIndex(queueModels, model), 0.f),
+				index);
+		}
+		renderQueue.sort();
+
+		const glm::mat2 viewScale = camera.getViewScale();
+		uint32_t boundPipeline = UINT32_MAX;
+		uint32_t boundModel = UINT32_MAX;
+		uint32_t binds = 0;
+		for (size_t i = 0; i < renderQueue.size(); i++) {
+			const uint64_t key = renderQueue.key(i);
+			const DrawItem& item = drawItems[renderQueue.item(i)];
+
+			if (VefpRenderQueue::keyPipeline(key) != boundPipeline) {
+				boundPipeline = VefpRenderQueue::keyPipeline(key);
+				pipelines[boundPipeline].second->bind(commandBuffer);
+				stats.pipelineBinds++;
+				binds++;
+			}
+			if (VefpRenderQueue::keyModel(key) != boundModel) {
+				boundModel = VefpRenderQueue::keyModel(key);
+				item.model->bind(commandBuffer);
+				stats.modelBinds++;
+				binds++;
+			}
 
 			SimplePushConstantData push{};
-			push.offset = obj.transform2d.translation;
-			push.color = obj.color;
-			push.transform = obj.transform2d.mat2();
+			push.offset = camera.worldToClip(item.translation);
+			push.color = item.color;
+			push.transform = viewScale * item.transform * item.model->getPositionScale();
 
 			vkCmdPushConstants(
 				commandBuffer,
@@ -74,10 +153,9 @@ namespace vefp {
 				0,
 				sizeof(SimplePushConstantData),
 				&push);
-			obj.model->bind(commandBuffer);
-			obj.model->draw(commandBuffer);
+			item.model->draw(commandBuffer);
 		}
-
+		stats.skippedBinds += 2 * static_cast<uint32_t>(renderQueue.size()) - binds;
 	}
 
 }
\ No newline at end of file
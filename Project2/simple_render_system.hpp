@@ -2,23 +2,52 @@
  
 #include "vefp_device.hpp"
 #include "vefp_pipeline.hpp"
-#include "vefp_app_object.hpp"
+#include "vefp_components.hpp"
+#include "vefp_camera.hpp"
+#include "vefp_spatial_grid.hpp"
+#include "vefp_render_queue.hpp"
+#include "vefp_frame_arena.hpp"
 
 
 #include <memory>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 
 namespace vefp {
+
+	struct RenderStats {
+		uint32_t drawnObjects = 0;
+		uint32_t culledObjects = 0;
+		uint32_t pipelineBinds = 0;
+		uint32_t modelBinds = 0;
+		// binds saved against binding the pipeline and the model for every draw
+		uint32_t skippedBinds = 0;
+	};
+
 	class SimpleRenderSystem {
 	private:
 		void createPipelineLayout();
-		void createPipeline(VkRenderPass renderPass);
+		// pipelines are created on first use, one per vertex layout the drawn models use
+		uint32_t getPipelineIndex(const VefpVertexLayout& layout);
+		// render queue id of the model, assigned in the order models are first drawn in a call
+		static uint32_t getModelIndex(std::pmr::vector<VefpModel*>& queueModels, VefpModel* model);
 
 		VefpDevice& vefpDevice;
+		VkRenderPass renderPass;
 
-		std::unique_ptr<VefpPipeline> vefpPipeline;
+		std::vector<std::pair<VefpVertexLayout, std::unique_ptr<VefpPipeline>>> pipelines;
 		VkPipelineLayout pipelineLayout;
 
+		struct DrawItem {
+			glm::mat2 transform;
+			glm::vec2 translation;
+			glm::vec3 color;
+			VefpModel* model;
+		};
+
+		RenderStats stats{};
+
 	public:
 
 		SimpleRenderSystem(VefpDevice& device, VkRenderPass renderpass);
@@ -27,7 +56,19 @@ namespace vefp {
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-		void renderAppObjects(VkCommandBuffer commandBuffer, std::vector<VefpAppObject> &appObjects);
+		// Only objects whose bounds overlap the camera view are pushed and drawn. Objects are drawn with
+		// their world transform, TransformSystem has to have updated it this frame. Draws are sorted by
+		// pipeline and model so each is only bound when it changes. The draw list, culling grid and
+		// render queue are allocated from scratch.
+		void renderEntities(
+			VkCommandBuffer commandBuffer,
+			RenderQuery& entities,
+			const VefpCamera2d& camera,
+			VefpFrameArena& scratch);
+
+		// counters accumulate over all renderEntities calls since the last reset
+		const RenderStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
 
 	};
 
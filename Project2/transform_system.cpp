@@ -0,0 +1,189 @@
+#include "transform_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VEFP_SSE2 1
+#endif
+
+namespace vefp {
+
+	// Cephes style sincos: the angle is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2
+	// in three steps to keep the error small, both polynomials are evaluated and the quadrant picks
+	// and negates them. Accurate to a few ulp for the angles transforms use.
+	static constexpr float TWO_OVER_PI = 0.636619772367581343f;
+	static constexpr float PI_OVER_TWO_1 = 1.5703125f;
+	static constexpr float PI_OVER_TWO_2 = 4.837512969970703125e-4f;
+	static constexpr float PI_OVER_TWO_3 = 7.54978995489188216e-8f;
+	static constexpr float SIN_1 = -1.6666654611e-1f;
+	static constexpr float SIN_2 = 8.3321608736e-3f;
+	static constexpr float SIN_3 = -1.9515295891e-4f;
+	static constexpr float COS_1 = 4.166664568298827e-2f;
+	static constexpr float COS_2 = -1.388731625493765e-3f;
+	static constexpr float COS_3 = 2.443315711809948e-5f;
+
+	// rows are gathered into blocks before their angles go through sinCos together
+	static constexpr uint32_t TRANSFORM_BLOCK_SIZE = 64;
+
+	static void sinCosScalar(float angle, float& sine, float& cosine) {
+		const float quadrant = std::nearbyint(angle * TWO_OVER_PI);
+		const float x = ((angle - quadrant * PI_OVER_TWO_1) - quadrant * PI_OVER_TWO_2) - quadrant * PI_OVER_TWO_3;
+		const float x2 = x * x;
+		const float s = x + x * x2 * (SIN_1 + x2 * (SIN_2 + x2 * SIN_3));
+		const float c = 1.f - 0.5f * x2 + x2 * x2 * (COS_1 + x2 * (COS_2 + x2 * COS_3));
+
+		const int q = static_cast<int>(quadrant);
+		sine = (q & 1) ? c : s;
+		cosine = (q & 1) ? s : c;
+		if (q & 2) {
+			sine = -sine;
+		}
+		if ((q + 1) & 2) {
+			cosine = -cosine;
+		}
+	}
+
+	void TransformSystem::sinCos(const float* angles, float* sines, float* cosines, uint32_t count) {
+		uint32_t i = 0;
+#if VEFP_SSE2
+		const __m128 twoOverPi = _mm_set1_ps(TWO_OVER_PI);
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i two = _mm_set1_epi32(2);
+		for (; i + 4 <= count; i += 4) {
+			const __m128 angle = _mm_loadu_ps(angles + i);
+			// rounds to nearest under the default rounding mode
+			const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(angle, twoOverPi));
+			const __m128 quadrant = _mm_cvtepi32_ps(q);
+
+			__m128 x = _mm_sub_ps(angle, _mm_mul_ps(quadrant, _mm_set1_ps(PI_OVER_TWO_1)));
+			x = _mm_sub_ps(x, _mm_mul_ps(quadrant, _mm_set1_ps(PI_OVER_TWO_2)));
+			x = _mm_sub_ps(x, _mm_mul_ps(quadrant, _mm_set1_ps(PI_OVER_TWO_3)));
+			const __m128 x2 = _mm_mul_ps(x, x);
+
+			__m128 s = _mm_add_ps(_mm_set1_ps(SIN_2), _mm_mul_ps(x2, _mm_set1_ps(SIN_3)));
+			s = _mm_add_ps(_mm_set1_ps(SIN_1), _mm_mul_ps(x2, s));
+			s = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), s));
+			__m128 c = _mm_add_ps(_mm_set1_ps(COS_2), _mm_mul_ps(x2, _mm_set1_ps(COS_3)));
+			c = _mm_add_ps(_mm_set1_ps(COS_1), _mm_mul_ps(x2, c));
+			c = _mm_add_ps(
+				_mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_set1_ps(0.5f), x2)),
+				_mm_mul_ps(_mm_mul_ps(x2, x2), c));
+
+			// odd quadrants swap sin and cos, bit 1 of q (of q + 1 for cos) flips the sign
+			const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+			const __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+			const __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+			const __m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+			const __m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+			_mm_storeu_ps(sines + i, _mm_xor_ps(sine, sineSign));
+			_mm_storeu_ps(cosines + i, _mm_xor_ps(cosine, cosineSign));
+		}
+#endif
+		for (; i < count; i++) {
+			sinCosScalar(angles[i], sines[i], cosines[i]);
+		}
+	}
+
+	void TransformSystem::update(VefpWorld& world, std::pmr::memory_resource* scratch) {
+		stats = {};
+		updateRoots(world, scratch);
+		updateChildren(world);
+	}
+
+	void TransformSystem::updateRoots(VefpWorld& world, std::pmr::memory_resource* scratch) {
+		std::atomic<uint32_t> updated{ 0 };
+		world.query<Transform2dComponent, WorldTransform2dComponent>().exclude<ParentComponent>().parallelEachChunk(
+			[&](uint32_t count, Transform2dComponent* transforms, WorldTransform2dComponent* worldTransforms) {
+				std::array<uint32_t, TRANSFORM_BLOCK_SIZE> rows;
+				std::array<float, TRANSFORM_BLOCK_SIZE> angles;
+				std::array<float, TRANSFORM_BLOCK_SIZE> sines;
+				std::array<float, TRANSFORM_BLOCK_SIZE> cosines;
+				uint32_t blockSize = 0;
+				uint32_t chunkUpdated = 0;
+
+				auto flush = [&]() {
+					sinCos(angles.data(), sines.data(), cosines.data(), blockSize);
+					for (uint32_t i = 0; i < blockSize; i++) {
+						Transform2dComponent& transform = transforms[rows[i]];
+						WorldTransform2dComponent& worldTransform = worldTransforms[rows[i]];
+						worldTransform.matrix = glm::mat2{
+							glm::vec2{ cosines[i], sines[i] } * transform.scale.x,
+							glm::vec2{ -sines[i], cosines[i] } * transform.scale.y };
+						worldTransform.translation = transform.translation;
+						worldTransform.version++;
+						transform.dirty = false;
+					}
+					chunkUpdated += blockSize;
+					blockSize = 0;
+				};
+
+				for (uint32_t row = 0; row < count; row++) {
+					if (!transforms[row].dirty) {
+						continue;
+					}
+					rows[blockSize] = row;
+					angles[blockSize] = transforms[row].rotation;
+					if (++blockSize == TRANSFORM_BLOCK_SIZE) {
+						flush();
+					}
+				}
+				flush();
+				updated += chunkUpdated;
+			},
+			scratch);
+		stats.updatedRoots = updated;
+	}
+
+	void TransformSystem::updateChildren(VefpWorld& world) {
+		if (childrenVersion != world.getStructureVersion()) {
+			buildChildren(world);
+			childrenVersion = world.getStructureVersion();
+		}
+
+		// parents are always updated before their children
+		for (const Child& child : children) {
+			Transform2dComponent& transform = *child.transform;
+			WorldTransform2dComponent& worldTransform = *child.worldTransform;
+			const WorldTransform2dComponent& parentTransform = *child.parentTransform;
+			if (!transform.dirty && worldTransform.parentVersion == parentTransform.version) {
+				continue;
+			}
+
+			worldTransform.matrix = parentTransform.matrix * transform.mat2();
+			worldTransform.translation = parentTransform.matrix * transform.translation + parentTransform.translation;
+			worldTransform.parentVersion = parentTransform.version;
+			worldTransform.version++;
+			transform.dirty = false;
+			stats.updatedChildren++;
+		}
+	}
+
+	void TransformSystem::buildChildren(VefpWorld& world) {
+		children.clear();
+		world.query<Transform2dComponent, WorldTransform2dComponent, ParentComponent>().each(
+			[&](EntityId, Transform2dComponent& transform, WorldTransform2dComponent& worldTransform, ParentComponent& parent) {
+				// children below a destroyed entity keep their last world transform
+				uint32_t depth = 1;
+				EntityId ancestor = parent.parent;
+				for (; world.isAlive(ancestor) && world.has<ParentComponent>(ancestor); depth++) {
+					ancestor = world.get<ParentComponent>(ancestor).parent;
+					assert(depth < world.entityCount() && "Transform hierarchy has a cycle");
+				}
+				if (!world.isAlive(ancestor)) {
+					return;
+				}
+				children.push_back({ depth, &transform, &worldTransform, &world.get<WorldTransform2dComponent>(parent.parent) });
+			});
+
+		std::stable_sort(children.begin(), children.end(), [](const Child& a, const Child& b) { return a.depth < b.depth; });
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "vefp_components.hpp"
+
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+namespace vefp {
+
+	struct TransformStats {
+		uint32_t updatedRoots = 0;
+		uint32_t updatedChildren = 0;
+	};
+
+	// Brings every WorldTransform2dComponent up to date with its Transform2dComponent and parents.
+	// Runs once per frame after the systems that move entities and before anything reads world
+	// transforms. Only entities whose transform is dirty, or whose parent changed, are touched.
+	class TransformSystem {
+	public:
+		void update(VefpWorld& world, std::pmr::memory_resource* scratch);
+
+		const TransformStats& getStats() const { return stats; }
+
+		// sin and cos of count angles, vectorized where the target allows it
+		static void sinCos(const float* angles, float* sines, float* cosines, uint32_t count);
+
+	private:
+		void updateRoots(VefpWorld& world, std::pmr::memory_resource* scratch);
+		void updateChildren(VefpWorld& world);
+
+		struct Child {
+			uint32_t depth;  // below the root
+			Transform2dComponent* transform;
+			WorldTransform2dComponent* worldTransform;
+			const WorldTransform2dComponent* parentTransform;
+		};
+
+		void buildChildren(VefpWorld& world);
+
+		TransformStats stats{};
+		// sorted by depth and rebuilt only when the world's structure changes, components only move
+		// when it does, so the pointers stay valid until then
+		std::vector<Child> children;
+		uint64_t childrenVersion = std::numeric_limits<uint64_t>::max();
+	};
+
+}
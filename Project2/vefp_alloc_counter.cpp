@@ -0,0 +1,106 @@
+#include "vefp_alloc_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace vefp {
+
+#ifdef NDEBUG
+
+	uint64_t VefpAllocCounter::allocations() {
+		return 0;
+	}
+
+	uint64_t VefpAllocCounter::threadAllocations() {
+		return 0;
+	}
+
+	void VefpAllocCounter::addThreadAllocations(uint64_t) {}
+
+#else
+
+	static std::atomic<uint64_t> allocationCount{ 0 };
+	static thread_local uint64_t threadAllocationCount = 0;
+
+	uint64_t VefpAllocCounter::allocations() {
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t VefpAllocCounter::threadAllocations() {
+		return threadAllocationCount;
+	}
+
+	void VefpAllocCounter::addThreadAllocations(uint64_t count) {
+		threadAllocationCount += count;
+	}
+
+	static void* countedAlloc(std::size_t size) {
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		threadAllocationCount++;
+		if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+			return ptr;
+		}
+		throw std::bad_alloc{};
+	}
+
+	static void* countedAlignedAlloc(std::size_t size, std::size_t alignment) {
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		threadAllocationCount++;
+		size = size == 0 ? alignment : size;
+#ifdef _MSC_VER
+		void* ptr = _aligned_malloc(size, alignment);
+#else
+		void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+		if (ptr) {
+			return ptr;
+		}
+		throw std::bad_alloc{};
+	}
+
+	static void alignedFree(void* ptr) {
+#ifdef _MSC_VER
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+
+#endif
+
+}
+
+#ifndef NDEBUG
+
+// The array and nothrow forms of the standard library forward to these. Sized deletes are replaced
+// as well so every delete is guaranteed to pair with the allocation functions below.
+void* operator new(std::size_t size) {
+	return vefp::countedAlloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return vefp::countedAlignedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	vefp::alignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+	vefp::alignedFree(ptr);
+}
+
+#endif
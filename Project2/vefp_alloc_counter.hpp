@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vefp {
+
+	// Counts calls to the global operator new in debug builds, where vefp_alloc_counter.cpp replaces
+	// it. Used to check that steady state frames stay off the general heap. Release builds keep the
+	// default operator new and always report 0.
+	class VefpAllocCounter {
+	public:
+#ifdef NDEBUG
+		static constexpr bool ENABLED = false;
+#else
+		static constexpr bool ENABLED = true;
+#endif
+
+		// allocations made by all threads since startup
+		static uint64_t allocations();
+		// allocations made by the calling thread since it started, including those charged to it
+		static uint64_t threadAllocations();
+		// charges allocations made by other threads on the calling thread's behalf, e.g. by a pool
+		static void addThreadAllocations(uint64_t count);
+	};
+
+}
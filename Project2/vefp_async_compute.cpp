@@ -0,0 +1,69 @@
+#include "vefp_async_compute.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace vefp {
+
+	VefpAsyncCompute::VefpAsyncCompute(VefpDevice& device, uint32_t framesInFlight)
+		: vefpDevice{ device }, timeline{ device }, submitValues(framesInFlight, 0) {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = vefpDevice.computeQueueFamily();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(vefpDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute command pool!");
+		}
+
+		commandBuffers.resize(framesInFlight);
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = framesInFlight;
+		if (vkAllocateCommandBuffers(vefpDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate compute command buffers!");
+		}
+	}
+
+	VefpAsyncCompute::~VefpAsyncCompute() {
+		timeline.wait(timeline.lastSubmittedValue());
+		vkDestroyCommandPool(vefpDevice.device(), commandPool, nullptr);
+	}
+
+	VkCommandBuffer VefpAsyncCompute::beginFrame(int frameIndex) {
+		assert(currentFrameIndex == -1 && "Can't call beginFrame while compute work is being recorded");
+		assert(frameIndex >= 0 && frameIndex < static_cast<int>(commandBuffers.size()) && "Frame index out of range");
+
+		// normally long done, the frame that used this slot before has already been waited for
+		timeline.wait(submitValues[frameIndex]);
+		currentFrameIndex = frameIndex;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(commandBuffers[frameIndex], &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording compute command buffer!");
+		}
+		return commandBuffers[frameIndex];
+	}
+
+	VefpTimeline::Wait VefpAsyncCompute::submit(VkPipelineStageFlags consumerStages) {
+		assert(currentFrameIndex != -1 && "Can't call submit before beginFrame");
+		VkCommandBuffer commandBuffer = commandBuffers[currentFrameIndex];
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record compute command buffer!");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		uint64_t value = timeline.submit(vefpDevice.computeQueue(), submitInfo);
+
+		submitValues[currentFrameIndex] = value;
+		currentFrameIndex = -1;
+		return { &timeline, value, consumerStages };
+	}
+
+}
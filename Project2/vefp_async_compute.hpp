@@ -0,0 +1,39 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_timeline.hpp"
+
+#include <vector>
+
+namespace vefp {
+
+	// Per frame compute work submitted to the device's async compute queue. The returned wait goes to
+	// VefpRenderer::addFrameDependency, so the graphics queue only stalls at the stages that read the
+	// results while the compute queue runs next to the rasterization of the previous frame.
+	// Buffers written here and read by graphics should be created with sharedWithCompute.
+	class VefpAsyncCompute {
+	public:
+		VefpAsyncCompute(VefpDevice& device, uint32_t framesInFlight);
+		~VefpAsyncCompute();
+
+		VefpAsyncCompute(const VefpAsyncCompute&) = delete;
+		VefpAsyncCompute& operator=(const VefpAsyncCompute&) = delete;
+
+		// starts recording the compute command buffer of the frame
+		VkCommandBuffer beginFrame(int frameIndex);
+		// consumerStages are the graphics stages that read what the compute work wrote
+		VefpTimeline::Wait submit(VkPipelineStageFlags consumerStages);
+
+		bool isAsync() const { return vefpDevice.hasDedicatedComputeQueue(); }
+		VefpTimeline& getTimeline() { return timeline; }
+
+	private:
+		VefpDevice& vefpDevice;
+		VefpTimeline timeline;
+		VkCommandPool commandPool;
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<uint64_t> submitValues;
+		int currentFrameIndex = -1;
+	};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace vefp {
+
+	struct Aabb2d {
+		glm::vec2 min{ 0.f };
+		glm::vec2 max{ 0.f };
+
+		glm::vec2 center() const { return .5f * (min + max); }
+		glm::vec2 halfExtent() const { return .5f * (max - min); }
+
+		bool overlaps(const Aabb2d& other) const {
+			return min.x <= other.max.x && max.x >= other.min.x &&
+				min.y <= other.max.y && max.y >= other.min.y;
+		}
+
+		// bounds of this box after applying a linear transform followed by a translation
+		Aabb2d transformed(const glm::mat2& linear, glm::vec2 offset) const {
+			glm::vec2 c = linear * center() + offset;
+			glm::mat2 absLinear{ glm::abs(linear[0]), glm::abs(linear[1]) };
+			glm::vec2 e = absLinear * halfExtent();
+			return { c - e, c + e };
+		}
+	};
+
+}
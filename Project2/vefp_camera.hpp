@@ -0,0 +1,32 @@
+#pragma once
+
+#include "vefp_bounds.hpp"
+
+namespace vefp {
+
+	// Axis aligned 2d camera. The visible region is center +- halfExtent in world space,
+	// the default maps world space 1:1 onto clip space.
+	class VefpCamera2d {
+	public:
+		void setView(glm::vec2 viewCenter, glm::vec2 viewHalfExtent) {
+			center = viewCenter;
+			halfExtent = viewHalfExtent;
+		}
+
+		glm::vec2 getCenter() const { return center; }
+		glm::vec2 getHalfExtent() const { return halfExtent; }
+
+		Aabb2d getViewBounds() const { return { center - halfExtent, center + halfExtent }; }
+
+		glm::mat2 getViewScale() const {
+			return glm::mat2{ {1.f / halfExtent.x, .0f}, {.0f, 1.f / halfExtent.y} };
+		}
+
+		glm::vec2 worldToClip(glm::vec2 point) const { return (point - center) / halfExtent; }
+
+	private:
+		glm::vec2 center{ 0.f };
+		glm::vec2 halfExtent{ 1.f };
+	};
+
+}
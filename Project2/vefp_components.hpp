@@ -0,0 +1,81 @@
+#pragma once
+
+#include "vefp_ecs.hpp"
+#include "vefp_model.hpp"
+#include "vefp_lod_model.hpp"
+
+#include <memory>
+
+namespace vefp {
+	// new
+	struct RigidBody2dComponent {
+		glm::vec2 velocity;
+		float mass{ 1.0f };
+	};
+
+	// Local transform, relative to the parent's world transform when the entity has a ParentComponent.
+	// Write through the setters, or set dirty after changing the fields, so TransformSystem notices.
+	struct Transform2dComponent {
+		glm::vec2 translation{}; // position offset
+		glm::vec2 scale{ 1.f, 1.f };
+		float rotation{};
+		bool dirty = true;
+
+		void setTranslation(glm::vec2 newTranslation) {
+			translation = newTranslation;
+			dirty = true;
+		}
+		void setScale(glm::vec2 newScale) {
+			scale = newScale;
+			dirty = true;
+		}
+		void setRotation(float newRotation) {
+			rotation = newRotation;
+			dirty = true;
+		}
+
+		glm::mat2 mat2() const {
+			const float s = glm::sin(rotation);
+			const float c = glm::cos(rotation);
+			glm::mat2 rotMatrix{ {c, s}, {-s, c} };
+
+			glm::mat2 scaleMat{ {scale.x, .0f}, {.0f, scale.y} };
+			return rotMatrix * scaleMat;
+		}
+	};
+
+	// cached result of the transform hierarchy, only written by TransformSystem
+	struct WorldTransform2dComponent {
+		glm::mat2 matrix{ 1.f };
+		glm::vec2 translation{};
+		// bumped whenever the world transform changes, children compare it to notice a moved parent
+		uint32_t version = 0;
+		uint32_t parentVersion = 0;
+	};
+
+	// the parent needs a WorldTransform2dComponent as well. Reparent by removing and adding the
+	// component, TransformSystem only looks at parents again when the world's structure changes.
+	struct ParentComponent {
+		EntityId parent{};
+	};
+
+	struct ModelComponent {
+		std::shared_ptr<VefpModel> model{};
+	};
+
+	// LodSystem swaps the entity's ModelComponent between the levels of the lod model
+	struct LodComponent {
+		std::shared_ptr<VefpLodModel> lod{};
+		uint32_t level = 0;
+	};
+
+	struct ColorComponent {
+		glm::vec3 color{};
+	};
+
+	// sample point of the vector field, oriented along the gravity force by Vec2FieldSystem
+	struct FieldPointComponent {};
+
+	// everything the render systems need to draw an entity
+	using RenderQuery = VefpQuery<Transform2dComponent, WorldTransform2dComponent, ModelComponent, ColorComponent>;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "vefp_device.hpp"
 
 // std headers
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -80,7 +81,7 @@ namespace vefp {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -140,6 +141,12 @@ namespace vefp {
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        if (indices.transferFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.transferFamily);
+        }
+        if (indices.computeFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.computeFamily);
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -151,18 +158,48 @@ namespace vefp {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures = {};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+        enabledFeatures_ = {};
+        enabledFeatures_.samplerAnisotropy = VK_TRUE;
+        enabledFeatures_.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        enabledFeatures_.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        bool hasDrawIndirectCount =
+            checkOptionalExtensionSupport(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (hasDrawIndirectCount) {
+            enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
+
+        // timeline semaphores are core in 1.2 but still have to be enabled as a feature
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        bool hasVulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+        if (hasVulkan12) {
+            VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {};
+            supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+            supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supportedFeatures2.pNext = &supportedVulkan12Features;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+
+            vulkan12Features.timelineSemaphore = supportedVulkan12Features.timelineSemaphore;
+            // must match the extension when both are given
+            vulkan12Features.drawIndirectCount = hasDrawIndirectCount ? VK_TRUE : VK_FALSE;
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = hasVulkan12 ? &vulkan12Features : nullptr;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.pEnabledFeatures = &enabledFeatures_;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -180,6 +217,24 @@ namespace vefp {
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+        graphicsFamily_ = indices.graphicsFamily;
+        transferFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+        vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
+        computeFamily_ = indices.computeFamilyHasValue ? indices.computeFamily : indices.graphicsFamily;
+        vkGetDeviceQueue(device_, computeFamily_, 0, &computeQueue_);
+
+        if (hasDrawIndirectCount) {
+            drawIndirectCount_ = (PFN_vkCmdDrawIndirectCountKHR)vkGetDeviceProcAddr(
+                device_,
+                "vkCmdDrawIndirectCountKHR");
+        }
+
+        timelineSemaphores_ = vulkan12Features.timelineSemaphore == VK_TRUE;
+
+        // gpu driven rendering culls on the graphics queue and passes the object index as firstInstance
+        gpuDrivenRendering_ = enabledFeatures_.drawIndirectFirstInstance &&
+            queueFamilySupports(physicalDevice, indices.graphicsFamily, VK_QUEUE_COMPUTE_BIT);
     }
 
     void VefpDevice::createCommandPool() {
@@ -320,6 +375,45 @@ namespace vefp {
         return requiredExtensions.empty();
     }
 
+    bool VefpDevice::checkOptionalExtensionSupport(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(
+            device,
+            nullptr,
+            &extensionCount,
+            availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extensionName, extension.extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t VefpDevice::timestampValidBits(uint32_t queueFamily) {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        return queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+    }
+
+    bool VefpDevice::queueFamilySupports(VkPhysicalDevice device, uint32_t queueFamily, VkQueueFlags flags) {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+        return queueFamily < queueFamilyCount && (queueFamilies[queueFamily].queueFlags & flags) == flags;
+    }
+
     QueueFamilyIndices VefpDevice::findQueueFamilies(VkPhysicalDevice device) {
         QueueFamilyIndices indices;
 
@@ -329,20 +423,40 @@ namespace vefp {
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+        bool transferFamilyIsDedicated = false;
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            if (queueFamily.queueCount == 0) {
+                i++;
+                continue;
+            }
+
+            if (!indices.graphicsFamilyHasValue && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 indices.graphicsFamily = i;
                 indices.graphicsFamilyHasValue = true;
             }
             VkBool32 presentSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-            if (queueFamily.queueCount > 0 && presentSupport) {
+            if (!indices.presentFamilyHasValue && presentSupport) {
                 indices.presentFamily = i;
                 indices.presentFamilyHasValue = true;
             }
-            if (indices.isComplete()) {
-                break;
+
+            // prefer a transfer-only family over one that also does compute
+            bool transferOnly = (queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0;
+            if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+                !transferFamilyIsDedicated) {
+                indices.transferFamily = i;
+                indices.transferFamilyHasValue = true;
+                transferFamilyIsDedicated = transferOnly;
+            }
+
+            if (!indices.computeFamilyHasValue &&
+                (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+                !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                indices.computeFamily = i;
+                indices.computeFamilyHasValue = true;
             }
 
             i++;
@@ -394,6 +508,12 @@ namespace vefp {
         throw std::runtime_error("failed to find supported format!");
     }
 
+    VkFormatProperties VefpDevice::getFormatProperties(VkFormat format) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+        return props;
+    }
+
     uint32_t VefpDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
         VkPhysicalDeviceMemoryProperties memProperties;
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -412,13 +532,21 @@ namespace vefp {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        VkDeviceMemory& bufferMemory,
+        bool sharedWithCompute) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+        uint32_t sharedFamilies[] = { graphicsFamily_, computeFamily_ };
+        if (sharedWithCompute && hasDedicatedComputeQueue()) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = sharedFamilies;
+        }
+
         if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to create vertex buffer!");
         }
@@ -509,6 +637,18 @@ namespace vefp {
         endSingleTimeCommands(commandBuffer);
     }
 
+    void VefpDevice::cmdDrawIndirectCount(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        VkBuffer countBuffer,
+        VkDeviceSize countBufferOffset,
+        uint32_t maxDrawCount,
+        uint32_t stride) {
+        assert(drawIndirectCount_ != nullptr && "VK_KHR_draw_indirect_count is not enabled on this device");
+        drawIndirectCount_(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+    }
+
     void VefpDevice::createImageWithInfo(
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
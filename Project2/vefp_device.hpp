@@ -20,6 +20,14 @@ namespace vefp {
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+
+        // optional family without graphics support, its copies run on the dma engines
+        uint32_t transferFamily;
+        bool transferFamilyHasValue = false;
+
+        // optional compute family without graphics support, runs next to the graphics queue
+        uint32_t computeFamily;
+        bool computeFamilyHasValue = false;
     };
 
     class VefpDevice {
@@ -44,20 +52,35 @@ namespace vefp {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        // same as the graphics queue when the device has no dedicated transfer family
+        VkQueue transferQueue() { return transferQueue_; }
+        uint32_t graphicsQueueFamily() const { return graphicsFamily_; }
+        uint32_t transferQueueFamily() const { return transferFamily_; }
+        bool hasDedicatedTransferQueue() const { return transferFamily_ != graphicsFamily_; }
+        // same as the graphics queue when the device has no async compute family
+        VkQueue computeQueue() { return computeQueue_; }
+        uint32_t computeQueueFamily() const { return computeFamily_; }
+        bool hasDedicatedComputeQueue() const { return computeFamily_ != graphicsFamily_; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
         VkFormat findSupportedFormat(
             const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+        VkFormatProperties getFormatProperties(VkFormat format);
+        // 0 when the queue family can not write timestamps
+        uint32_t timestampValidBits(uint32_t queueFamily);
 
         // Buffer Helper Functions
+        // sharedWithCompute buffers are concurrent between the graphics and async compute families, so
+        // they can be handed between the queues with a semaphore alone
         void createBuffer(
             VkDeviceSize size,
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory);
+            VkDeviceMemory& bufferMemory,
+            bool sharedWithCompute = false);
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -70,6 +93,20 @@ namespace vefp {
             VkImage& image,
             VkDeviceMemory& imageMemory);
 
+        // optional capabilities, enabled in createLogicalDevice when the physical device has them
+        const VkPhysicalDeviceFeatures& enabledFeatures() const { return enabledFeatures_; }
+        bool supportsDrawIndirectCount() const { return drawIndirectCount_ != nullptr; }
+        bool supportsGpuDrivenRendering() const { return gpuDrivenRendering_; }
+        bool supportsTimelineSemaphores() const { return timelineSemaphores_; }
+        void cmdDrawIndirectCount(
+            VkCommandBuffer commandBuffer,
+            VkBuffer buffer,
+            VkDeviceSize offset,
+            VkBuffer countBuffer,
+            VkDeviceSize countBufferOffset,
+            uint32_t maxDrawCount,
+            uint32_t stride);
+
         VkPhysicalDeviceProperties properties;
 
     private:
@@ -88,6 +125,8 @@ namespace vefp {
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool checkOptionalExtensionSupport(VkPhysicalDevice device, const char* extensionName);
+        bool queueFamilySupports(VkPhysicalDevice device, uint32_t queueFamily, VkQueueFlags flags);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
         VkInstance instance;
@@ -100,6 +139,16 @@ namespace vefp {
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_;
+        VkQueue computeQueue_;
+        uint32_t graphicsFamily_;
+        uint32_t transferFamily_;
+        uint32_t computeFamily_;
+
+        VkPhysicalDeviceFeatures enabledFeatures_{};
+        PFN_vkCmdDrawIndirectCountKHR drawIndirectCount_ = nullptr;
+        bool gpuDrivenRendering_ = false;
+        bool timelineSemaphores_ = false;
 
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -0,0 +1,179 @@
+#include "vefp_ecs.hpp"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace vefp {
+
+	static std::vector<ComponentInfo>& componentInfos() {
+		static std::vector<ComponentInfo> infos;
+		return infos;
+	}
+
+	static std::mutex& componentRegistryMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	ComponentId ComponentRegistry::registerComponent(const ComponentInfo& info) {
+		std::lock_guard<std::mutex> lock{ componentRegistryMutex() };
+		auto& infos = componentInfos();
+		if (infos.size() == MAX_COMPONENTS) {
+			throw std::runtime_error("too many component types!");
+		}
+		infos.push_back(info);
+		return static_cast<ComponentId>(infos.size() - 1);
+	}
+
+	const ComponentInfo& ComponentRegistry::info(ComponentId id) {
+		// types are registered before any archetype containing them exists, reads need no lock
+		return componentInfos()[id];
+	}
+
+	VefpArchetype::VefpArchetype(ComponentMask mask) : mask{ mask } {
+		size_t rowSize = sizeof(EntityId);
+		for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+			if (mask & (ComponentMask{ 1 } << id)) {
+				components.push_back(id);
+				rowSize += ComponentRegistry::info(id).size;
+			}
+		}
+
+		// largest capacity whose aligned columns still fit into a chunk
+		chunkCapacity = static_cast<uint32_t>(std::max<size_t>(CHUNK_SIZE / rowSize, 1));
+		while (true) {
+			size_t offset = sizeof(EntityId) * chunkCapacity;
+			for (ComponentId id : components) {
+				const ComponentInfo& info = ComponentRegistry::info(id);
+				offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+				columnOffsets[id] = offset;
+				offset += info.size * chunkCapacity;
+			}
+			if (offset <= CHUNK_SIZE || chunkCapacity == 1) {
+				if (offset > CHUNK_SIZE) {
+					throw std::runtime_error("archetype row does not fit into a chunk!");
+				}
+				break;
+			}
+			chunkCapacity--;
+		}
+	}
+
+	VefpArchetype::~VefpArchetype() {
+		for (uint32_t row = 0; row < count; row++) {
+			for (ComponentId id : components) {
+				ComponentRegistry::info(id).destroy(component(row, id));
+			}
+		}
+		for (std::byte* chunk : chunks) {
+			::operator delete(chunk, std::align_val_t{ CHUNK_ALIGNMENT });
+		}
+	}
+
+	uint32_t VefpArchetype::pushRow(EntityId entity) {
+		if (count == chunks.size() * chunkCapacity) {
+			chunks.push_back(static_cast<std::byte*>(::operator new(CHUNK_SIZE, std::align_val_t{ CHUNK_ALIGNMENT })));
+		}
+		uint32_t row = count++;
+		reinterpret_cast<EntityId*>(chunks[row / chunkCapacity])[row % chunkCapacity] = entity;
+		return row;
+	}
+
+	EntityId VefpArchetype::removeRow(uint32_t row) {
+		for (ComponentId id : components) {
+			ComponentRegistry::info(id).destroy(component(row, id));
+		}
+		EntityId movedEntity;
+		removeRowStorage(row, movedEntity);
+		return movedEntity;
+	}
+
+	uint32_t VefpArchetype::moveRow(uint32_t row, VefpArchetype& dst, EntityId& movedEntity) {
+		uint32_t dstRow = dst.pushRow(entity(row));
+		for (ComponentId id : components) {
+			void* src = component(row, id);
+			const ComponentInfo& info = ComponentRegistry::info(id);
+			if (dst.mask & (ComponentMask{ 1 } << id)) {
+				info.moveConstruct(dst.component(dstRow, id), src);
+			}
+			info.destroy(src);
+		}
+		removeRowStorage(row, movedEntity);
+		return dstRow;
+	}
+
+	void VefpArchetype::removeRowStorage(uint32_t row, EntityId& movedEntity) {
+		// components of row are already destroyed, the last row is relocated into the hole
+		uint32_t last = count - 1;
+		if (row != last) {
+			for (ComponentId id : components) {
+				const ComponentInfo& info = ComponentRegistry::info(id);
+				info.moveConstruct(component(row, id), component(last, id));
+				info.destroy(component(last, id));
+			}
+			reinterpret_cast<EntityId*>(chunks[row / chunkCapacity])[row % chunkCapacity] = entity(last);
+		}
+		movedEntity = entity(row);
+		count--;
+	}
+
+	void VefpWorld::destroyEntity(EntityId entity) {
+		assertNotIterating();
+		assert(isAlive(entity) && "Entity does not exist");
+		auto& record = records[entity.index];
+
+		EntityId movedEntity = record.archetype->removeRow(record.row);
+		if (movedEntity != entity) {
+			records[movedEntity.index].row = record.row;
+		}
+		record.archetype = nullptr;
+		record.row = 0;
+		// handles to the old entity go stale as soon as the generation moves on
+		record.generation++;
+		freeIndices.push_back(entity.index);
+		liveEntities--;
+		structureVersion++;
+	}
+
+	EntityId VefpWorld::allocateEntity() {
+		if (!freeIndices.empty()) {
+			uint32_t index = freeIndices.back();
+			freeIndices.pop_back();
+			liveEntities++;
+			return { index, records[index].generation };
+		}
+		if (records.size() == EntityId::INVALID_INDEX) {
+			throw std::runtime_error("too many entities!");
+		}
+		records.emplace_back();
+		liveEntities++;
+		return { static_cast<uint32_t>(records.size() - 1), 0 };
+	}
+
+	VefpArchetype& VefpWorld::getOrCreateArchetype(ComponentMask mask) {
+		auto iter = archetypeByMask.find(mask);
+		if (iter != archetypeByMask.end()) {
+			return *iter->second;
+		}
+		archetypes.push_back(std::make_unique<VefpArchetype>(mask));
+		archetypeByMask.emplace(mask, archetypes.back().get());
+		return *archetypes.back();
+	}
+
+	uint32_t VefpWorld::moveEntity(EntityId entity, ComponentMask newMask) {
+		assertNotIterating();
+		auto& record = records[entity.index];
+		VefpArchetype& dst = getOrCreateArchetype(newMask);
+
+		EntityId movedEntity;
+		uint32_t dstRow = record.archetype->moveRow(record.row, dst, movedEntity);
+		if (movedEntity != entity) {
+			records[movedEntity.index].row = record.row;
+		}
+		record.archetype = &dst;
+		record.row = dstRow;
+		structureVersion++;
+		return dstRow;
+	}
+
+}
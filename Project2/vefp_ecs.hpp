@@ -0,0 +1,345 @@
+#pragma once
+
+#include "vefp_parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vefp {
+
+	// Generational handle. Slots of destroyed entities are recycled, the generation tells a stale
+	// handle apart from the entity that reuses its slot.
+	struct EntityId {
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		uint32_t index = INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool operator==(const EntityId&) const = default;
+	};
+
+	using ComponentId = uint32_t;
+	using ComponentMask = uint64_t;
+
+	static constexpr ComponentId MAX_COMPONENTS = 64;
+
+	// type erased operations the archetype storage needs to relocate and destroy components
+	struct ComponentInfo {
+		size_t size;
+		size_t alignment;
+		void (*moveConstruct)(void* dst, void* src);
+		void (*destroy)(void* component);
+	};
+
+	class ComponentRegistry {
+	public:
+		template<typename T>
+		static ComponentId id() {
+			static const ComponentId componentId = registerComponent(makeInfo<T>());
+			return componentId;
+		}
+
+		static const ComponentInfo& info(ComponentId id);
+
+	private:
+		template<typename T>
+		static ComponentInfo makeInfo() {
+			static_assert(std::is_move_constructible_v<T>, "Components must be move constructible");
+			return {
+				sizeof(T),
+				alignof(T),
+				[](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+				[](void* component) { static_cast<T*>(component)->~T(); } };
+		}
+
+		static ComponentId registerComponent(const ComponentInfo& info);
+	};
+
+	template<typename... Ts>
+	ComponentMask componentMask() {
+		return ((ComponentMask{ 1 } << ComponentRegistry::id<Ts>()) | ... | ComponentMask{ 0 });
+	}
+
+	// All entities with exactly the same set of components. Rows are packed into fixed size chunks
+	// and every chunk stores one contiguous column per component, so a system that reads two
+	// components streams through two arrays and never touches the others.
+	class VefpArchetype {
+	public:
+		static constexpr size_t CHUNK_SIZE = 16 * 1024;
+		static constexpr size_t CHUNK_ALIGNMENT = 64;
+
+		explicit VefpArchetype(ComponentMask mask);
+		~VefpArchetype();
+
+		VefpArchetype(const VefpArchetype&) = delete;
+		VefpArchetype& operator=(const VefpArchetype&) = delete;
+
+		ComponentMask getMask() const { return mask; }
+		bool matches(ComponentMask include, ComponentMask exclude) const {
+			return (mask & include) == include && (mask & exclude) == 0;
+		}
+
+		uint32_t size() const { return count; }
+		uint32_t chunkCount() const { return (count + chunkCapacity - 1) / chunkCapacity; }
+		uint32_t chunkSize(uint32_t chunk) const { return std::min(chunkCapacity, count - chunk * chunkCapacity); }
+
+		EntityId* entities(uint32_t chunk) { return reinterpret_cast<EntityId*>(chunks[chunk]); }
+		template<typename T>
+		T* column(uint32_t chunk) {
+			assert((mask & componentMask<T>()) && "Archetype does not have this component");
+			return reinterpret_cast<T*>(chunks[chunk] + columnOffsets[ComponentRegistry::id<T>()]);
+		}
+		void* component(uint32_t row, ComponentId id) {
+			return chunks[row / chunkCapacity] + columnOffsets[id] + (row % chunkCapacity) * ComponentRegistry::info(id).size;
+		}
+		EntityId entity(uint32_t row) const {
+			return reinterpret_cast<const EntityId*>(chunks[row / chunkCapacity])[row % chunkCapacity];
+		}
+
+		// appends a row whose components are left unconstructed for the caller
+		uint32_t pushRow(EntityId entity);
+		// Destroys the row and fills the hole with the last row. Returns the entity that moved into
+		// row, or row's own entity when it was the last one.
+		EntityId removeRow(uint32_t row);
+		// Moves the components both archetypes have into a new row of dst, destroys the others and
+		// removes the row here. Components only dst has are left unconstructed.
+		uint32_t moveRow(uint32_t row, VefpArchetype& dst, EntityId& movedEntity);
+
+	private:
+		void removeRowStorage(uint32_t row, EntityId& movedEntity);
+
+		ComponentMask mask;
+		std::vector<ComponentId> components;
+		std::array<size_t, MAX_COMPONENTS> columnOffsets{};
+		uint32_t chunkCapacity = 0;
+		uint32_t count = 0;
+		std::vector<std::byte*> chunks;
+	};
+
+	template<typename... Ts>
+	class VefpQuery;
+
+	// Owns every entity and its components, grouped into archetypes. Adding or removing a component
+	// moves the entity to another archetype, so prefer spawning with the final set of components.
+	// Spawning and destroying are O(1): entity slots come from a free list, rows are swap-removed so
+	// archetypes stay densely packed, and chunks are kept around for the next spawn.
+	// Structural changes are not allowed while a query is iterating. Queries over disjoint components
+	// may iterate from several threads at once.
+	class VefpWorld {
+	public:
+		VefpWorld() = default;
+		~VefpWorld() = default;
+
+		VefpWorld(const VefpWorld&) = delete;
+		VefpWorld& operator=(const VefpWorld&) = delete;
+
+		template<typename... Ts>
+		EntityId createEntity(Ts&&... components) {
+			assertNotIterating();
+			ComponentMask mask = componentMask<std::decay_t<Ts>...>();
+			assert(countBits(mask) == sizeof...(Ts) && "An entity can only have one component of each type");
+
+			EntityId entity = allocateEntity();
+			VefpArchetype& archetype = getOrCreateArchetype(mask);
+			uint32_t row = archetype.pushRow(entity);
+			(new (archetype.component(row, ComponentRegistry::id<std::decay_t<Ts>>()))
+				std::decay_t<Ts>(std::forward<Ts>(components)), ...);
+
+			records[entity.index].archetype = &archetype;
+			records[entity.index].row = row;
+			structureVersion++;
+			return entity;
+		}
+
+		void destroyEntity(EntityId entity);
+		bool isAlive(EntityId entity) const {
+			return entity.index < records.size()
+				&& records[entity.index].generation == entity.generation
+				&& records[entity.index].archetype != nullptr;
+		}
+		uint32_t entityCount() const { return liveEntities; }
+		// changes whenever an entity is created, destroyed or gains or loses a component, so data
+		// derived from which entities match a query only has to be rebuilt when it moves on
+		uint64_t getStructureVersion() const { return structureVersion; }
+
+		template<typename T>
+		bool has(EntityId entity) const {
+			assert(isAlive(entity) && "Entity does not exist");
+			return (records[entity.index].archetype->getMask() & componentMask<T>()) != 0;
+		}
+
+		template<typename T>
+		T& get(EntityId entity) {
+			assert(has<T>(entity) && "Entity does not have this component");
+			auto& record = records[entity.index];
+			return *static_cast<T*>(record.archetype->component(record.row, ComponentRegistry::id<T>()));
+		}
+
+		template<typename T>
+		T& addComponent(EntityId entity, T&& component) {
+			using Component = std::decay_t<T>;
+			assert(!has<Component>(entity) && "Entity already has this component");
+			uint32_t row = moveEntity(entity, records[entity.index].archetype->getMask() | componentMask<Component>());
+			void* storage = records[entity.index].archetype->component(row, ComponentRegistry::id<Component>());
+			return *new (storage) Component(std::forward<T>(component));
+		}
+
+		template<typename T>
+		void removeComponent(EntityId entity) {
+			assert(has<T>(entity) && "Entity does not have this component");
+			moveEntity(entity, records[entity.index].archetype->getMask() & ~componentMask<T>());
+		}
+
+		template<typename... Ts>
+		VefpQuery<Ts...> query() { return VefpQuery<Ts...>{ *this }; }
+
+	private:
+		template<typename... Ts>
+		friend class VefpQuery;
+
+		struct EntityRecord {
+			VefpArchetype* archetype = nullptr;
+			uint32_t row = 0;
+			uint32_t generation = 0;
+		};
+
+		static uint32_t countBits(ComponentMask mask) {
+			uint32_t bits = 0;
+			for (; mask != 0; mask &= mask - 1) {
+				bits++;
+			}
+			return bits;
+		}
+
+		void assertNotIterating() const {
+			assert(iterating == 0 && "Can't change entities while a query is iterating");
+		}
+
+		// takes a slot from the free list, or a new one when there is none
+		EntityId allocateEntity();
+		VefpArchetype& getOrCreateArchetype(ComponentMask mask);
+		// moves the entity to the archetype of newMask and returns its new row
+		uint32_t moveEntity(EntityId entity, ComponentMask newMask);
+
+		std::vector<std::unique_ptr<VefpArchetype>> archetypes;
+		std::unordered_map<ComponentMask, VefpArchetype*> archetypeByMask;
+		std::vector<EntityRecord> records;
+		std::vector<uint32_t> freeIndices;
+		uint32_t liveEntities = 0;
+		uint64_t structureVersion = 0;
+		// queries of tasks running side by side count concurrently
+		std::atomic<int> iterating{ 0 };
+	};
+
+	// Iterates the entities that have all of Ts (and none of the excluded components) one chunk at a
+	// time. Only the archetypes are scanned, of which there are few, so queries are cheap to create.
+	template<typename... Ts>
+	class VefpQuery {
+	public:
+		explicit VefpQuery(VefpWorld& world) : world{ world }, includeMask{ componentMask<Ts...>() } {}
+
+		// also requires Us without reading them, for tag components
+		template<typename... Us>
+		VefpQuery& with() {
+			includeMask |= componentMask<Us...>();
+			return *this;
+		}
+
+		template<typename... Us>
+		VefpQuery& exclude() {
+			excludeMask |= componentMask<Us...>();
+			return *this;
+		}
+
+		// f(uint32_t count, Ts*... columns)
+		template<typename F>
+		void eachChunk(F&& f) {
+			forEachChunk([&](VefpArchetype& archetype, uint32_t chunk) {
+				f(archetype.chunkSize(chunk), archetype.template column<Ts>(chunk)...);
+			});
+		}
+
+		// f(Ts&...) or f(EntityId, Ts&...)
+		template<typename F>
+		void each(F&& f) {
+			forEachChunk([&](VefpArchetype& archetype, uint32_t chunk) {
+				uint32_t size = archetype.chunkSize(chunk);
+				auto columns = std::make_tuple(archetype.template column<Ts>(chunk)...);
+				if constexpr (std::is_invocable_v<F, EntityId, Ts&...>) {
+					const EntityId* entities = archetype.entities(chunk);
+					for (uint32_t i = 0; i < size; i++) {
+						std::apply([&](Ts*... column) { f(entities[i], column[i]...); }, columns);
+					}
+				}
+				else {
+					for (uint32_t i = 0; i < size; i++) {
+						std::apply([&](Ts*... column) { f(column[i]...); }, columns);
+					}
+				}
+			});
+		}
+
+		// Same as eachChunk with chunks spread over VefpParallel's worker threads. f must
+		// only write to the columns of its own chunk. The job list is allocated from scratch, pass a
+		// frame arena to keep the call off the heap.
+		template<typename F>
+		void parallelEachChunk(F&& f, std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) {
+			std::pmr::vector<std::pair<VefpArchetype*, uint32_t>> jobs{ scratch };
+			for (auto& archetype : world.archetypes) {
+				if (archetype->matches(includeMask, excludeMask)) {
+					for (uint32_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+						jobs.emplace_back(archetype.get(), chunk);
+					}
+				}
+			}
+
+			world.iterating++;
+			VefpParallel::forEach(jobs.begin(), jobs.end(), [&](const auto& job) {
+				f(job.first->chunkSize(job.second), job.first->template column<Ts>(job.second)...);
+			});
+			world.iterating--;
+		}
+
+		uint32_t count() const {
+			uint32_t total = 0;
+			for (auto& archetype : world.archetypes) {
+				if (archetype->matches(includeMask, excludeMask)) {
+					total += archetype->size();
+				}
+			}
+			return total;
+		}
+
+	private:
+		template<typename G>
+		void forEachChunk(G&& g) {
+			world.iterating++;
+			for (auto& archetype : world.archetypes) {
+				if (!archetype->matches(includeMask, excludeMask)) {
+					continue;
+				}
+				for (uint32_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+					g(*archetype, chunk);
+				}
+			}
+			world.iterating--;
+		}
+
+		VefpWorld& world;
+		ComponentMask includeMask;
+		ComponentMask excludeMask = 0;
+	};
+
+}
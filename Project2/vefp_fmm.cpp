@@ -0,0 +1,467 @@
+#include "vefp_fmm.hpp"
+#include "vefp_parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace vefp {
+
+	// Expansion coefficients are indexed by multi-index (a, b), the power of x and y, stored by total
+	// order n = a + b at n * (n + 1) / 2 + b.
+	static constexpr uint32_t termIndex(uint32_t a, uint32_t b) {
+		const uint32_t n = a + b;
+		return n * (n + 1) / 2 + b;
+	}
+
+	static constexpr uint32_t termCount(uint32_t order) {
+		return (order + 1) * (order + 2) / 2;
+	}
+
+	static constexpr uint32_t MAX_TERMS = termCount(VefpFmmEvaluator::MAX_ORDER);
+
+	static const std::array<double, VefpFmmEvaluator::MAX_ORDER + 1> inverseFactorials = [] {
+		std::array<double, VefpFmmEvaluator::MAX_ORDER + 1> table{};
+		double factorial = 1.0;
+		for (uint32_t i = 0; i < table.size(); i++) {
+			factorial *= i > 0 ? i : 1;
+			table[i] = 1.0 / factorial;
+		}
+		return table;
+	}();
+
+	// powers[i] = value^i / i!
+	static void scaledPowers(double value, uint32_t order, double* powers) {
+		double power = 1.0;
+		for (uint32_t i = 0; i <= order; i++) {
+			powers[i] = power * inverseFactorials[i];
+			power *= value;
+		}
+	}
+
+	// Derivatives d^(a+b) / dx^a dy^b of 1 / sqrt(x^2 + y^2) up to the given total order. Follows from
+	// differentiating r^2 * d/dx(1/r) = -x / r with Leibniz' rule.
+	static void kernelDerivatives(double x, double y, uint32_t order, double* derivatives) {
+		const double r2 = x * x + y * y;
+		const double invR2 = 1.0 / r2;
+		derivatives[0] = std::sqrt(invR2);
+		for (uint32_t n = 1; n <= order; n++) {
+			for (uint32_t b = 0; b <= n; b++) {
+				const uint32_t a = n - b;
+				double sum;
+				if (a > 0) {
+					sum = (2.0 * a - 1.0) * x * derivatives[termIndex(a - 1, b)];
+					if (a > 1) {
+						sum += (a - 1.0) * (a - 1.0) * derivatives[termIndex(a - 2, b)];
+					}
+					if (b > 0) {
+						sum += 2.0 * b * y * derivatives[termIndex(a, b - 1)];
+					}
+					if (b > 1) {
+						sum += b * (b - 1.0) * derivatives[termIndex(a, b - 2)];
+					}
+				}
+				else {
+					sum = (2.0 * b - 1.0) * y * derivatives[termIndex(0, b - 1)];
+					if (b > 1) {
+						sum += (b - 1.0) * (b - 1.0) * derivatives[termIndex(0, b - 2)];
+					}
+				}
+				derivatives[termIndex(a, b)] = -sum * invR2;
+			}
+		}
+	}
+
+	// same as GravityPhysicsSystem::computeForce for a unit mass, bodies on top of the point are skipped
+	static glm::vec2 bodyForce(glm::vec2 body, float mass, glm::vec2 point, float strength) {
+		const glm::vec2 offset = body - point;
+		const float distanceSquared = glm::dot(offset, offset);
+		if (distanceSquared < 1e-10f) {
+			return {};
+		}
+		return strength * mass / distanceSquared * offset / glm::sqrt(distanceSquared);
+	}
+
+	VefpFmmEvaluator::VefpFmmEvaluator() : VefpFmmEvaluator(Settings{}) {}
+
+	VefpFmmEvaluator::VefpFmmEvaluator(const Settings& settings) : settings{ settings } {
+		assert(settings.nearRadius >= 1 && "Neighbouring cells can never be expanded");
+		setOrder(settings.order);
+	}
+
+	void VefpFmmEvaluator::setOrder(uint32_t order) {
+		assert(order >= 1 && order <= MAX_ORDER && "Unsupported expansion order");
+		settings.order = order;
+		terms = termCount(order);
+	}
+
+	void VefpFmmEvaluator::evaluate(
+		std::span<const glm::vec2> bodies,
+		std::span<const float> masses,
+		std::span<const glm::vec2> points,
+		float strength,
+		std::span<glm::vec2> field) {
+		assert(bodies.size() == masses.size() && field.size() == points.size() && "Mismatched field inputs");
+		stats = {};
+		if (points.empty()) {
+			return;
+		}
+		if (bodies.empty()) {
+			std::fill(field.begin(), field.end(), glm::vec2{ 0.f });
+			return;
+		}
+
+		buildTree(bodies, points);
+		bodiesToMultipoles(bodies, masses);
+		multipolesUp();
+		multipolesToLocals();
+		localsDown();
+		evaluateLeaves(bodies, masses, points, strength, field);
+	}
+
+	void VefpFmmEvaluator::buildTree(std::span<const glm::vec2> bodies, std::span<const glm::vec2> points) {
+		glm::vec2 minCorner = points[0];
+		glm::vec2 maxCorner = points[0];
+		for (glm::vec2 p : points) {
+			minCorner = glm::min(minCorner, p);
+			maxCorner = glm::max(maxCorner, p);
+		}
+		for (glm::vec2 b : bodies) {
+			minCorner = glm::min(minCorner, b);
+			maxCorner = glm::max(maxCorner, b);
+		}
+		// padded so positions on the far edge still fall into the last cell
+		const glm::dvec2 extent = glm::dvec2(maxCorner - minCorner);
+		rootSize = std::max({ extent.x, extent.y, 1e-6 }) * 1.0001;
+		origin = glm::dvec2(minCorner) - (glm::dvec2(rootSize) - extent) * 0.5;
+
+		uint32_t depth = 0;
+		uint64_t leaves = 1;
+		while (depth < settings.maxDepth && leaves * settings.pointsPerLeaf < points.size()) {
+			depth++;
+			leaves *= 4;
+		}
+		stats.depth = depth;
+
+		levels.resize(depth + 1);
+		for (uint32_t level = 0; level <= depth; level++) {
+			Level& cells = levels[level];
+			cells.size = 1u << level;
+			const size_t cellCount = static_cast<size_t>(cells.size) * cells.size;
+			cells.multipoles.assign(cellCount * terms, 0.0);
+			cells.locals.assign(cellCount * terms, 0.0);
+			cells.bodyCounts.assign(cellCount, 0);
+			cells.pointCounts.assign(cellCount, 0);
+		}
+
+		binIntoLeaves(bodies, bodyStart, bodyOrder);
+		binIntoLeaves(points, pointStart, pointOrder);
+
+		// occupancy decides which cells take part in the translations at all
+		Level& leafLevel = levels[depth];
+		for (size_t cell = 0; cell + 1 < bodyStart.size(); cell++) {
+			leafLevel.bodyCounts[cell] = bodyStart[cell + 1] - bodyStart[cell];
+			leafLevel.pointCounts[cell] = pointStart[cell + 1] - pointStart[cell];
+		}
+		for (uint32_t level = depth; level > 0; level--) {
+			const Level& child = levels[level];
+			Level& parent = levels[level - 1];
+			for (uint32_t y = 0; y < child.size; y++) {
+				for (uint32_t x = 0; x < child.size; x++) {
+					const uint32_t parentCell = (y / 2) * parent.size + x / 2;
+					parent.bodyCounts[parentCell] += child.bodyCounts[y * child.size + x];
+					parent.pointCounts[parentCell] += child.pointCounts[y * child.size + x];
+				}
+			}
+		}
+	}
+
+	void VefpFmmEvaluator::binIntoLeaves(
+		std::span<const glm::vec2> positions,
+		std::vector<uint32_t>& start,
+		std::vector<uint32_t>& order) {
+		const uint32_t size = levels.back().size;
+		start.assign(static_cast<size_t>(size) * size + 1, 0);
+		for (glm::vec2 position : positions) {
+			start[leafOf(position) + 1]++;
+		}
+		std::partial_sum(start.begin(), start.end(), start.begin());
+
+		order.resize(positions.size());
+		cellIndices.assign(start.begin(), start.end() - 1);
+		for (uint32_t i = 0; i < positions.size(); i++) {
+			order[cellIndices[leafOf(positions[i])]++] = i;
+		}
+	}
+
+	uint32_t VefpFmmEvaluator::leafOf(glm::vec2 position) const {
+		const uint32_t size = levels.back().size;
+		const glm::dvec2 cell = (glm::dvec2(position) - origin) / rootSize * static_cast<double>(size);
+		const uint32_t x = std::min(static_cast<uint32_t>(std::max(cell.x, 0.0)), size - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>(std::max(cell.y, 0.0)), size - 1);
+		return y * size + x;
+	}
+
+	glm::dvec2 VefpFmmEvaluator::cellCenter(uint32_t level, uint32_t x, uint32_t y) const {
+		const double cellSize = rootSize / static_cast<double>(1u << level);
+		return origin + (glm::dvec2(x, y) + 0.5) * cellSize;
+	}
+
+	void VefpFmmEvaluator::bodiesToMultipoles(std::span<const glm::vec2> bodies, std::span<const float> masses) {
+		// M(a, b) = sum of mass * (-dx)^a / a! * (-dy)^b / b! over the bodies of a leaf, d = body - center
+		const uint32_t order = settings.order;
+		Level& leafLevel = levels.back();
+		std::array<double, MAX_ORDER + 1> powersX;
+		std::array<double, MAX_ORDER + 1> powersY;
+		for (uint32_t y = 0; y < leafLevel.size; y++) {
+			for (uint32_t x = 0; x < leafLevel.size; x++) {
+				const uint32_t cell = y * leafLevel.size + x;
+				if (leafLevel.bodyCounts[cell] == 0) {
+					continue;
+				}
+				const glm::dvec2 center = cellCenter(static_cast<uint32_t>(levels.size() - 1), x, y);
+				double* multipole = &leafLevel.multipoles[static_cast<size_t>(cell) * terms];
+				for (uint32_t i = bodyStart[cell]; i < bodyStart[cell + 1]; i++) {
+					const uint32_t body = bodyOrder[i];
+					const glm::dvec2 offset = center - glm::dvec2(bodies[body]);
+					scaledPowers(offset.x, order, powersX.data());
+					scaledPowers(offset.y, order, powersY.data());
+					for (uint32_t n = 0; n <= order; n++) {
+						for (uint32_t b = 0; b <= n; b++) {
+							multipole[termIndex(n - b, b)] += masses[body] * powersX[n - b] * powersY[b];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void VefpFmmEvaluator::multipolesUp() {
+		// M_parent(alpha) = sum over gamma <= alpha of M_child(gamma) * (-t)^(alpha - gamma) / (alpha - gamma)!
+		const uint32_t order = settings.order;
+		std::array<double, MAX_ORDER + 1> powersX;
+		std::array<double, MAX_ORDER + 1> powersY;
+		for (uint32_t level = static_cast<uint32_t>(levels.size() - 1); level > 0; level--) {
+			const Level& child = levels[level];
+			Level& parent = levels[level - 1];
+			for (uint32_t y = 0; y < child.size; y++) {
+				for (uint32_t x = 0; x < child.size; x++) {
+					const uint32_t childCell = y * child.size + x;
+					if (child.bodyCounts[childCell] == 0) {
+						continue;
+					}
+					const glm::dvec2 shift = cellCenter(level - 1, x / 2, y / 2) - cellCenter(level, x, y);
+					scaledPowers(shift.x, order, powersX.data());
+					scaledPowers(shift.y, order, powersY.data());
+
+					const double* from = &child.multipoles[static_cast<size_t>(childCell) * terms];
+					double* to = &parent.multipoles[static_cast<size_t>((y / 2) * parent.size + x / 2) * terms];
+					for (uint32_t n = 0; n <= order; n++) {
+						for (uint32_t b = 0; b <= n; b++) {
+							const uint32_t a = n - b;
+							double sum = 0.0;
+							for (uint32_t ga = 0; ga <= a; ga++) {
+								for (uint32_t gb = 0; gb <= b; gb++) {
+									sum += from[termIndex(ga, gb)] * powersX[a - ga] * powersY[b - gb];
+								}
+							}
+							to[termIndex(a, b)] += sum;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void VefpFmmEvaluator::multipolesToLocals() {
+		// L(beta) = sum over |alpha| + |beta| <= order of M(alpha) * D(alpha + beta)(target - source)
+		const uint32_t order = settings.order;
+		const int near = static_cast<int>(settings.nearRadius);
+		std::atomic<uint32_t> translations{ 0 };
+		for (uint32_t level = 2; level < levels.size(); level++) {
+			Level& cells = levels[level];
+			const Level& sources = levels[level];
+			const int size = static_cast<int>(cells.size);
+
+			VefpParallel::forEach(static_cast<uint32_t>(size * size), [&](uint32_t cell) {
+				if (cells.pointCounts[cell] == 0) {
+					return;
+				}
+				const int x = static_cast<int>(cell % cells.size);
+				const int y = static_cast<int>(cell / cells.size);
+				const glm::dvec2 center = cellCenter(level, x, y);
+				double* local = &cells.locals[static_cast<size_t>(cell) * terms];
+				std::array<double, MAX_TERMS> derivatives;
+				uint32_t cellTranslations = 0;
+
+				// children of the parent's neighbours that are not neighbours themselves
+				const int parentX = x / 2;
+				const int parentY = y / 2;
+				for (int sy = std::max(2 * (parentY - near), 0); sy <= std::min(2 * (parentY + near) + 1, size - 1); sy++) {
+					for (int sx = std::max(2 * (parentX - near), 0); sx <= std::min(2 * (parentX + near) + 1, size - 1); sx++) {
+						const uint32_t source = static_cast<uint32_t>(sy * size + sx);
+						if ((std::abs(sx - x) <= near && std::abs(sy - y) <= near) || sources.bodyCounts[source] == 0) {
+							continue;
+						}
+						const glm::dvec2 offset = center - cellCenter(level, sx, sy);
+						kernelDerivatives(offset.x, offset.y, order, derivatives.data());
+
+						const double* multipole = &sources.multipoles[static_cast<size_t>(source) * terms];
+						for (uint32_t n = 0; n <= order; n++) {
+							for (uint32_t b = 0; b <= n; b++) {
+								const uint32_t a = n - b;
+								double sum = 0.0;
+								for (uint32_t m = 0; m + n <= order; m++) {
+									for (uint32_t mb = 0; mb <= m; mb++) {
+										sum += multipole[termIndex(m - mb, mb)] * derivatives[termIndex(a + m - mb, b + mb)];
+									}
+								}
+								local[termIndex(a, b)] += sum;
+							}
+						}
+						cellTranslations++;
+					}
+				}
+				translations += cellTranslations;
+			});
+		}
+		stats.multipoleToLocal = translations;
+	}
+
+	void VefpFmmEvaluator::localsDown() {
+		// L_child(beta) = sum over gamma >= beta of L_parent(gamma) * t^(gamma - beta) / (gamma - beta)!
+		const uint32_t order = settings.order;
+		std::array<double, MAX_ORDER + 1> powersX;
+		std::array<double, MAX_ORDER + 1> powersY;
+		for (uint32_t level = 3; level < levels.size(); level++) {
+			const Level& parent = levels[level - 1];
+			Level& child = levels[level];
+			for (uint32_t y = 0; y < child.size; y++) {
+				for (uint32_t x = 0; x < child.size; x++) {
+					const uint32_t childCell = y * child.size + x;
+					if (child.pointCounts[childCell] == 0) {
+						continue;
+					}
+					const glm::dvec2 shift = cellCenter(level, x, y) - cellCenter(level - 1, x / 2, y / 2);
+					scaledPowers(shift.x, order, powersX.data());
+					scaledPowers(shift.y, order, powersY.data());
+
+					const double* from = &parent.locals[static_cast<size_t>((y / 2) * parent.size + x / 2) * terms];
+					double* to = &child.locals[static_cast<size_t>(childCell) * terms];
+					for (uint32_t n = 0; n <= order; n++) {
+						for (uint32_t b = 0; b <= n; b++) {
+							const uint32_t a = n - b;
+							double sum = 0.0;
+							for (uint32_t m = 0; m + n <= order; m++) {
+								for (uint32_t mb = 0; mb <= m; mb++) {
+									sum += from[termIndex(a + m - mb, b + mb)] * powersX[m - mb] * powersY[mb];
+								}
+							}
+							to[termIndex(a, b)] += sum;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void VefpFmmEvaluator::evaluateLeaves(
+		std::span<const glm::vec2> bodies,
+		std::span<const float> masses,
+		std::span<const glm::vec2> points,
+		float strength,
+		std::span<glm::vec2> field) {
+		const uint32_t order = settings.order;
+		const uint32_t leafLevel = static_cast<uint32_t>(levels.size() - 1);
+		const Level& leaves = levels[leafLevel];
+		const int size = static_cast<int>(leaves.size);
+		const int near = static_cast<int>(settings.nearRadius);
+		std::atomic<uint32_t> directPairs{ 0 };
+
+		VefpParallel::forEach(static_cast<uint32_t>(size * size), [&](uint32_t cell) {
+			if (leaves.pointCounts[cell] == 0) {
+				return;
+			}
+			const int x = static_cast<int>(cell % leaves.size);
+			const int y = static_cast<int>(cell / leaves.size);
+			const glm::dvec2 center = cellCenter(leafLevel, x, y);
+			const double* local = &leaves.locals[static_cast<size_t>(cell) * terms];
+			std::array<double, MAX_ORDER + 1> powersX;
+			std::array<double, MAX_ORDER + 1> powersY;
+			uint32_t cellPairs = 0;
+
+			for (uint32_t i = pointStart[cell]; i < pointStart[cell + 1]; i++) {
+				const uint32_t point = pointOrder[i];
+
+				// far field: gradient of the local expansion, the force is strength * grad(potential)
+				glm::dvec2 gradient{ 0.0 };
+				if (levels.size() > 2) {
+					const glm::dvec2 offset = glm::dvec2(points[point]) - center;
+					scaledPowers(offset.x, order, powersX.data());
+					scaledPowers(offset.y, order, powersY.data());
+					for (uint32_t n = 0; n < order; n++) {
+						for (uint32_t b = 0; b <= n; b++) {
+							const double power = powersX[n - b] * powersY[b];
+							gradient.x += local[termIndex(n - b + 1, b)] * power;
+							gradient.y += local[termIndex(n - b, b + 1)] * power;
+						}
+					}
+				}
+				glm::vec2 force = glm::vec2(gradient * static_cast<double>(strength));
+
+				// near field: bodies of the neighbouring leaves
+				for (int sy = std::max(y - near, 0); sy <= std::min(y + near, size - 1); sy++) {
+					for (int sx = std::max(x - near, 0); sx <= std::min(x + near, size - 1); sx++) {
+						const uint32_t source = static_cast<uint32_t>(sy * size + sx);
+						for (uint32_t j = bodyStart[source]; j < bodyStart[source + 1]; j++) {
+							const uint32_t body = bodyOrder[j];
+							force += bodyForce(bodies[body], masses[body], points[point], strength);
+						}
+						cellPairs += bodyStart[source + 1] - bodyStart[source];
+					}
+				}
+				field[point] = force;
+			}
+			directPairs += cellPairs;
+		});
+		stats.directPairs = directPairs;
+	}
+
+	glm::vec2 VefpFmmEvaluator::directSum(
+		std::span<const glm::vec2> bodies,
+		std::span<const float> masses,
+		glm::vec2 point,
+		float strength) {
+		glm::vec2 force{ 0.f };
+		for (size_t body = 0; body < bodies.size(); body++) {
+			force += bodyForce(bodies[body], masses[body], point, strength);
+		}
+		return force;
+	}
+
+	float VefpFmmEvaluator::measureError(
+		std::span<const glm::vec2> bodies,
+		std::span<const float> masses,
+		std::span<const glm::vec2> points,
+		float strength,
+		std::span<const glm::vec2> field,
+		uint32_t sampleCount) {
+		if (points.empty() || sampleCount == 0) {
+			return 0.f;
+		}
+		const size_t stride = std::max<size_t>(points.size() / sampleCount, 1);
+		float maxError = 0.f;
+		for (size_t point = 0; point < points.size(); point += stride) {
+			const glm::vec2 exact = directSum(bodies, masses, points[point], strength);
+			const float magnitude = glm::length(exact);
+			if (magnitude > 0.f) {
+				maxError = std::max(maxError, glm::length(field[point] - exact) / magnitude);
+			}
+		}
+		return maxError;
+	}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace vefp {
+
+	// Fast multipole evaluation of the gravity field of many bodies at many points,
+	//   field(x) = strength * sum_j mass_j * (body_j - x) / |body_j - x|^3,
+	// the same force GravityPhysicsSystem::computeForce gives for a unit mass. That force is the
+	// gradient of the 3d potential 1/r restricted to the plane, which is not harmonic in 2d, so the
+	// expansions are cartesian Taylor series of 1/r up to the configured order rather than complex
+	// power series.
+	//
+	// Bodies and points are binned into a uniform quadtree. Multipoles are built at the leaves and
+	// shifted up, every cell converts the multipoles of the well separated cells in its interaction
+	// list into a local expansion, locals are shifted down and evaluated at the points of each leaf.
+	// Bodies in the leaves around a point's leaf are summed directly. Cost is O(points + bodies) for
+	// a fixed order.
+	class VefpFmmEvaluator {
+	public:
+		static constexpr uint32_t MAX_ORDER = 16;
+
+		struct Settings {
+			uint32_t order = 6;
+			// tree depth is picked so leaves hold about this many points
+			uint32_t pointsPerLeaf = 16;
+			uint32_t maxDepth = 8;
+			// cells within this many cells of each other are too close to expand, a radius of 1
+			// converges with about 0.71^order, 2 with 0.47^order at 25 instead of 9 leaves of direct sums
+			uint32_t nearRadius = 2;
+		};
+
+		struct Stats {
+			uint32_t depth = 0;
+			uint32_t multipoleToLocal = 0;
+			uint32_t directPairs = 0;
+		};
+
+		VefpFmmEvaluator();
+		explicit VefpFmmEvaluator(const Settings& settings);
+
+		VefpFmmEvaluator(const VefpFmmEvaluator&) = delete;
+		VefpFmmEvaluator& operator=(const VefpFmmEvaluator&) = delete;
+
+		void setOrder(uint32_t order);
+		uint32_t getOrder() const { return settings.order; }
+		const Stats& getStats() const { return stats; }
+
+		// field has to hold points.size() elements
+		void evaluate(
+			std::span<const glm::vec2> bodies,
+			std::span<const float> masses,
+			std::span<const glm::vec2> points,
+			float strength,
+			std::span<glm::vec2> field);
+
+		static glm::vec2 directSum(std::span<const glm::vec2> bodies, std::span<const float> masses, glm::vec2 point, float strength);
+
+		// Largest error of field against the direct sum over sampleCount evenly spread points,
+		// relative to the field magnitude at that point. Costs sampleCount * bodies.
+		static float measureError(
+			std::span<const glm::vec2> bodies,
+			std::span<const float> masses,
+			std::span<const glm::vec2> points,
+			float strength,
+			std::span<const glm::vec2> field,
+			uint32_t sampleCount);
+
+	private:
+		struct Level {
+			uint32_t size;  // cells per axis
+			std::vector<double> multipoles;
+			std::vector<double> locals;
+			std::vector<uint32_t> bodyCounts;
+			std::vector<uint32_t> pointCounts;
+		};
+
+		void buildTree(std::span<const glm::vec2> bodies, std::span<const glm::vec2> points);
+		// counting sort of positions into leaf cells, start has leafCount + 1 entries
+		void binIntoLeaves(std::span<const glm::vec2> positions, std::vector<uint32_t>& start, std::vector<uint32_t>& order);
+		void bodiesToMultipoles(std::span<const glm::vec2> bodies, std::span<const float> masses);
+		void multipolesUp();
+		void multipolesToLocals();
+		void localsDown();
+		void evaluateLeaves(
+			std::span<const glm::vec2> bodies,
+			std::span<const float> masses,
+			std::span<const glm::vec2> points,
+			float strength,
+			std::span<glm::vec2> field);
+
+		glm::dvec2 cellCenter(uint32_t level, uint32_t x, uint32_t y) const;
+		uint32_t leafOf(glm::vec2 position) const;
+
+		Settings settings;
+		uint32_t terms = 0;
+		Stats stats{};
+
+		// square root cell of the tree
+		glm::dvec2 origin{};
+		double rootSize = 1.0;
+		std::vector<Level> levels;
+
+		std::vector<uint32_t> bodyStart;
+		std::vector<uint32_t> bodyOrder;
+		std::vector<uint32_t> pointStart;
+		std::vector<uint32_t> pointOrder;
+		std::vector<uint32_t> cellIndices;
+	};
+
+}
@@ -0,0 +1,92 @@
+#include "vefp_frame_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <stdexcept>
+
+namespace vefp {
+
+	VefpFrameArena::VefpFrameArena(size_t blockSize) {
+		addBlock(blockSize);
+	}
+
+	VefpFrameArena::~VefpFrameArena() {
+		freeBlocks();
+	}
+
+	void VefpFrameArena::reset() {
+		if (blocks.size() > 1) {
+			size_t totalSize = capacityBytes;
+			freeBlocks();
+			addBlock(totalSize);
+		}
+		head = 0;
+		usedBytes = 0;
+	}
+
+	void* VefpFrameArena::do_allocate(size_t bytes, size_t alignment) {
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+		Block* block = &blocks.back();
+		auto address = reinterpret_cast<uintptr_t>(block->data) + head;
+		size_t padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+		if (head + padding + bytes > block->size) {
+			addBlock(std::max(block->size, bytes + alignment));
+			block = &blocks.back();
+			address = reinterpret_cast<uintptr_t>(block->data);
+			padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+		}
+
+		head += padding + bytes;
+		usedBytes += padding + bytes;
+		peakBytes = std::max(peakBytes, usedBytes);
+		return block->data + head - bytes;
+	}
+
+	void VefpFrameArena::addBlock(size_t size) {
+		auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t{ BLOCK_ALIGNMENT }));
+		blocks.push_back({ data, size });
+		head = 0;
+		capacityBytes += size;
+	}
+
+	void VefpFrameArena::freeBlocks() {
+		for (auto& block : blocks) {
+			::operator delete(block.data, std::align_val_t{ BLOCK_ALIGNMENT });
+		}
+		blocks.clear();
+		capacityBytes = 0;
+	}
+
+	VefpFrameAllocator::VefpFrameAllocator(uint32_t framesInFlight, size_t blockSize)
+		: framesInFlight{ framesInFlight }, blockSize{ blockSize }, arenas(framesInFlight * MAX_THREADS) {}
+
+	void VefpFrameAllocator::beginFrame(int frameIndex) {
+		assert(frameIndex >= 0 && frameIndex < static_cast<int>(framesInFlight) && "Frame index out of range");
+		for (uint32_t slot = 0; slot < MAX_THREADS; slot++) {
+			if (auto& arena = arenas[frameIndex * MAX_THREADS + slot]) {
+				arena->reset();
+			}
+		}
+		currentFrameIndex = frameIndex;
+	}
+
+	VefpFrameArena& VefpFrameAllocator::arena() {
+		// every slot belongs to a single thread, so creating it needs no lock
+		auto& arena = arenas[currentFrameIndex * MAX_THREADS + threadSlot()];
+		if (!arena) {
+			arena = std::make_unique<VefpFrameArena>(blockSize);
+		}
+		return *arena;
+	}
+
+	uint32_t VefpFrameAllocator::threadSlot() {
+		static std::atomic<uint32_t> nextSlot{ 0 };
+		thread_local const uint32_t slot = nextSlot++;
+		if (slot >= MAX_THREADS) {
+			throw std::runtime_error("too many threads for frame allocator!");
+		}
+		return slot;
+	}
+
+}
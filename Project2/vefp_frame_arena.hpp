@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace vefp {
+
+	// Bump allocator for data that only has to live until the arena is reset. It is a
+	// std::pmr::memory_resource so std::pmr containers can use it directly. Deallocation is a no-op,
+	// everything is released at once by reset. When a frame needs more than one block, reset merges
+	// them into a single block of the combined size, so after a few frames the arena stops touching
+	// the heap.
+	class VefpFrameArena : public std::pmr::memory_resource {
+	public:
+		static constexpr size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+		static constexpr size_t BLOCK_ALIGNMENT = 64;
+
+		explicit VefpFrameArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+		~VefpFrameArena();
+
+		VefpFrameArena(const VefpFrameArena&) = delete;
+		VefpFrameArena& operator=(const VefpFrameArena&) = delete;
+
+		// uninitialized storage for count Ts, never destroyed by the arena
+		template<typename T>
+		T* allocateArray(size_t count) {
+			return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		void reset();
+
+		size_t used() const { return usedBytes; }
+		size_t capacity() const { return capacityBytes; }
+		// most bytes handed out between two resets
+		size_t peak() const { return peakBytes; }
+
+	private:
+		struct Block {
+			std::byte* data;
+			size_t size;
+		};
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		void addBlock(size_t size);
+		void freeBlocks();
+
+		std::vector<Block> blocks;
+		size_t head = 0;  // offset into blocks.back()
+		size_t usedBytes = 0;
+		size_t capacityBytes = 0;
+		size_t peakBytes = 0;
+	};
+
+	// One VefpFrameArena per frame in flight and thread. Memory from arena() stays valid until the
+	// same frame index begins again, so it may be handed to work that finishes with the frame.
+	// Threads get a slot the first time they allocate, the arena of a slot is created lazily so
+	// threads that never allocate cost nothing.
+	class VefpFrameAllocator {
+	public:
+		static constexpr uint32_t MAX_THREADS = 64;
+
+		VefpFrameAllocator(uint32_t framesInFlight, size_t blockSize = VefpFrameArena::DEFAULT_BLOCK_SIZE);
+
+		VefpFrameAllocator(const VefpFrameAllocator&) = delete;
+		VefpFrameAllocator& operator=(const VefpFrameAllocator&) = delete;
+
+		// rewinds every arena of frameIndex, only call once the frame's previous use has finished
+		void beginFrame(int frameIndex);
+		// arena of the calling thread for the current frame
+		VefpFrameArena& arena();
+
+	private:
+		static uint32_t threadSlot();
+
+		const uint32_t framesInFlight;
+		const size_t blockSize;
+		std::vector<std::unique_ptr<VefpFrameArena>> arenas;  // [frameIndex * MAX_THREADS + threadSlot]
+		std::atomic<int> currentFrameIndex{ 0 };
+	};
+
+}
@@ -0,0 +1,94 @@
+#include "vefp_frame_pacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace vefp {
+
+	VefpFramePacer::VefpFramePacer(float targetFps) {
+		setTargetFps(targetFps);
+	}
+
+	void VefpFramePacer::setTargetFps(float fps) {
+		targetFps = std::max(fps, 0.f);
+		framePeriod = targetFps > 0.f
+			? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps))
+			: Clock::duration{ 0 };
+		nextFrame = Clock::now();
+	}
+
+	void VefpFramePacer::waitForNextFrame() {
+		if (framePeriod.count() > 0) {
+			sleepUntil(nextFrame);
+
+			// a frame that ran long starts a new schedule instead of rushing the following frames
+			const auto now = Clock::now();
+			nextFrame += framePeriod;
+			if (nextFrame < now) {
+				nextFrame = now + framePeriod;
+			}
+		}
+
+		inputSampled = Clock::now();
+		if (windowFrames == 0) {
+			windowStart = inputSampled;
+		}
+		windowFrames++;
+	}
+
+	void VefpFramePacer::sleepUntil(Clock::time_point deadline) {
+		const auto now = Clock::now();
+		if (deadline - now > SPIN_THRESHOLD) {
+			std::this_thread::sleep_for(deadline - now - SPIN_THRESHOLD);
+		}
+		while (Clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+	}
+
+	void VefpFramePacer::frameSubmitted(uint64_t timelineValue) {
+		if (pendingFrames.size() == MAX_PENDING_FRAMES) {
+			pendingFrames.pop_front();
+		}
+		pendingFrames.push_back({ timelineValue, inputSampled });
+	}
+
+	bool VefpFramePacer::update(VefpTimeline& timeline) {
+		if (!pendingFrames.empty()) {
+			uint64_t completed = timeline.completedValue();
+			auto now = Clock::now();
+			while (!pendingFrames.empty() && pendingFrames.front().timelineValue <= completed) {
+				// completion is only observed when update runs, so this is an upper bound
+				double latencyMs =
+					std::chrono::duration<double, std::milli>(now - pendingFrames.front().inputSampled).count();
+				pendingFrames.pop_front();
+
+				latencyMinMs = latencySamples == 0 ? latencyMs : std::min(latencyMinMs, latencyMs);
+				latencyMaxMs = latencySamples == 0 ? latencyMs : std::max(latencyMaxMs, latencyMs);
+				latencySumMs += latencyMs;
+				latencySamples++;
+			}
+		}
+
+		// frame time is measured between input samples, which the limiter keeps evenly spaced
+		auto elapsed = inputSampled - windowStart;
+		if (windowFrames < 2 || elapsed < STATS_INTERVAL) {
+			return false;
+		}
+
+		stats.frameTimeMs = static_cast<float>(
+			std::chrono::duration<double, std::milli>(elapsed).count() / (windowFrames - 1));
+		stats.latencyAvgMs = latencySamples > 0 ? static_cast<float>(latencySumMs / latencySamples) : 0.f;
+		stats.latencyMinMs = static_cast<float>(latencyMinMs);
+		stats.latencyMaxMs = static_cast<float>(latencyMaxMs);
+		stats.frames = windowFrames - 1;
+
+		windowFrames = 0;
+		latencySamples = 0;
+		latencySumMs = 0.0;
+		latencyMinMs = 0.0;
+		latencyMaxMs = 0.0;
+		return true;
+	}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "vefp_timeline.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace vefp {
+
+	// Caps the frame rate by sleeping at the top of the frame, before input is polled, so the time
+	// spent waiting is not added to the age of the input a frame is built from. It also measures the
+	// latency from sampling input until the frame's gpu work has completed, which is the part of
+	// input-to-photon latency the application controls.
+	class VefpFramePacer {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Stats {
+			float frameTimeMs = 0.f;
+			float latencyAvgMs = 0.f;
+			float latencyMinMs = 0.f;
+			float latencyMaxMs = 0.f;
+			uint32_t frames = 0;
+		};
+
+		// targetFps of 0 leaves the frame rate to the present mode
+		explicit VefpFramePacer(float targetFps = 0.f);
+
+		VefpFramePacer(const VefpFramePacer&) = delete;
+		VefpFramePacer& operator=(const VefpFramePacer&) = delete;
+
+		void setTargetFps(float fps);
+		float getTargetFps() const { return targetFps; }
+
+		// Sleeps until the next frame is due and marks the input sample time, poll input right after.
+		void waitForNextFrame();
+		// Sleeps most of the way and yields for the rest, sleep_until alone can wake up a scheduler
+		// tick late, about 15 ms on Windows.
+		static void sleepUntil(Clock::time_point deadline);
+		// timelineValue is the frame timeline value signalled by the frame that was just submitted
+		void frameSubmitted(uint64_t timelineValue);
+		// Collects frames the gpu has finished, returns true when new stats were published.
+		bool update(VefpTimeline& timeline);
+
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct PendingFrame {
+			uint64_t timelineValue;
+			Clock::time_point inputSampled;
+		};
+
+		// sleep_for overshoots by up to a scheduler tick, the rest of the wait is spent yielding
+		static constexpr std::chrono::microseconds SPIN_THRESHOLD{ 2000 };
+		static constexpr std::chrono::milliseconds STATS_INTERVAL{ 500 };
+		static constexpr size_t MAX_PENDING_FRAMES = 16;
+
+		float targetFps = 0.f;
+		Clock::duration framePeriod{ 0 };
+		Clock::time_point nextFrame{};
+
+		Clock::time_point inputSampled{};
+		std::deque<PendingFrame> pendingFrames;
+
+		// accumulated for the current stats window
+		Clock::time_point windowStart{};
+		uint32_t windowFrames = 0;
+		uint32_t latencySamples = 0;
+		double latencySumMs = 0.0;
+		double latencyMinMs = 0.0;
+		double latencyMaxMs = 0.0;
+
+		Stats stats{};
+	};
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+
+namespace vefp {
+
+	// One T per frame in flight, indexed with VefpRenderer::getFrameIndex(). While a frame is being
+	// recorded the swap chain has already waited for the previous use of its slot, so the slot can be
+	// rewritten without further synchronization.
+	template<typename T>
+	class VefpFrameRing {
+	public:
+		VefpFrameRing() = default;
+
+		// every slot is constructed in place from the same arguments
+		template<typename... Args>
+		explicit VefpFrameRing(uint32_t framesInFlight, Args&&... args) {
+			for (uint32_t i = 0; i < framesInFlight; i++) {
+				frames.emplace_back(args...);
+			}
+		}
+
+		T& operator[](int frameIndex) {
+			assert(frameIndex >= 0 && frameIndex < static_cast<int>(frames.size()) && "Frame index out of range");
+			return frames[frameIndex];
+		}
+		const T& operator[](int frameIndex) const {
+			assert(frameIndex >= 0 && frameIndex < static_cast<int>(frames.size()) && "Frame index out of range");
+			return frames[frameIndex];
+		}
+
+		uint32_t size() const { return static_cast<uint32_t>(frames.size()); }
+
+		auto begin() { return frames.begin(); }
+		auto end() { return frames.end(); }
+		auto begin() const { return frames.begin(); }
+		auto end() const { return frames.end(); }
+
+	private:
+		// deque never relocates its elements, so T does not have to be movable
+		std::deque<T> frames;
+	};
+
+}
@@ -0,0 +1,51 @@
+#include "vefp_lod_model.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+namespace vefp {
+
+	VefpLodModel::VefpLodModel(std::vector<Level> lodLevels, float hysteresis)
+		: levels{ std::move(lodLevels) }, hysteresis{ hysteresis } {
+		assert(!levels.empty() && "Lod model needs at least one level");
+		for (size_t i = 1; i < levels.size(); i++) {
+			assert(levels[i].minPixelSize <= levels[i - 1].minPixelSize && "Lod levels must go from finest to coarsest");
+		}
+
+		const Aabb2d& bounds = levels[0].model->getBounds();
+		radius = glm::length(glm::max(glm::abs(bounds.min), glm::abs(bounds.max)));
+	}
+
+	bool VefpLodModel::containsModel(const VefpModel* model) const {
+		return std::any_of(levels.begin(), levels.end(), [&](const Level& level) { return level.model.get() == model; });
+	}
+
+	uint32_t VefpLodModel::selectLevel(float pixelSize, uint32_t currentLevel) const {
+		uint32_t level = std::min(currentLevel, getLevelCount() - 1);
+		// finer levels need the size to clear the threshold by the band, coarser ones to fall below it
+		while (level > 0 && pixelSize >= levels[level - 1].minPixelSize * (1.f + hysteresis)) {
+			level--;
+		}
+		while (level + 1 < levels.size() && pixelSize < levels[level].minPixelSize * (1.f - hysteresis)) {
+			level++;
+		}
+		return level;
+	}
+
+	float VefpLodModel::maxCirclePixelSize(uint32_t sides, float tolerancePixels) {
+		// an edge deviates from the circle by r * (1 - cos(pi / sides)) at its midpoint
+		const float deviation = 1.f - glm::cos(glm::pi<float>() / static_cast<float>(sides));
+		if (deviation <= 0.f) {
+			return std::numeric_limits<float>::max();
+		}
+		return 2.f * tolerancePixels / deviation;
+	}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vefp_model.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace vefp {
+
+	// A model tessellated at several levels of detail. Levels go from finest to coarsest, each one
+	// is used while the object's projected diameter is at least its minPixelSize, the coarsest
+	// level covers everything smaller. Switching is damped by a hysteresis band around every
+	// threshold so objects hovering at a boundary do not flip levels each frame.
+	class VefpLodModel {
+	public:
+		static constexpr float DEFAULT_HYSTERESIS = 0.15f;
+
+		struct Level {
+			std::shared_ptr<VefpModel> model;
+			float minPixelSize;
+		};
+
+		explicit VefpLodModel(std::vector<Level> levels, float hysteresis = DEFAULT_HYSTERESIS);
+
+		VefpLodModel(const VefpLodModel&) = delete;
+		VefpLodModel& operator=(const VefpLodModel&) = delete;
+
+		uint32_t getLevelCount() const { return static_cast<uint32_t>(levels.size()); }
+		const std::shared_ptr<VefpModel>& getModel(uint32_t level) const { return levels[level].model; }
+		bool containsModel(const VefpModel* model) const;
+		// distance of the farthest vertex of the finest level from the model origin
+		float getRadius() const { return radius; }
+
+		// level to draw at pixelSize, given the level the object was drawn with last
+		uint32_t selectLevel(float pixelSize, uint32_t currentLevel) const;
+
+		// largest projected diameter at which a regular polygon with this many sides stays within
+		// tolerancePixels of the circle it approximates
+		static float maxCirclePixelSize(uint32_t sides, float tolerancePixels);
+
+	private:
+		std::vector<Level> levels;
+		float hysteresis;
+		float radius = 0.f;
+	};
+
+}
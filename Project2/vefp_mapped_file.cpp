@@ -0,0 +1,90 @@
+#include "vefp_mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vefp {
+
+#ifdef _WIN32
+
+	VefpMappedFile::VefpMappedFile(const std::string& filepath) {
+		fileHandle = CreateFileA(
+			filepath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			fileHandle = nullptr;
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+			CloseHandle(fileHandle);
+			throw std::runtime_error("failed to map empty file: " + filepath);
+		}
+		fileSize = static_cast<size_t>(size.QuadPart);
+
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) {
+			CloseHandle(fileHandle);
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+		mapped = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (mapped == nullptr) {
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+	}
+
+	VefpMappedFile::~VefpMappedFile() {
+		UnmapViewOfFile(mapped);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+	}
+
+#else
+
+	VefpMappedFile::VefpMappedFile(const std::string& filepath) {
+		fileDescriptor = open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		struct stat status {};
+		if (fstat(fileDescriptor, &status) != 0 || status.st_size == 0) {
+			close(fileDescriptor);
+			throw std::runtime_error("failed to map empty file: " + filepath);
+		}
+		fileSize = static_cast<size_t>(status.st_size);
+
+		void* data = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (data == MAP_FAILED) {
+			close(fileDescriptor);
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+		mapped = static_cast<const std::byte*>(data);
+	}
+
+	VefpMappedFile::~VefpMappedFile() {
+		munmap(const_cast<std::byte*>(mapped), fileSize);
+		close(fileDescriptor);
+	}
+
+#endif
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vefp {
+
+	// Read only memory mapping of a whole file. Pages are loaded by the OS on first access, so
+	// opening a large file is cheap and only the parts that are read cost anything.
+	class VefpMappedFile {
+	public:
+		explicit VefpMappedFile(const std::string& filepath);
+		~VefpMappedFile();
+
+		VefpMappedFile(const VefpMappedFile&) = delete;
+		VefpMappedFile& operator=(const VefpMappedFile&) = delete;
+
+		const std::byte* data() const { return mapped; }
+		size_t size() const { return fileSize; }
+
+	private:
+		const std::byte* mapped = nullptr;
+		size_t fileSize = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+
+}
@@ -1,12 +1,28 @@
 #include "vefp_model.hpp"
 
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 
 
 namespace vefp {
-	VefpModel::VefpModel(VefpDevice& device, const std::vector<Vertex>& vertices) : vefpDevice{ device } {
-		createVertexBuffers(vertices);
+	VefpModel::VefpModel(VefpDevice& device, const std::vector<Vertex>& vertices, const VefpVertexLayout& layout)
+		: vefpDevice{ device }, layout{ layout } {
+		createVertexBuffers(encodeVertices(vertices));
+		computeBounds(vertices);
+	}
+
+	VefpModel::VefpModel(
+		VefpDevice& device,
+		VefpUploadService& uploadService,
+		const std::vector<Vertex>& vertices,
+		const VefpVertexLayout& layout)
+		: vefpDevice{ device }, layout{ layout } {
+		createDeviceLocalVertexBuffers(uploadService, encodeVertices(vertices));
+		computeBounds(vertices);
 	}
 
 	VefpModel::~VefpModel() {
@@ -14,10 +30,8 @@ namespace vefp {
 		vkFreeMemory(vefpDevice.device(), vertexBufferMemory, nullptr);
 	}
 
-	void VefpModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+	void VefpModel::createVertexBuffers(const std::vector<uint8_t>& vertexData) {
+		VkDeviceSize bufferSize = vertexData.size();
 		vefpDevice.createBuffer(
 			bufferSize,
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
@@ -27,10 +41,74 @@ namespace vefp {
 
 		void* data;
 		vkMapMemory(vefpDevice.device(), vertexBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
+		memcpy(data, vertexData.data(), static_cast<size_t>(bufferSize));
 		vkUnmapMemory(vefpDevice.device(), vertexBufferMemory);
 	}
 
+	void VefpModel::createDeviceLocalVertexBuffers(
+		VefpUploadService& uploadService,
+		const std::vector<uint8_t>& vertexData) {
+		VkDeviceSize bufferSize = vertexData.size();
+		vefpDevice.createBuffer(
+			bufferSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			vertexBuffer,
+			vertexBufferMemory);
+
+		uploadService.uploadBuffer(
+			vertexBuffer,
+			0,
+			vertexData.data(),
+			bufferSize,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+	}
+
+	void VefpModel::computeBounds(const std::vector<Vertex>& vertices) {
+		bounds = { vertices[0].position, vertices[0].position };
+		for (auto& v : vertices) {
+			bounds.min = glm::min(bounds.min, v.position);
+			bounds.max = glm::max(bounds.max, v.position);
+		}
+	}
+
+	std::vector<uint8_t> VefpModel::encodeVertices(const std::vector<Vertex>& vertices) {
+		vertexCount = static_cast<uint32_t>(vertices.size());
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
+
+		if (layout.position == VefpVertexLayout::PositionFormat::Snorm16) {
+			// normalize against the largest coordinate so the full 16 bit range is used
+			positionScale = 1e-6f;
+			for (auto& v : vertices) {
+				positionScale = std::max({ positionScale, std::abs(v.position.x), std::abs(v.position.y) });
+			}
+		}
+
+		const uint32_t stride = layout.stride();
+		std::vector<uint8_t> data(static_cast<size_t>(stride) * vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			const Vertex& v = vertices[i];
+			uint8_t* out = data.data() + static_cast<size_t>(stride) * i;
+			if (layout.position == VefpVertexLayout::PositionFormat::Float32) {
+				memcpy(out, &v.position, sizeof(glm::vec2));
+			}
+			else {
+				const uint32_t position = glm::packSnorm2x16(v.position / positionScale);
+				memcpy(out, &position, sizeof(position));
+			}
+			if (layout.color) {
+				const uint32_t color = glm::packUnorm4x8(glm::vec4(v.color, 1.f));
+				memcpy(out + layout.colorOffset(), &color, sizeof(color));
+			}
+			if (layout.uv) {
+				const uint32_t uv = glm::packHalf2x16(v.uv);
+				memcpy(out + layout.uvOffset(), &uv, sizeof(uv));
+			}
+		}
+		return data;
+	}
+
 	void VefpModel::draw(VkCommandBuffer commandBuffer) {
 		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
 	}
@@ -40,25 +118,4 @@ namespace vefp {
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 	}
-
-	std::vector<VkVertexInputBindingDescription> VefpModel::Vertex::getBindingDescriptions() {
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return bindingDescriptions;
-	}
-	std::vector<VkVertexInputAttributeDescription> VefpModel::Vertex::getAttributeDescriptions() {
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-		return attributeDescriptions;
-	}
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "vefp_device.hpp"
+#include "vefp_bounds.hpp"
+#include "vefp_upload_service.hpp"
+#include "vefp_vertex_layout.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -13,13 +16,18 @@ namespace vefp {
 		 struct Vertex {
 			 glm::vec2 position;
 			 glm::vec3 color;
-
-			 static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-			 static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
-
+			 glm::vec2 uv;
 		 };
 
-		 VefpModel(VefpDevice &device, const std::vector<Vertex>& vertices);
+		 // vertices are converted to the given layout, attributes it does not contain are dropped
+		 VefpModel(VefpDevice &device, const std::vector<Vertex>& vertices, const VefpVertexLayout& layout = {});
+		 // vertices go to device local memory through the transfer queue, the model can be drawn once
+		 // a frame has acquired the uploads
+		 VefpModel(
+			 VefpDevice& device,
+			 VefpUploadService& uploadService,
+			 const std::vector<Vertex>& vertices,
+			 const VefpVertexLayout& layout = {});
 		 ~VefpModel();
 
 		 VefpModel(const VefpModel&) = delete;
@@ -28,13 +36,25 @@ namespace vefp {
 		 void bind(VkCommandBuffer commandBuffer);
 		 void draw(VkCommandBuffer commandBuffer);
 
+		 const Aabb2d& getBounds() const { return bounds; }
+		 uint32_t getVertexCount() const { return vertexCount; }
+		 const VefpVertexLayout& getVertexLayout() const { return layout; }
+		 // Snorm16 positions are stored divided by this, the vertex transform has to scale them back
+		 float getPositionScale() const { return positionScale; }
+
 	 private:
 
-		 void createVertexBuffers(const std::vector<Vertex> &vertices);
+		 void createVertexBuffers(const std::vector<uint8_t>& vertexData);
+		 void createDeviceLocalVertexBuffers(VefpUploadService& uploadService, const std::vector<uint8_t>& vertexData);
+		 void computeBounds(const std::vector<Vertex>& vertices);
+		 std::vector<uint8_t> encodeVertices(const std::vector<Vertex>& vertices);
 
 		 VefpDevice& vefpDevice;
 		 VkBuffer vertexBuffer;
 		 VkDeviceMemory vertexBufferMemory;
 		 uint32_t vertexCount;
+		 Aabb2d bounds{};
+		 VefpVertexLayout layout;
+		 float positionScale = 1.f;
 	};
 }
\ No newline at end of file
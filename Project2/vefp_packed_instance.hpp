@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vefp_components.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstdint>
+
+namespace vefp {
+
+	// 16 byte per object encoding streamed to the gpu each frame, a third of a full mat2, offset and
+	// color. Shaders rebuild the transform with objectTransform(), so the cpu never evaluates sin
+	// and cos for it. Half floats keep about 3 decimal digits, enough for positions within a few
+	// units of the origin.
+	struct VefpPackedInstance {
+		uint32_t offset;         // half2 translation
+		uint32_t scale;          // half2
+		uint32_t rotationBatch;  // low 16 bits rotation in 1/65536 turns, high 16 bits batch index
+		uint32_t color;          // RGBA8 unorm
+
+		static constexpr uint32_t MAX_BATCHES = 1u << 16;
+
+		static VefpPackedInstance pack(const Transform2dComponent& transform, glm::vec3 color, uint32_t batch) {
+			const float turns = transform.rotation / glm::two_pi<float>();
+			const auto rotation = static_cast<uint32_t>((turns - glm::floor(turns)) * 65536.f) & 0xffffu;
+
+			VefpPackedInstance instance{};
+			instance.offset = glm::packHalf2x16(transform.translation);
+			instance.scale = glm::packHalf2x16(transform.scale);
+			instance.rotationBatch = rotation | (batch << 16);
+			instance.color = glm::packUnorm4x8(glm::vec4(color, 1.f));
+			return instance;
+		}
+	};
+	static_assert(sizeof(VefpPackedInstance) == 16, "VefpPackedInstance must match ObjectData in the shaders");
+
+}
@@ -0,0 +1,96 @@
+#include "vefp_parallel.hpp"
+#include "vefp_alloc_counter.hpp"
+
+#include <algorithm>
+
+namespace vefp {
+
+	VefpParallel::VefpParallel() {
+		// the thread starting a loop works on it as well
+		const uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back(&VefpParallel::workerLoop, this);
+		}
+	}
+
+	VefpParallel::~VefpParallel() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		loopAdded.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	VefpParallel& VefpParallel::pool() {
+		static VefpParallel instance;
+		return instance;
+	}
+
+	void VefpParallel::run(Loop& loop) {
+		if (loop.count > 1 && !workers.empty()) {
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				loop.nextLoop = loops;
+				loops = &loop;
+			}
+			loopAdded.notify_all();
+		}
+
+		work(loop);
+
+		// once no worker can join anymore, the loop is done when the last one inside leaves
+		std::unique_lock<std::mutex> lock{ mutex };
+		unlink(loop);
+		workerLeft.wait(lock, [&] { return loop.activeWorkers == 0; });
+		VefpAllocCounter::addThreadAllocations(loop.workerAllocations);
+	}
+
+	void VefpParallel::work(Loop& loop) {
+		for (uint32_t index = loop.next.fetch_add(1, std::memory_order_relaxed); index < loop.count;
+			index = loop.next.fetch_add(1, std::memory_order_relaxed)) {
+			loop.invoke(loop.context, index);
+		}
+	}
+
+	void VefpParallel::unlink(Loop& loop) {
+		for (Loop** link = &loops; *link != nullptr; link = &(*link)->nextLoop) {
+			if (*link == &loop) {
+				*link = loop.nextLoop;
+				return;
+			}
+		}
+	}
+
+	void VefpParallel::workerLoop() {
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (true) {
+			loopAdded.wait(lock, [&] { return stopping || loops != nullptr; });
+			if (stopping) {
+				return;
+			}
+
+			// loops with every index handed out only wait for the threads still running them
+			Loop& loop = *loops;
+			if (loop.next.load(std::memory_order_relaxed) >= loop.count) {
+				unlink(loop);
+				continue;
+			}
+
+			loop.activeWorkers++;
+			lock.unlock();
+			const uint64_t allocations = VefpAllocCounter::threadAllocations();
+			work(loop);
+			const uint64_t loopAllocations = VefpAllocCounter::threadAllocations() - allocations;
+			lock.lock();
+
+			loop.workerAllocations += loopAllocations;
+			if (--loop.activeWorkers == 0) {
+				workerLeft.notify_all();
+			}
+		}
+	}
+
+}
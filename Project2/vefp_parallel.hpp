@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vefp {
+
+	// Data parallel loops on a pool of persistent worker threads, used instead of
+	// std::execution::par, whose implementations allocate on every call. A loop lives on the stack of
+	// the thread that starts it, which works through it together with the pool, so loops never touch
+	// the heap and loops started from inside a loop or from several threads at once still finish.
+	// As with std::execution::par the loop body must not throw.
+	class VefpParallel {
+	public:
+		// f(index) for every index in [0, count)
+		template<typename F>
+		static void forEach(uint32_t count, F&& f) {
+			if (count == 0) {
+				return;
+			}
+			Loop loop{};
+			loop.count = count;
+			loop.context = const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+			loop.invoke = [](void* context, uint32_t index) {
+				(*static_cast<std::remove_reference_t<F>*>(context))(index);
+			};
+			pool().run(loop);
+		}
+
+		// f(element) for every element of the random access range
+		template<typename Iterator, typename F>
+		static void forEach(Iterator first, Iterator last, F&& f) {
+			forEach(static_cast<uint32_t>(last - first), [&](uint32_t index) { f(first[index]); });
+		}
+
+		static uint32_t workerCount() { return static_cast<uint32_t>(pool().workers.size()); }
+
+	private:
+		struct Loop {
+			void* context;
+			void (*invoke)(void* context, uint32_t index);
+			uint32_t count = 0;
+			std::atomic<uint32_t> next{ 0 };
+
+			// guarded by the pool mutex
+			Loop* nextLoop = nullptr;
+			uint32_t activeWorkers = 0;
+			// made by workers on behalf of the thread that started the loop
+			uint64_t workerAllocations = 0;
+		};
+
+		VefpParallel();
+		~VefpParallel();
+
+		VefpParallel(const VefpParallel&) = delete;
+		VefpParallel& operator=(const VefpParallel&) = delete;
+
+		static VefpParallel& pool();
+
+		void run(Loop& loop);
+		static void work(Loop& loop);
+		void unlink(Loop& loop);
+		void workerLoop();
+
+		std::mutex mutex;
+		// workers wait for loops, starting threads for the workers still inside their loop
+		std::condition_variable loopAdded;
+		std::condition_variable workerLeft;
+		Loop* loops = nullptr;
+		bool stopping = false;
+		std::vector<std::thread> workers;
+	};
+
+}
@@ -71,8 +71,8 @@ namespace vefp {
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = VefpModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = VefpModel::Vertex::getAttributeDescriptions();
+		const auto& bindingDescriptions = configInfo.bindingDescriptions;
+		const auto& attributeDescriptions = configInfo.attributeDescriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -81,7 +81,7 @@ namespace vefp {
 		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.stageCount = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 		pipelineInfo.stageCount = 2;
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -187,5 +187,53 @@ namespace vefp {
 		configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
 		configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 		configInfo.dynamicStateInfo.flags = 0;
+
+		setVertexLayout(configInfo, VefpVertexLayout{});
+	}
+
+	void VefpPipeline::setVertexLayout(PipelineConfigInfo& configInfo, const VefpVertexLayout& layout) {
+		configInfo.bindingDescriptions = layout.getBindingDescriptions();
+		configInfo.attributeDescriptions = layout.getAttributeDescriptions();
+	}
+
+	VefpComputePipeline::VefpComputePipeline(
+		VefpDevice& device,
+		const std::string& compFilepath,
+		VkPipelineLayout pipelineLayout)
+		: vefpDevice{ device } {
+		assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline:: no pipelineLayout provided");
+
+		auto compCode = VefpPipeline::readFile(compFilepath);
+
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = compCode.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+		if (vkCreateShaderModule(vefpDevice.device(), &moduleInfo, nullptr, &compShaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shader module");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(vefpDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+	}
+
+	VefpComputePipeline::~VefpComputePipeline() {
+		vkDestroyShaderModule(vefpDevice.device(), compShaderModule, nullptr);
+		vkDestroyPipeline(vefpDevice.device(), computePipeline, nullptr);
+	}
+
+	void VefpComputePipeline::bind(VkCommandBuffer commandBuffer) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
 	}
 }
\ No newline at end of file
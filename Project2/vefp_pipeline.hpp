@@ -1,6 +1,7 @@
 #pragma once	
 
 #include "vefp_device.hpp"
+#include "vefp_vertex_layout.hpp"
 
 #include <string>
 #include <vector>
@@ -20,6 +21,8 @@ namespace vefp {
 		VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
 		std::vector<VkDynamicState> dynamicStateEnables;
 		VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
@@ -39,9 +42,11 @@ namespace vefp {
 
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+		// vertex input state for models using the layout, the default config uses VefpVertexLayout{}
+		static void setVertexLayout(PipelineConfigInfo& configInfo, const VefpVertexLayout& layout);
+		static std::vector<char> readFile(const std::string& filepath);
 
 	 private:
-		static std::vector<char> readFile(const std::string& filepath);
 	
 		void createGraphicsPipeLine(
 			const std::string& vertFilepath,
@@ -55,4 +60,23 @@ namespace vefp {
 		VkShaderModule vertShaderModule;
 		VkShaderModule fragShaderModule;
 	};
+
+	class VefpComputePipeline {
+	 public:
+		VefpComputePipeline(
+			VefpDevice& device,
+			const std::string& compFilepath,
+			VkPipelineLayout pipelineLayout);
+		~VefpComputePipeline();
+
+		VefpComputePipeline(const VefpComputePipeline&) = delete;
+		VefpComputePipeline operator=(const VefpComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	 private:
+		VefpDevice& vefpDevice;
+		VkPipeline computePipeline;
+		VkShaderModule compShaderModule;
+	};
 }
\ No newline at end of file
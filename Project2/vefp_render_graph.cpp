@@ -0,0 +1,794 @@
+#include "vefp_render_graph.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+
+namespace vefp {
+
+	struct UsageInfo {
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage;
+		bool write;
+	};
+
+	static UsageInfo usageInfo(RenderGraphUsage usage) {
+		switch (usage) {
+		case RenderGraphUsage::ColorAttachment:
+			return {
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				true };
+		case RenderGraphUsage::DepthAttachment:
+			return {
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+				true };
+		case RenderGraphUsage::SampledFragment:
+			return {
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT,
+				false };
+		case RenderGraphUsage::SampledCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT,
+				false };
+		case RenderGraphUsage::StorageReadCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_USAGE_STORAGE_BIT,
+				false };
+		case RenderGraphUsage::StorageWriteCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_USAGE_STORAGE_BIT,
+				true };
+		case RenderGraphUsage::StorageReadVertex:
+			return {
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_USAGE_STORAGE_BIT,
+				false };
+		case RenderGraphUsage::IndirectRead:
+			return {
+				VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+				VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				0,
+				false };
+		case RenderGraphUsage::TransferSrc:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				false };
+		case RenderGraphUsage::TransferDst:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+				true };
+		}
+		throw std::runtime_error("unknown render graph usage!");
+	}
+
+	static VkImageAspectFlags aspectOf(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::read(ResourceId resource, RenderGraphUsage usage) {
+		assert(!usageInfo(usage).write && "Usage writes the resource");
+		graph.addUse(pass, resource, usage, true);
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::write(ResourceId resource, RenderGraphUsage usage) {
+		assert(usageInfo(usage).write && "Usage only reads the resource");
+		assert(usage != RenderGraphUsage::ColorAttachment && usage != RenderGraphUsage::DepthAttachment
+			&& "Attachments are declared with colorAttachment and depthAttachment");
+		// storage and transfer writes may leave parts of the resource as they were
+		graph.addUse(pass, resource, usage, true);
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::colorAttachment(ResourceId resource) {
+		graph.addUse(pass, resource, RenderGraphUsage::ColorAttachment, true);
+		graph.passes[pass].colorAttachments.push_back({ resource, false, {}, true });
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::colorAttachment(ResourceId resource, const VkClearColorValue& clear) {
+		graph.addUse(pass, resource, RenderGraphUsage::ColorAttachment, false);
+		VkClearValue clearValue{};
+		clearValue.color = clear;
+		graph.passes[pass].colorAttachments.push_back({ resource, true, clearValue, true });
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::depthAttachment(ResourceId resource) {
+		assert(graph.passes[pass].depthAttachment.empty() && "A pass can only have one depth attachment");
+		graph.addUse(pass, resource, RenderGraphUsage::DepthAttachment, true);
+		graph.passes[pass].depthAttachment.push_back({ resource, false, {}, true });
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::depthAttachment(ResourceId resource, const VkClearDepthStencilValue& clear) {
+		assert(graph.passes[pass].depthAttachment.empty() && "A pass can only have one depth attachment");
+		graph.addUse(pass, resource, RenderGraphUsage::DepthAttachment, false);
+		VkClearValue clearValue{};
+		clearValue.depthStencil = clear;
+		graph.passes[pass].depthAttachment.push_back({ resource, true, clearValue, true });
+		return *this;
+	}
+
+	VefpRenderGraph::PassBuilder& VefpRenderGraph::PassBuilder::sideEffects() {
+		graph.passes[pass].sideEffects = true;
+		return *this;
+	}
+
+	VefpRenderGraph::VefpRenderGraph(VefpDevice& device, uint32_t framesInFlight)
+		: vefpDevice{ device }, frames{ framesInFlight } {}
+
+	VefpRenderGraph::~VefpRenderGraph() {
+		for (auto& frame : frames) {
+			destroyFramebuffers(frame);
+			destroyTransientImages(frame);
+		}
+		for (auto& [key, renderPass] : renderPasses) {
+			vkDestroyRenderPass(vefpDevice.device(), renderPass, nullptr);
+		}
+	}
+
+	void VefpRenderGraph::beginFrame(int index, VefpFrameArena& frameArena) {
+		frameIndex = index;
+		arena = &frameArena;
+		// the slot's last frame has completed, nothing uses its framebuffers anymore
+		auto& frame = frames[frameIndex];
+		if (frame.framebuffersReleased) {
+			destroyFramebuffers(frame);
+			frame.framebuffersReleased = false;
+		}
+		frame.frameCount++;
+		auto unused = std::remove_if(frame.framebuffers.begin(), frame.framebuffers.end(), [&](const CachedFramebuffer& cached) {
+			if (frame.frameCount - cached.lastUsedFrame <= FRAMEBUFFER_UNUSED_FRAMES) {
+				return false;
+			}
+			vkDestroyFramebuffer(vefpDevice.device(), cached.framebuffer, nullptr);
+			return true;
+		});
+		frame.framebuffers.erase(unused, frame.framebuffers.end());
+
+		resources.clear();
+		passCount = 0;
+		compiled = false;
+	}
+
+	void VefpRenderGraph::releaseFramebuffers() {
+		for (auto& frame : frames) {
+			frame.framebuffersReleased = true;
+		}
+	}
+
+	VefpRenderGraph::ResourceId VefpRenderGraph::importImage(
+		VkImage image,
+		VkImageView view,
+		VkExtent2D extent,
+		VkFormat format,
+		VkImageLayout initialLayout,
+		VkImageLayout finalLayout,
+		VkPipelineStageFlags initialStages,
+		VkAccessFlags initialAccess) {
+		Resource resource{};
+		resource.isImage = true;
+		resource.imported = true;
+		resource.output = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		resource.desc.extent = extent;
+		resource.desc.format = format;
+		resource.aspect = aspectOf(format);
+		resource.image = image;
+		resource.view = view;
+		resource.initialLayout = initialLayout;
+		resource.finalLayout = finalLayout;
+		resource.initialStages = initialStages;
+		resource.initialAccess = initialAccess;
+		resources.push_back(resource);
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	VefpRenderGraph::ResourceId VefpRenderGraph::importBuffer(VkBuffer buffer, bool output) {
+		Resource resource{};
+		resource.imported = true;
+		resource.output = output;
+		resource.buffer = buffer;
+		resources.push_back(resource);
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	VefpRenderGraph::ResourceId VefpRenderGraph::createImage(const ImageDesc& desc) {
+		assert(desc.extent.width > 0 && desc.extent.height > 0 && "Transient images can not be empty");
+		Resource resource{};
+		resource.isImage = true;
+		resource.desc = desc;
+		resource.aspect = aspectOf(desc.format);
+		resources.push_back(resource);
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	VefpRenderGraph::PassBuilder VefpRenderGraph::addPass(void* function, ExecuteFunction execute) {
+		assert(!compiled && "Passes can not be added after compile");
+		// pass entries are reused so their vectors keep their capacity from frame to frame
+		if (passCount == passes.size()) {
+			passes.emplace_back();
+		}
+		Pass& pass = passes[passCount];
+		pass.function = function;
+		pass.execute = execute;
+		pass.uses.clear();
+		pass.colorAttachments.clear();
+		pass.depthAttachment.clear();
+		pass.sideEffects = false;
+		pass.culled = false;
+		return PassBuilder{ *this, passCount++ };
+	}
+
+	VkImage VefpRenderGraph::getImage(ResourceId resource) const {
+		assert(resource < resources.size() && resources[resource].isImage && "Resource is not an image");
+		return resources[resource].image;
+	}
+
+	VkImageView VefpRenderGraph::getImageView(ResourceId resource) const {
+		assert(resource < resources.size() && resources[resource].isImage && "Resource is not an image");
+		return resources[resource].view;
+	}
+
+	void VefpRenderGraph::addUse(uint32_t pass, ResourceId resource, RenderGraphUsage usage, bool readsPrevious) {
+		assert(resource < resources.size() && "Resource was not declared this frame");
+		passes[pass].uses.push_back({ resource, usage, readsPrevious });
+		if (resources[resource].isImage) {
+			resources[resource].desc.usage |= usageInfo(usage).imageUsage;
+		}
+	}
+
+	void VefpRenderGraph::compile() {
+		assert(!compiled && "Render graph was already compiled this frame");
+		stats = {};
+		stats.passes = passCount;
+
+		cullPasses();
+		computeLifetimes();
+		createTransientImages();
+		compiled = true;
+	}
+
+	void VefpRenderGraph::cullPasses() {
+		// Walks the passes backwards keeping track of which resources still have a later reader. A pass
+		// survives if it writes one of them or has side effects, its reads then make earlier writers
+		// needed. Fully overwriting a resource ends the need for what was written before.
+		needed.assign(resources.size(), false);
+		for (size_t resource = 0; resource < resources.size(); resource++) {
+			needed[resource] = resources[resource].output;
+		}
+
+		for (uint32_t p = passCount; p-- > 0;) {
+			Pass& pass = passes[p];
+			bool alive = pass.sideEffects;
+			for (const Use& use : pass.uses) {
+				alive = alive || (usageInfo(use.usage).write && needed[use.resource]);
+			}
+			pass.culled = !alive;
+			if (!alive) {
+				stats.culledPasses++;
+				continue;
+			}
+
+			for (auto* attachments : { &pass.colorAttachments, &pass.depthAttachment }) {
+				for (Attachment& attachment : *attachments) {
+					attachment.store = needed[attachment.resource];
+				}
+			}
+			for (const Use& use : pass.uses) {
+				if (usageInfo(use.usage).write && !use.readsPrevious) {
+					needed[use.resource] = false;
+				}
+			}
+			for (const Use& use : pass.uses) {
+				if (use.readsPrevious) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+
+	void VefpRenderGraph::computeLifetimes() {
+		for (Resource& resource : resources) {
+			resource.firstPass = UINT32_MAX;
+			resource.lastPass = 0;
+		}
+		for (uint32_t p = 0; p < passCount; p++) {
+			if (passes[p].culled) {
+				continue;
+			}
+			for (const Use& use : passes[p].uses) {
+				Resource& resource = resources[use.resource];
+				resource.firstPass = std::min(resource.firstPass, p);
+				resource.lastPass = std::max(resource.lastPass, p);
+			}
+		}
+	}
+
+	void VefpRenderGraph::createTransientImages() {
+		auto& frame = frames[frameIndex];
+		transientKeys.clear();
+		transientResources.clear();
+		for (ResourceId id = 0; id < resources.size(); id++) {
+			const Resource& resource = resources[id];
+			// images only culled passes use are never created
+			if (resource.isImage && !resource.imported && resource.firstPass != UINT32_MAX) {
+				transientKeys.push_back({ resource.desc, resource.firstPass, resource.lastPass });
+				transientResources.push_back(id);
+			}
+		}
+
+		// the slot is idle while its frame is recorded, so its images can be replaced right away
+		if (transientKeys != frame.transientKeys) {
+			destroyFramebuffers(frame);
+			destroyTransientImages(frame);
+			const size_t count = transientKeys.size();
+			std::vector<VkMemoryRequirements> requirements(count);
+			for (size_t i = 0; i < count; i++) {
+				const TransientKey& key = transientKeys[i];
+				VkImageCreateInfo imageInfo{};
+				imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+				imageInfo.imageType = VK_IMAGE_TYPE_2D;
+				imageInfo.extent = { key.desc.extent.width, key.desc.extent.height, 1 };
+				imageInfo.mipLevels = 1;
+				imageInfo.arrayLayers = 1;
+				imageInfo.format = key.desc.format;
+				imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+				imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				imageInfo.usage = key.desc.usage;
+				imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+				imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				VkImage image;
+				if (vkCreateImage(vefpDevice.device(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create transient image!");
+				}
+				frame.images.push_back(image);
+				vkGetImageMemoryRequirements(vefpDevice.device(), image, &requirements[i]);
+			}
+
+			// Greedy aliasing in order of first use: an image goes into the first block whose images
+			// are all done before it starts and whose memory types it can live in.
+			struct Block {
+				VkDeviceSize size;
+				uint32_t memoryTypeBits;
+				uint32_t lastPass;
+			};
+			std::vector<Block> blocks;
+			std::vector<uint32_t> order(count);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				return transientKeys[a].firstPass < transientKeys[b].firstPass;
+			});
+			frame.imageBlocks.assign(count, 0);
+			for (uint32_t i : order) {
+				const TransientKey& key = transientKeys[i];
+				auto block = std::find_if(blocks.begin(), blocks.end(), [&](const Block& block) {
+					return block.lastPass < key.firstPass && (block.memoryTypeBits & requirements[i].memoryTypeBits) != 0;
+				});
+				if (block == blocks.end()) {
+					blocks.push_back({ requirements[i].size, requirements[i].memoryTypeBits, key.lastPass });
+					block = blocks.end() - 1;
+				}
+				else {
+					block->size = std::max(block->size, requirements[i].size);
+					block->memoryTypeBits &= requirements[i].memoryTypeBits;
+					block->lastPass = key.lastPass;
+				}
+				frame.imageBlocks[i] = static_cast<uint32_t>(block - blocks.begin());
+			}
+
+			for (const Block& block : blocks) {
+				VkMemoryAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				allocInfo.allocationSize = block.size;
+				allocInfo.memoryTypeIndex = vefpDevice.findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				VkDeviceMemory memory;
+				if (vkAllocateMemory(vefpDevice.device(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+					throw std::runtime_error("failed to allocate transient image memory!");
+				}
+				frame.memoryBlocks.push_back(memory);
+			}
+
+			// every image starts at the beginning of its block, which satisfies any alignment
+			for (size_t i = 0; i < count; i++) {
+				if (vkBindImageMemory(vefpDevice.device(), frame.images[i], frame.memoryBlocks[frame.imageBlocks[i]], 0) != VK_SUCCESS) {
+					throw std::runtime_error("failed to bind transient image memory!");
+				}
+
+				VkImageViewCreateInfo viewInfo{};
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewInfo.image = frame.images[i];
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = transientKeys[i].desc.format;
+				viewInfo.subresourceRange.aspectMask = aspectOf(transientKeys[i].desc.format);
+				viewInfo.subresourceRange.baseMipLevel = 0;
+				viewInfo.subresourceRange.levelCount = 1;
+				viewInfo.subresourceRange.baseArrayLayer = 0;
+				viewInfo.subresourceRange.layerCount = 1;
+				VkImageView view;
+				if (vkCreateImageView(vefpDevice.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create transient image view!");
+				}
+				frame.imageViews.push_back(view);
+			}
+			frame.transientKeys = transientKeys;
+		}
+
+		for (uint32_t i = 0; i < transientResources.size(); i++) {
+			Resource& resource = resources[transientResources[i]];
+			resource.image = frame.images[i];
+			resource.view = frame.imageViews[i];
+			resource.transient = i;
+		}
+		stats.transientImages = static_cast<uint32_t>(transientResources.size());
+		stats.memoryBlocks = static_cast<uint32_t>(frame.memoryBlocks.size());
+	}
+
+	void VefpRenderGraph::destroyTransientImages(FrameResources& frame) {
+		for (VkImageView view : frame.imageViews) {
+			vkDestroyImageView(vefpDevice.device(), view, nullptr);
+		}
+		for (VkImage image : frame.images) {
+			vkDestroyImage(vefpDevice.device(), image, nullptr);
+		}
+		for (VkDeviceMemory memory : frame.memoryBlocks) {
+			vkFreeMemory(vefpDevice.device(), memory, nullptr);
+		}
+		frame.imageViews.clear();
+		frame.images.clear();
+		frame.memoryBlocks.clear();
+		frame.imageBlocks.clear();
+		frame.transientKeys.clear();
+	}
+
+	void VefpRenderGraph::destroyFramebuffers(FrameResources& frame) {
+		for (const CachedFramebuffer& cached : frame.framebuffers) {
+			vkDestroyFramebuffer(vefpDevice.device(), cached.framebuffer, nullptr);
+		}
+		frame.framebuffers.clear();
+	}
+
+	void VefpRenderGraph::execute(VkCommandBuffer commandBuffer) {
+		assert(compiled && "Render graph has to be compiled before it is executed");
+		auto& frame = frames[frameIndex];
+		for (Resource& resource : resources) {
+			resource.layout = resource.imported ? resource.initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+			// work outside the graph counts as a write the first use waits for
+			resource.writeStages = resource.initialStages;
+			resource.writeAccess = resource.initialAccess;
+			resource.readStages = 0;
+			resource.visibleStages = 0;
+			resource.visibleAccess = 0;
+		}
+		blockOccupants.assign(frame.memoryBlocks.size(), UINT32_MAX);
+
+		for (uint32_t p = 0; p < passCount; p++) {
+			const Pass& pass = passes[p];
+			if (pass.culled) {
+				continue;
+			}
+
+			recordBarriers(commandBuffer, pass);
+			const bool renderPass = !pass.colorAttachments.empty() || !pass.depthAttachment.empty();
+			if (renderPass) {
+				beginRenderPass(commandBuffer, pass, p);
+			}
+			pass.execute(pass.function, commandBuffer);
+			if (renderPass) {
+				vkCmdEndRenderPass(commandBuffer);
+			}
+		}
+
+		// outputs end up in the layout the caller asked for
+		imageBarriers.clear();
+		VkPipelineStageFlags srcStages = 0;
+		for (Resource& resource : resources) {
+			if (!resource.isImage || !resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED
+				|| resource.finalLayout == resource.layout) {
+				continue;
+			}
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = resource.writeAccess;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = resource.layout;
+			barrier.newLayout = resource.finalLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange = { resource.aspect, 0, 1, 0, 1 };
+			imageBarriers.push_back(barrier);
+			srcStages |= resource.writeStages | resource.readStages;
+			resource.layout = resource.finalLayout;
+		}
+		if (!imageBarriers.empty()) {
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+			stats.barriers += static_cast<uint32_t>(imageBarriers.size());
+		}
+	}
+
+	void VefpRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const Pass& pass) {
+		imageBarriers.clear();
+		bufferBarriers.clear();
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		const auto& frame = frames[frameIndex];
+
+		for (const Use& use : pass.uses) {
+			Resource& resource = resources[use.resource];
+			const UsageInfo info = usageInfo(use.usage);
+			const bool layoutChange = resource.isImage && resource.layout != info.layout;
+
+			VkPipelineStageFlags waitStages = 0;
+			VkAccessFlags waitAccess = 0;
+			bool barrier = layoutChange;
+			if (info.write || layoutChange) {
+				// writes and layout transitions wait for every earlier access
+				waitStages = resource.writeStages | resource.readStages;
+				waitAccess = resource.writeAccess;
+				barrier = barrier || waitStages != 0;
+			}
+			else if (resource.writeStages != 0
+				&& ((info.stages & ~resource.visibleStages) != 0 || (info.access & ~resource.visibleAccess) != 0)) {
+				// reads wait for the last write unless an earlier barrier already made it visible to them
+				waitStages = resource.writeStages;
+				waitAccess = resource.writeAccess;
+				barrier = true;
+			}
+
+			// the first image placed in aliased memory waits for the image that used it before
+			if (!resource.imported && resource.isImage && resource.writeStages == 0 && resource.readStages == 0) {
+				uint32_t& occupant = blockOccupants[frame.imageBlocks[resource.transient]];
+				if (occupant != UINT32_MAX && occupant != use.resource) {
+					const Resource& previous = resources[occupant];
+					waitStages |= previous.writeStages | previous.readStages;
+					waitAccess |= previous.writeAccess;
+				}
+				occupant = use.resource;
+			}
+
+			if (barrier) {
+				srcStages |= waitStages;
+				dstStages |= info.stages;
+				if (resource.isImage) {
+					VkImageMemoryBarrier imageBarrier{};
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					imageBarrier.srcAccessMask = waitAccess;
+					imageBarrier.dstAccessMask = info.access;
+					imageBarrier.oldLayout = resource.layout;
+					imageBarrier.newLayout = info.layout;
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.image = resource.image;
+					imageBarrier.subresourceRange = { resource.aspect, 0, 1, 0, 1 };
+					imageBarriers.push_back(imageBarrier);
+				}
+				else {
+					VkBufferMemoryBarrier bufferBarrier{};
+					bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					bufferBarrier.srcAccessMask = waitAccess;
+					bufferBarrier.dstAccessMask = info.access;
+					bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.buffer = resource.buffer;
+					bufferBarrier.offset = 0;
+					bufferBarrier.size = VK_WHOLE_SIZE;
+					bufferBarriers.push_back(bufferBarrier);
+				}
+			}
+
+			if (resource.isImage) {
+				resource.layout = info.layout;
+			}
+			if (info.write || layoutChange) {
+				// a layout transition counts as a write later reads have to wait for
+				resource.writeStages = info.stages;
+				resource.writeAccess = info.write ? info.access : 0;
+				resource.readStages = info.write ? 0 : info.stages;
+				resource.visibleStages = info.write ? 0 : info.stages;
+				resource.visibleAccess = info.write ? 0 : info.access;
+			}
+			else {
+				resource.readStages |= info.stages;
+				if (barrier) {
+					resource.visibleStages |= info.stages;
+					resource.visibleAccess |= info.access;
+				}
+			}
+		}
+
+		if (imageBarriers.empty() && bufferBarriers.empty()) {
+			return;
+		}
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			dstStages,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		stats.barriers += static_cast<uint32_t>(imageBarriers.size() + bufferBarriers.size());
+	}
+
+	void VefpRenderGraph::beginRenderPass(VkCommandBuffer commandBuffer, const Pass& pass, uint32_t passIndex) {
+		RenderPassKey& key = renderPassKey;
+		key.formats.clear();
+		key.loadOps.clear();
+		key.storeOps.clear();
+		attachmentViews.clear();
+		clearValues.clear();
+		VkExtent2D extent{};
+		for (auto* attachments : { &pass.colorAttachments, &pass.depthAttachment }) {
+			for (const Attachment& attachment : *attachments) {
+				const Resource& resource = resources[attachment.resource];
+				// a transient image has nothing worth loading the first time it is used
+				const bool undefined = !resource.imported && resource.firstPass == passIndex;
+				key.formats.push_back(resource.desc.format);
+				key.loadOps.push_back(attachment.clear
+					? VK_ATTACHMENT_LOAD_OP_CLEAR
+					: undefined ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD);
+				key.storeOps.push_back(attachment.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+				attachmentViews.push_back(resource.view);
+				clearValues.push_back(attachment.clearValue);
+				assert((extent.width == 0 || (extent.width == resource.desc.extent.width && extent.height == resource.desc.extent.height))
+					&& "Attachments of a pass must have the same extent");
+				extent = resource.desc.extent;
+			}
+		}
+		key.hasDepth = !pass.depthAttachment.empty();
+		VkRenderPass renderPass = getRenderPass(key);
+		VkFramebuffer framebuffer = getFramebuffer(renderPass, extent);
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		// pipelines use a dynamic viewport, it covers the attachments unless the pass sets its own
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(extent.width);
+		viewport.height = static_cast<float>(extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0, 0}, extent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+
+	VkFramebuffer VefpRenderGraph::getFramebuffer(VkRenderPass renderPass, VkExtent2D extent) {
+		auto& frame = frames[frameIndex];
+		for (CachedFramebuffer& cached : frame.framebuffers) {
+			if (cached.renderPass == renderPass && cached.views == attachmentViews &&
+				cached.extent.width == extent.width && cached.extent.height == extent.height) {
+				cached.lastUsedFrame = frame.frameCount;
+				return cached.framebuffer;
+			}
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachmentViews.size());
+		framebufferInfo.pAttachments = attachmentViews.data();
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+		VkFramebuffer framebuffer;
+		if (vkCreateFramebuffer(vefpDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph framebuffer!");
+		}
+		frame.framebuffers.push_back({ renderPass, attachmentViews, extent, framebuffer, frame.frameCount });
+		return framebuffer;
+	}
+
+	VkRenderPass VefpRenderGraph::getRenderPass(const RenderPassKey& key) {
+		for (auto& [passKey, renderPass] : renderPasses) {
+			if (passKey == key) {
+				return renderPass;
+			}
+		}
+
+		// layouts stay put inside the pass, the barriers before it do the transitions
+		const size_t colorCount = key.formats.size() - (key.hasDepth ? 1 : 0);
+		std::vector<VkAttachmentDescription> attachments(key.formats.size());
+		std::vector<VkAttachmentReference> colorReferences(colorCount);
+		VkAttachmentReference depthReference{};
+		for (uint32_t i = 0; i < attachments.size(); i++) {
+			const bool depth = i == colorCount;
+			const VkImageLayout layout = depth
+				? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+				: VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[i].format = key.formats[i];
+			attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[i].loadOp = key.loadOps[i];
+			attachments[i].storeOp = key.storeOps[i];
+			attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[i].initialLayout = layout;
+			attachments[i].finalLayout = layout;
+			if (depth) {
+				depthReference = { i, layout };
+			}
+			else {
+				colorReferences[i] = { i, layout };
+			}
+		}
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pDepthStencilAttachment = key.hasDepth ? &depthReference : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		VkRenderPass renderPass;
+		if (vkCreateRenderPass(vefpDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph render pass!");
+		}
+		renderPasses.emplace_back(key, renderPass);
+		return renderPass;
+	}
+
+}
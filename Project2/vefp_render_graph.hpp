@@ -0,0 +1,275 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_frame_ring.hpp"
+#include "vefp_frame_arena.hpp"
+
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vefp {
+
+	// How a pass touches a resource, which decides the stages, access and image layout the graph
+	// synchronizes for.
+	enum class RenderGraphUsage {
+		ColorAttachment,
+		DepthAttachment,
+		SampledFragment,
+		SampledCompute,
+		StorageReadCompute,
+		StorageWriteCompute,
+		StorageReadVertex,
+		IndirectRead,
+		TransferSrc,
+		TransferDst,
+	};
+
+	// Frame graph, declared anew every frame. Passes say which resources they read and write, the
+	// graph then
+	//   culls passes whose results nothing reads, unless they have side effects,
+	//   records the barriers and layout transitions between the remaining passes,
+	//   begins a render pass for passes with attachments,
+	//   and creates the transient images, letting images whose lifetimes do not overlap share memory.
+	// Transient images and their memory are kept per frame slot and only recreated when the frame's
+	// transient images change. Imported resources are owned by the caller; work outside the graph
+	// that used them is synchronized by the caller, or for images named when importing them.
+	// Pass functions are copied into the frame arena given to beginFrame, so declaring a frame stays
+	// off the heap once the pass and resource lists have grown to the frame's size. Framebuffers are
+	// kept per frame slot as well, callers release them when imported attachments are recreated.
+	class VefpRenderGraph {
+	public:
+		using ResourceId = uint32_t;
+
+		struct ImageDesc {
+			VkExtent2D extent{};
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			// on top of what the declared usages need
+			VkImageUsageFlags usage = 0;
+		};
+
+		// of the last compiled frame
+		struct Stats {
+			uint32_t passes = 0;
+			uint32_t culledPasses = 0;
+			uint32_t barriers = 0;
+			uint32_t transientImages = 0;
+			uint32_t memoryBlocks = 0;
+		};
+
+		class PassBuilder {
+		public:
+			PassBuilder& read(ResourceId resource, RenderGraphUsage usage);
+			PassBuilder& write(ResourceId resource, RenderGraphUsage usage);
+			// attachments without a clear value keep their contents
+			PassBuilder& colorAttachment(ResourceId resource);
+			PassBuilder& colorAttachment(ResourceId resource, const VkClearColorValue& clear);
+			PassBuilder& depthAttachment(ResourceId resource);
+			PassBuilder& depthAttachment(ResourceId resource, const VkClearDepthStencilValue& clear);
+			// never culled, for passes that present or write outside the graph
+			PassBuilder& sideEffects();
+
+		private:
+			friend class VefpRenderGraph;
+			PassBuilder(VefpRenderGraph& graph, uint32_t pass) : graph{ graph }, pass{ pass } {}
+
+			VefpRenderGraph& graph;
+			uint32_t pass;
+		};
+
+		VefpRenderGraph(VefpDevice& device, uint32_t framesInFlight);
+		~VefpRenderGraph();
+
+		VefpRenderGraph(const VefpRenderGraph&) = delete;
+		VefpRenderGraph& operator=(const VefpRenderGraph&) = delete;
+
+		// forgets the passes and resources of the slot's last frame, pass functions of the new frame
+		// are kept in arena until it is rewound
+		void beginFrame(int frameIndex, VefpFrameArena& arena);
+		// For when imported attachment views are replaced, e.g. with the swap chain. Each slot drops
+		// its framebuffers when its next frame begins, so the old views have to live until then.
+		void releaseFramebuffers();
+
+		// The image is transitioned to finalLayout after the last pass, UNDEFINED leaves it where the
+		// last pass put it and makes it no output. The first pass using it waits for initialStages and
+		// initialAccess of earlier work, e.g. the stage a swap chain image's acquire is waited at.
+		// Attachments are rendered at extent, which may be smaller than the image.
+		ResourceId importImage(
+			VkImage image,
+			VkImageView view,
+			VkExtent2D extent,
+			VkFormat format,
+			VkImageLayout initialLayout,
+			VkImageLayout finalLayout,
+			VkPipelineStageFlags initialStages = 0,
+			VkAccessFlags initialAccess = 0);
+		// passes writing an output buffer are never culled
+		ResourceId importBuffer(VkBuffer buffer, bool output);
+		ResourceId createImage(const ImageDesc& desc);
+
+		// Passes run in the order they are added. execute is called with the frame's command buffer
+		// and never destroyed, so it may only capture trivially destructible values, e.g. references.
+		template<typename F>
+		PassBuilder addPass(F&& execute) {
+			using Function = std::decay_t<F>;
+			static_assert(std::is_trivially_destructible_v<Function>, "Pass functions are never destroyed");
+			assert(arena && "Passes can only be added after beginFrame");
+			void* function = new (arena->allocate(sizeof(Function), alignof(Function))) Function(std::forward<F>(execute));
+			return addPass(function, [](void* function, VkCommandBuffer commandBuffer) {
+				(*static_cast<Function*>(function))(commandBuffer);
+			});
+		}
+
+		void compile();
+		void execute(VkCommandBuffer commandBuffer);
+
+		// transient images only exist after compile
+		VkImage getImage(ResourceId resource) const;
+		VkImageView getImageView(ResourceId resource) const;
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct Resource {
+			bool isImage;
+			bool imported;
+			bool output;
+			ImageDesc desc;
+			VkImageAspectFlags aspect;
+			VkImage image;
+			VkImageView view;
+			VkBuffer buffer;
+			VkImageLayout initialLayout;
+			VkImageLayout finalLayout;
+			VkPipelineStageFlags initialStages;
+			VkAccessFlags initialAccess;
+
+			// set by compile
+			uint32_t firstPass;
+			uint32_t lastPass;
+			uint32_t transient;  // index into the frame's transient images
+
+			// tracked by execute
+			VkImageLayout layout;
+			VkPipelineStageFlags writeStages;
+			VkAccessFlags writeAccess;
+			// stages that read since the last write, and what the last write has been made visible to
+			VkPipelineStageFlags readStages;
+			VkPipelineStageFlags visibleStages;
+			VkAccessFlags visibleAccess;
+		};
+
+		struct Use {
+			ResourceId resource;
+			RenderGraphUsage usage;
+			// false only when the pass overwrites all of the resource, earlier writers are then dead
+			bool readsPrevious;
+		};
+
+		struct Attachment {
+			ResourceId resource;
+			bool clear;
+			VkClearValue clearValue;
+			// set by compile, nothing reads the contents after the pass when false
+			bool store;
+		};
+
+		using ExecuteFunction = void (*)(void* function, VkCommandBuffer commandBuffer);
+
+		struct Pass {
+			void* function;
+			ExecuteFunction execute;
+			std::vector<Use> uses;
+			std::vector<Attachment> colorAttachments;
+			std::vector<Attachment> depthAttachment;  // empty or one
+			bool sideEffects = false;
+			bool culled = false;
+		};
+
+		// transient images of a frame slot, reused while the frame declares the same ones
+		struct TransientKey {
+			ImageDesc desc;
+			uint32_t firstPass;
+			uint32_t lastPass;
+
+			bool operator==(const TransientKey& other) const {
+				return desc.extent.width == other.desc.extent.width
+					&& desc.extent.height == other.desc.extent.height
+					&& desc.format == other.desc.format
+					&& desc.usage == other.desc.usage
+					&& firstPass == other.firstPass
+					&& lastPass == other.lastPass;
+			}
+		};
+
+		struct CachedFramebuffer {
+			VkRenderPass renderPass;
+			std::vector<VkImageView> views;
+			VkExtent2D extent;
+			VkFramebuffer framebuffer;
+			uint64_t lastUsedFrame;
+		};
+
+		struct FrameResources {
+			std::vector<TransientKey> transientKeys;
+			std::vector<VkImage> images;
+			std::vector<VkImageView> imageViews;
+			std::vector<VkDeviceMemory> memoryBlocks;
+			std::vector<uint32_t> imageBlocks;  // memory block of each image
+			// dropped once unused for FRAMEBUFFER_UNUSED_FRAMES, e.g. after dynamic resolution moved on
+			std::vector<CachedFramebuffer> framebuffers;
+			bool framebuffersReleased = false;
+			uint64_t frameCount = 0;
+		};
+
+		struct RenderPassKey {
+			std::vector<VkFormat> formats;  // color formats, then the depth format if there is one
+			std::vector<VkAttachmentLoadOp> loadOps;
+			std::vector<VkAttachmentStoreOp> storeOps;
+			bool hasDepth;
+
+			bool operator==(const RenderPassKey&) const = default;
+		};
+
+		static constexpr uint64_t FRAMEBUFFER_UNUSED_FRAMES = 16;
+
+		PassBuilder addPass(void* function, ExecuteFunction execute);
+		void addUse(uint32_t pass, ResourceId resource, RenderGraphUsage usage, bool readsPrevious);
+		void cullPasses();
+		void computeLifetimes();
+		void createTransientImages();
+		void destroyTransientImages(FrameResources& frame);
+		void destroyFramebuffers(FrameResources& frame);
+		void recordBarriers(VkCommandBuffer commandBuffer, const Pass& pass);
+		void beginRenderPass(VkCommandBuffer commandBuffer, const Pass& pass, uint32_t passIndex);
+		VkRenderPass getRenderPass(const RenderPassKey& key);
+		// of the current slot for attachmentViews
+		VkFramebuffer getFramebuffer(VkRenderPass renderPass, VkExtent2D extent);
+
+		VefpDevice& vefpDevice;
+		VefpFrameRing<FrameResources> frames;
+		int frameIndex = 0;
+		VefpFrameArena* arena = nullptr;
+		bool compiled = false;
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		uint32_t passCount = 0;
+		std::vector<std::pair<RenderPassKey, VkRenderPass>> renderPasses;
+		Stats stats{};
+
+		// scratch storage reused across frames
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		std::vector<bool> needed;
+		std::vector<TransientKey> transientKeys;
+		std::vector<ResourceId> transientResources;
+		RenderPassKey renderPassKey{};
+		std::vector<VkImageView> attachmentViews;
+		std::vector<VkClearValue> clearValues;
+		// last resource that used each memory block while executing
+		std::vector<ResourceId> blockOccupants;
+	};
+
+}
@@ -0,0 +1,78 @@
+#include "vefp_render_queue.hpp"
+
+#include <array>
+#include <bit>
+#include <cassert>
+
+namespace vefp {
+
+	uint64_t VefpRenderQueue::makeKey(uint32_t layer, uint32_t pipeline, uint32_t model, float depth) {
+		assert(layer < MAX_LAYERS && "Render layer out of range");
+		assert(pipeline < MAX_PIPELINES && "Too many pipelines for the render queue");
+		assert(model < MAX_MODELS && "Too many models for the render queue");
+		assert(depth >= 0.f && "Render queue depth must be positive");
+		// the bits of positive floats sort like the floats themselves
+		return static_cast<uint64_t>(layer) << 56
+			| static_cast<uint64_t>(pipeline) << 48
+			| static_cast<uint64_t>(model) << 32
+			| std::bit_cast<uint32_t>(depth + 0.f);
+	}
+
+	void VefpRenderQueue::clear() {
+		keys.clear();
+		items.clear();
+	}
+
+	void VefpRenderQueue::reserve(size_t count) {
+		keys.reserve(count);
+		items.reserve(count);
+		sortedKeys.reserve(count);
+		sortedItems.reserve(count);
+	}
+
+	void VefpRenderQueue::push(uint64_t key, uint32_t item) {
+		keys.push_back(key);
+		items.push_back(item);
+	}
+
+	void VefpRenderQueue::sort() {
+		const size_t count = keys.size();
+		if (count < 2) {
+			return;
+		}
+
+		// one pass builds the histograms of all eight bytes
+		std::array<std::array<uint32_t, 256>, 8> histograms{};
+		for (uint64_t key : keys) {
+			for (uint32_t byte = 0; byte < 8; byte++) {
+				histograms[byte][(key >> (8 * byte)) & 0xff]++;
+			}
+		}
+
+		sortedKeys.resize(count);
+		sortedItems.resize(count);
+		for (uint32_t byte = 0; byte < 8; byte++) {
+			auto& histogram = histograms[byte];
+			const uint32_t shift = 8 * byte;
+			// nothing to reorder when every key has the same value in this byte
+			if (histogram[(keys[0] >> shift) & 0xff] == count) {
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t& bucket : histogram) {
+				const uint32_t bucketSize = bucket;
+				bucket = offset;
+				offset += bucketSize;
+			}
+			for (size_t i = 0; i < count; i++) {
+				const uint32_t target = histogram[(keys[i] >> shift) & 0xff]++;
+				sortedKeys[target] = keys[i];
+				sortedItems[target] = items[i];
+			}
+			keys.swap(sortedKeys);
+			items.swap(sortedItems);
+		}
+	}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace vefp {
+
+	// Draws recorded as 64 bit sort keys plus the caller's item index. Sorting orders them by
+	//   layer (8 bits) | pipeline (8 bits) | model (16 bits) | depth (32 bits)
+	// so draws sharing a pipeline and then a model end up next to each other and the state only has
+	// to be bound when it changes. The sort is stable, equal keys keep their submission order.
+	// Keys and items are allocated from storage, pass a frame arena for queues filled every frame.
+	class VefpRenderQueue {
+	public:
+		explicit VefpRenderQueue(std::pmr::memory_resource* storage = std::pmr::get_default_resource())
+			: keys{ storage }, items{ storage }, sortedKeys{ storage }, sortedItems{ storage } {}
+
+		static constexpr uint32_t MAX_LAYERS = 1 << 8;
+		static constexpr uint32_t MAX_PIPELINES = 1 << 8;
+		static constexpr uint32_t MAX_MODELS = 1 << 16;
+
+		// depth has to be positive, smaller depths sort first
+		static uint64_t makeKey(uint32_t layer, uint32_t pipeline, uint32_t model, float depth);
+		static uint32_t keyPipeline(uint64_t key) { return static_cast<uint32_t>(key >> 48) & 0xff; }
+		static uint32_t keyModel(uint64_t key) { return static_cast<uint32_t>(key >> 32) & 0xffff; }
+
+		void clear();
+		// makes room for count draws so pushing them and sorting does not reallocate
+		void reserve(size_t count);
+		void push(uint64_t key, uint32_t item);
+		// LSD radix sort over the key bytes, bytes every key shares are skipped
+		void sort();
+
+		size_t size() const { return keys.size(); }
+		bool empty() const { return keys.empty(); }
+		uint64_t key(size_t i) const { return keys[i]; }
+		uint32_t item(size_t i) const { return items[i]; }
+
+	private:
+		std::pmr::vector<uint64_t> keys;
+		std::pmr::vector<uint32_t> items;
+
+		// scratch storage reused across sorts
+		std::pmr::vector<uint64_t> sortedKeys;
+		std::pmr::vector<uint32_t> sortedItems;
+	};
+
+}
@@ -7,42 +7,160 @@
 namespace vefp {
 
 
-	VefpRenderer::VefpRenderer(VefpWindow& window, VefpDevice& device) : vefpWindow{ window }, vefpDevice{ device } {
+	VefpRenderer::VefpRenderer(
+		VefpWindow& window,
+		VefpDevice& device,
+		uint32_t framesInFlight,
+		VkPresentModeKHR presentMode)
+		: vefpWindow{ window },
+		vefpDevice{ device },
+		framesInFlight{ framesInFlight },
+		preferredPresentMode{ presentMode },
+		transientBuffers{
+			framesInFlight,
+			device,
+			TRANSIENT_BUFFER_SIZE,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+		frameAllocator{ framesInFlight } {
+		assert(framesInFlight > 0 && "Need at least one frame in flight");
 		recreateSwapChain();
 		createCommandBuffers();
+		createTimestampQueries();
 	}
 
 	VefpRenderer::~VefpRenderer() {
+		if (timestampPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(vefpDevice.device(), timestampPool, nullptr);
+		}
 		freeCommandBuffers();
 	}
 
 	void VefpRenderer::recreateSwapChain() {
 		auto extent = vefpWindow.getExtend();
-		while (extent.width == 0 || extent.height == 0) {
-			extent = vefpWindow.getExtend();
-			glfwWaitEvents();
+		if (vefpSwapChain == nullptr) {
+			// the first swap chain is needed to create pipelines, so this one has to wait for a size
+			while (extent.width == 0 || extent.height == 0) {
+				extent = vefpWindow.getExtend();
+				glfwWaitEvents();
+			}
+			vefpSwapChain = std::make_unique<VefpSwapChain>(vefpDevice, extent, framesInFlight, preferredPresentMode);
+			return;
 		}
 
-		vkDeviceWaitIdle(vefpDevice.device());
+		// a minimized window has nothing to present to, try again on a later frame
+		swapChainOutdated = extent.width == 0 || extent.height == 0;
+		if (swapChainOutdated) {
+			return;
+		}
 
-		if (vefpSwapChain == nullptr) {
-			vefpSwapChain = std::make_unique<VefpSwapChain>(vefpDevice, extent);
+		// frames still in flight keep rendering into the old swap chain while the new one is created
+		auto newSwapChain = std::make_unique<VefpSwapChain>(vefpDevice, extent, *vefpSwapChain, preferredPresentMode);
+		if (!vefpSwapChain->compareSwapFormats(*newSwapChain)) {
+			throw std::runtime_error("Swap chain image(or depth) format has changed!");
 		}
-		else {
-			std::shared_ptr<VefpSwapChain> oldSwapChain = std::move(vefpSwapChain);
-			vefpSwapChain = std::make_unique<VefpSwapChain>(vefpDevice, extent, std::move(vefpSwapChain));
-			
-			if (!oldSwapChain->compareSwapFormats(*vefpSwapChain.get())) {
-				throw std::runtime_error("Swap chain image(or depth) format has changed!");
-			}
+		retireSwapChain(std::move(vefpSwapChain));
+		vefpSwapChain = std::move(newSwapChain);
+		sceneImagesChanged = true;
+		if (resolutionScaler) {
+			createSceneTarget();
+		}
+
+		presentModeChanged = false;
+	}
+
+	void VefpRenderer::retireSwapChain(std::unique_ptr<VefpSwapChain> swapChain) {
+		// Submitted frames may still render into its framebuffers and depth images. Presentation has no
+		// fence of its own, so the swap chain is also kept for another framesInFlight frames, by which
+		// time every present queued on it has been processed.
+		uint64_t retireValue = getFrameTimeline().lastSubmittedValue() + framesInFlight;
+		retiredSwapChains.push_back({ std::move(swapChain), std::move(sceneTarget), retireValue });
+	}
+
+	void VefpRenderer::destroyRetiredSwapChains() {
+		auto& timeline = getFrameTimeline();
+		while (!retiredSwapChains.empty() && timeline.isComplete(retiredSwapChains.front().retireValue)) {
+			retiredSwapChains.pop_front();
+		}
+	}
+
+	void VefpRenderer::createSceneTarget() {
+		sceneTarget = std::make_unique<VefpSceneTarget>(
+			vefpDevice,
+			vefpSwapChain->getSwapChainExtent(),
+			vefpSwapChain->getSwapChainImageFormat(),
+			vefpSwapChain->getDepthFormat(),
+			framesInFlight);
+		sceneExtent = resolutionScaler->scaledExtent(sceneTarget->getMaxExtent());
+		sceneImagesChanged = true;
+	}
+
+	bool VefpRenderer::enableDynamicResolution(const VefpResolutionScaler::Settings& settings) {
+		if (timestampPool == VK_NULL_HANDLE ||
+			!vefpSwapChain->supportsTransferDst() ||
+			!VefpSceneTarget::isSupported(vefpDevice, vefpSwapChain->getSwapChainImageFormat())) {
+			return false;
+		}
+		// a frame's timestamps are read when its slot comes around again
+		resolutionScaler = std::make_unique<VefpResolutionScaler>(settings, framesInFlight);
+		createSceneTarget();
+		return true;
+	}
+
+	void VefpRenderer::createTimestampQueries() {
+		timestampBits = vefpDevice.timestampValidBits(vefpDevice.graphicsQueueFamily());
+		if (!vefpDevice.properties.limits.timestampComputeAndGraphics || timestampBits == 0) {
+			return;
+		}
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2 * framesInFlight;
+		if (vkCreateQueryPool(vefpDevice.device(), &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+		timestampsWritten.resize(framesInFlight, false);
+	}
+
+	void VefpRenderer::readFrameTimestamps() {
+		if (timestampPool == VK_NULL_HANDLE || !timestampsWritten[currentFrameIndex]) {
+			return;
+		}
+
+		std::array<uint64_t, 2> timestamps{};
+		VkResult result = vkGetQueryPoolResults(
+			vefpDevice.device(),
+			timestampPool,
+			2 * currentFrameIndex,
+			2,
+			sizeof(timestamps),
+			timestamps.data(),
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) {
+			return;
 		}
-		
 
-		// we'll come back to this in just a moment
+		// only the low timestampBits are valid, the difference is taken in that width
+		const uint64_t mask = timestampBits >= 64 ? UINT64_MAX : (uint64_t{ 1 } << timestampBits) - 1;
+		const double ticks = static_cast<double>((timestamps[1] - timestamps[0]) & mask);
+		gpuFrameTimeMs = static_cast<float>(ticks * vefpDevice.properties.limits.timestampPeriod * 1e-6);
+		if (resolutionScaler) {
+			resolutionScaler->update(gpuFrameTimeMs);
+			sceneExtent = resolutionScaler->scaledExtent(sceneTarget->getMaxExtent());
+		}
+	}
+
+	void VefpRenderer::setPresentMode(VkPresentModeKHR presentMode) {
+		if (presentMode != preferredPresentMode) {
+			preferredPresentMode = presentMode;
+			presentModeChanged = true;
+		}
 	}
 
 	void VefpRenderer::createCommandBuffers() {
-		commandBuffers.resize(VefpSwapChain::MAX_FRAMES_IN_FLIGHT);
+		commandBuffers.resize(framesInFlight);
 
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -66,6 +184,13 @@ namespace vefp {
 
 	VkCommandBuffer VefpRenderer::beginFrame() {
 		assert(!isFrameStarted && "Can't call beginFrame while already in progress");
+		if (swapChainOutdated) {
+			recreateSwapChain();
+			if (swapChainOutdated) {
+				return nullptr;
+			}
+		}
+
 		auto result = vefpSwapChain->acquireNextImage(&currentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -77,6 +202,11 @@ namespace vefp {
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 		isFrameStarted = true;
+		destroyRetiredSwapChains();
+
+		// acquireNextImage waited for this frame's previous submit, nothing reads the old contents anymore
+		transientBuffers[currentFrameIndex].reset();
+		frameAllocator.beginFrame(currentFrameIndex);
 
 		auto commandBuffer = getCurrentCommandBuffer();
 
@@ -86,68 +216,131 @@ namespace vefp {
 		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
+
+		// the slot's previous submit has completed, so its timestamps can be read and reused
+		if (timestampPool != VK_NULL_HANDLE) {
+			readFrameTimestamps();
+			vkCmdResetQueryPool(commandBuffer, timestampPool, 2 * currentFrameIndex, 2);
+		}
+		frameStartTimestampWritten = false;
 		return commandBuffer;
 	}
 
 	void VefpRenderer::endFrame() {
 		assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
 		auto commandBuffer = getCurrentCommandBuffer();
+		// frames that never began the scene have no start to measure from
+		if (timestampPool != VK_NULL_HANDLE) {
+			if (frameStartTimestampWritten) {
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 2 * currentFrameIndex + 1);
+			}
+			timestampsWritten[currentFrameIndex] = frameStartTimestampWritten;
+		}
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to record command buffer!");
 		}
-		auto result = vefpSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vefpWindow.wasWindowResized()) {
+		auto result = vefpSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, frameWaits);
+		frameWaits.clear();
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vefpWindow.wasWindowResized() ||
+			presentModeChanged) {
 			vefpWindow.resetWindowResizedFlag();
 			recreateSwapChain();
 		}
-		if (result != VK_SUCCESS) {
+		else if (result != VK_SUCCESS) {
 			throw std::runtime_error("failed to present swap chain image!");
 		}
 
 		isFrameStarted = false;
-		currentFrameIndex = (currentFrameIndex + 1) % VefpSwapChain::MAX_FRAMES_IN_FLIGHT;
+		currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 	}
 
-	void VefpRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
-		assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-		assert(
-			commandBuffer == getCurrentCommandBuffer() &&
-			"Can't begin render pass on command buffer from a different frame");
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = vefpSwapChain->getRenderPass();
-		renderPassInfo.framebuffer = vefpSwapChain->getFrameBuffer(currentImageIndex);
+	void VefpRenderer::addFrameDependency(const VefpTimeline::Wait& wait) {
+		assert(isFrameStarted && "Can't add a frame dependency if frame is not in progress");
+		if (wait.value > 0) {
+			frameWaits.push_back(wait);
+		}
+	}
 
-		renderPassInfo.renderArea.offset = { 0,0 };
-		renderPassInfo.renderArea.extent = vefpSwapChain->getSwapChainExtent();
+	void VefpRenderer::writeFrameStartTimestamp(VkCommandBuffer commandBuffer) {
+		// The acquire semaphore holds back color attachment output, a timestamp at that stage starts
+		// counting once the image is there. Written at the top of the command buffer it would count
+		// waiting for the image under fifo as gpu time, and the resolution scaler would react to it.
+		if (timestampPool == VK_NULL_HANDLE || frameStartTimestampWritten) {
+			return;
+		}
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, timestampPool, 2 * currentFrameIndex);
+		frameStartTimestampWritten = true;
+	}
 
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+	void VefpRenderer::addScenePassTargets(VefpRenderGraph& renderGraph, VefpRenderGraph::PassBuilder& scenePass) {
+		if (sceneImagesChanged) {
+			renderGraph.releaseFramebuffers();
+			sceneImagesChanged = false;
+		}
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		// the frame submit waits for the acquire at color attachment output, the first use of the swap
+		// chain image is chained behind it
+		const VkExtent2D swapChainExtent = vefpSwapChain->getSwapChainExtent();
+		auto swapChainImage = renderGraph.importImage(
+			vefpSwapChain->getImage(currentImageIndex),
+			vefpSwapChain->getImageView(currentImageIndex),
+			swapChainExtent,
+			vefpSwapChain->getSwapChainImageFormat(),
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(vefpSwapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(vefpSwapChain->getSwapChainExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		VkRect2D scissor({ 0,0 }, vefpSwapChain->getSwapChainExtent());
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-	}
+		// depth images are cleared every frame, but may still be written by the frame before
+		const VkPipelineStageFlags depthStages =
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		VefpRenderGraph::ResourceId color = swapChainImage;
+		VefpRenderGraph::ResourceId depth;
+		if (sceneTarget) {
+			color = renderGraph.importImage(
+				sceneTarget->getColorImage(currentFrameIndex),
+				sceneTarget->getColorImageView(currentFrameIndex),
+				sceneExtent,
+				sceneTarget->getColorFormat(),
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_UNDEFINED);
+			depth = renderGraph.importImage(
+				sceneTarget->getDepthImage(currentFrameIndex),
+				sceneTarget->getDepthImageView(currentFrameIndex),
+				sceneExtent,
+				sceneTarget->getDepthFormat(),
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				depthStages,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+		}
+		else {
+			depth = renderGraph.importImage(
+				vefpSwapChain->getDepthImage(currentImageIndex),
+				vefpSwapChain->getDepthImageView(currentImageIndex),
+				swapChainExtent,
+				vefpSwapChain->getDepthFormat(),
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				depthStages,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+		}
 
-	void VefpRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
-		assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-		assert(
-			commandBuffer == getCurrentCommandBuffer() &&
-			"Can't end render pass on command buffer from a different frame");
-		vkCmdEndRenderPass(commandBuffer);
+		scenePass
+			.colorAttachment(color, { 0.01f, 0.01f, 0.01f, 1.0f })
+			.depthAttachment(depth, { 1.0f, 0 });
 
+		if (sceneTarget) {
+			renderGraph.addPass([this, swapChainExtent](VkCommandBuffer commandBuffer) {
+				sceneTarget->upscale(
+					commandBuffer,
+					currentFrameIndex,
+					sceneExtent,
+					vefpSwapChain->getImage(currentImageIndex),
+					swapChainExtent);
+			})
+				.read(color, RenderGraphUsage::TransferSrc)
+				.write(swapChainImage, RenderGraphUsage::TransferDst);
+		}
 	}
 
-}
\ No newline at end of file
+}
@@ -3,7 +3,14 @@
 #include "vefp_window.hpp"
 #include "vefp_device.hpp"
 #include "vefp_swap_chain.hpp"
+#include "vefp_frame_ring.hpp"
+#include "vefp_transient_buffer.hpp"
+#include "vefp_frame_arena.hpp"
+#include "vefp_scene_target.hpp"
+#include "vefp_resolution_scaler.hpp"
+#include "vefp_render_graph.hpp"
 
+#include <deque>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -14,26 +21,83 @@ namespace vefp {
 		void createCommandBuffers();
 		void freeCommandBuffers();
 		void recreateSwapChain();
+		void retireSwapChain(std::unique_ptr<VefpSwapChain> swapChain);
+		void destroyRetiredSwapChains();
+		void createSceneTarget();
+		void createTimestampQueries();
+		// gpu time of the last submit of the current frame slot, if it has been measured
+		void readFrameTimestamps();
+		void writeFrameStartTimestamp(VkCommandBuffer commandBuffer);
+		// the part of addScenePasses that does not depend on the draw function
+		void addScenePassTargets(VefpRenderGraph& renderGraph, VefpRenderGraph::PassBuilder& scenePass);
+
+		// a replaced swap chain lives until the frame timeline reaches retireValue, together with
+		// the scene target sized for it
+		struct RetiredSwapChain {
+			std::unique_ptr<VefpSwapChain> swapChain;
+			std::unique_ptr<VefpSceneTarget> sceneTarget;
+			uint64_t retireValue;
+		};
 
 		VefpWindow& vefpWindow;
 		VefpDevice& vefpDevice;
 		std::unique_ptr<VefpSwapChain> vefpSwapChain;
+		std::deque<RetiredSwapChain> retiredSwapChains;
+		bool swapChainOutdated = false;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VefpTimeline::Wait> frameWaits;
+		uint32_t framesInFlight;
+		VkPresentModeKHR preferredPresentMode;
+		bool presentModeChanged = false;
+		VefpFrameRing<VefpTransientBuffer> transientBuffers;
+		VefpFrameAllocator frameAllocator;
+
+		// dynamic resolution, the scene target only exists while it is enabled
+		std::unique_ptr<VefpResolutionScaler> resolutionScaler;
+		std::unique_ptr<VefpSceneTarget> sceneTarget;
+		VkExtent2D sceneExtent{};
+		// set when the images addScenePasses imports are replaced, the render graph's framebuffers
+		// for the old ones are released with the next scene passes
+		bool sceneImagesChanged = false;
 
-		uint32_t currentImageIndex;
-		int currentFrameIndex;
-		bool isFrameStarted;
+		// a begin and end timestamp per frame slot
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		std::vector<bool> timestampsWritten;
+		uint32_t timestampBits = 0;
+		bool frameStartTimestampWritten = false;
+		float gpuFrameTimeMs = 0.f;
+
+		uint32_t currentImageIndex = 0;
+		int currentFrameIndex = 0;
+		bool isFrameStarted = false;
 
 	public:
 
-		VefpRenderer(VefpWindow &window, VefpDevice &device);
+		static constexpr VkDeviceSize TRANSIENT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+		VefpRenderer(
+			VefpWindow &window,
+			VefpDevice &device,
+			uint32_t framesInFlight = VefpSwapChain::DEFAULT_FRAMES_IN_FLIGHT,
+			VkPresentModeKHR presentMode = VefpSwapChain::DEFAULT_PRESENT_MODE);
 		~VefpRenderer();
 
 		VefpRenderer(const VefpRenderer&) = delete;
 		VefpRenderer& operator=(const VefpRenderer&) = delete;
 	
 		VkRenderPass getSwapChainRenderPass() const { return vefpSwapChain->getRenderPass(); }
+		VkExtent2D getSwapChainExtent() const { return vefpSwapChain->getSwapChainExtent(); }
+		// what the scene pass renders at, below the swap chain extent while dynamic resolution scales down
+		VkExtent2D getSceneExtent() const { return sceneTarget ? sceneExtent : getSwapChainExtent(); }
 		bool isFrameInProgress() const { return isFrameStarted; }
+		uint32_t getFramesInFlight() const { return framesInFlight; }
+
+		// takes effect when the swap chain is recreated at the end of the current frame
+		void setPresentMode(VkPresentModeKHR presentMode);
+		VkPresentModeKHR getPresentMode() const { return vefpSwapChain->getPresentMode(); }
+
+		// gpu progress of submitted frames, the timeline survives swap chain recreation
+		VefpTimeline& getFrameTimeline() const { return vefpSwapChain->getFrameTimeline(); }
 
 		VkCommandBuffer getCurrentCommandBuffer() const {
 			assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
@@ -45,12 +109,46 @@ namespace vefp {
 			return currentFrameIndex;
 		}
 
+		// gpu visible scratch memory per frame slot, each rewound when its slot's frame begins.
+		// Index with getFrameIndex(), the other slots may only be used to create descriptors.
+		VefpFrameRing<VefpTransientBuffer>& getTransientBuffers() { return transientBuffers; }
+
+		// cpu scratch memory of the calling thread for the current frame, rewound by beginFrame
+		VefpFrameArena& getFrameArena() {
+			assert(isFrameStarted && "Cannot get frame arena when frame not in progress");
+			return frameAllocator.arena();
+		}
+		// for work that runs outside the frame, its arenas are those of the last frame begun
+		VefpFrameAllocator& getFrameAllocator() { return frameAllocator; }
+
+		// Renders the scene into an offscreen target sized to hold the gpu frame time within the budget
+		// and upscales it to the swap chain. Returns false, leaving rendering at full resolution, if
+		// the device cannot time frames or blit to the swap chain.
+		bool enableDynamicResolution(const VefpResolutionScaler::Settings& settings);
+		bool isDynamicResolutionEnabled() const { return resolutionScaler != nullptr; }
+		float getResolutionScale() const { return resolutionScaler ? resolutionScaler->getScale() : 1.f; }
+		// 0 until timestamps are available
+		float getGpuFrameTime() const { return gpuFrameTimeMs; }
+
+		// makes the current frame's submit wait for another timeline, values of 0 are ignored
+		void addFrameDependency(const VefpTimeline::Wait& wait);
+
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
-		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
-
-	
+		// Declares the passes that put the current frame on screen: the scene pass drawScene records
+		// into, drawing to the swap chain image or, with dynamic resolution, to the scene target which
+		// is then upscaled to it. The swap chain image is left ready to present. Returns the scene pass
+		// so the caller can declare what the draws read.
+		template<typename F>
+		VefpRenderGraph::PassBuilder addScenePasses(VefpRenderGraph& renderGraph, F drawScene) {
+			assert(isFrameStarted && "Can't add scene passes if frame is not in progress");
+			auto scenePass = renderGraph.addPass([this, drawScene](VkCommandBuffer commandBuffer) {
+				writeFrameStartTimestamp(commandBuffer);
+				drawScene(commandBuffer);
+			});
+			addScenePassTargets(renderGraph, scenePass);
+			return scenePass;
+		}
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "vefp_resolution_scaler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace vefp {
+
+	VefpResolutionScaler::VefpResolutionScaler(const Settings& settings, uint32_t latencyFrames)
+		: settings{ settings }, latencyFrames{ latencyFrames }, scale{ settings.maxScale } {
+		assert(settings.minScale > 0.f && settings.minScale <= settings.maxScale && "Invalid resolution scale range");
+		assert(settings.targetFrameMs > 0.f && "Frame time budget must be positive");
+	}
+
+	float VefpResolutionScaler::update(float gpuFrameMs) {
+		if (skipFrames > 0) {
+			skipFrames--;
+			return scale;
+		}
+		smoothedFrameMs = smoothedFrameMs == 0.f
+			? gpuFrameMs
+			: smoothedFrameMs + (gpuFrameMs - smoothedFrameMs) * SMOOTHING;
+		if (smoothedFrameMs <= 0.f) {
+			return scale;
+		}
+
+		float target = scale * std::sqrt(settings.targetFrameMs * settings.headroom / smoothedFrameMs);
+		target = std::clamp(target, scale * (1.f - MAX_STEP), scale * (1.f + MAX_STEP));
+		target = std::clamp(target, settings.minScale, settings.maxScale);
+		// small corrections are noise, except for settling exactly on the limits
+		const bool atLimit = target == settings.minScale || target == settings.maxScale;
+		if (target == scale || (!atLimit && std::abs(target - scale) < DEAD_BAND * scale)) {
+			return scale;
+		}
+
+		// the timings so far describe the old resolution, start over once the new one shows up
+		scale = target;
+		smoothedFrameMs = 0.f;
+		skipFrames = latencyFrames;
+		return scale;
+	}
+
+	VkExtent2D VefpResolutionScaler::scaledExtent(VkExtent2D fullExtent) const {
+		return {
+			std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.width * scale))),
+			std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.height * scale))) };
+	}
+
+}
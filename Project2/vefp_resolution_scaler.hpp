@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vefp_device.hpp"
+
+#include <cstdint>
+
+namespace vefp {
+
+	// Picks the render resolution from measured gpu frame times. Gpu time is assumed to follow the
+	// number of pixels, so the scale moves by the square root of budget / measured time. Changes are
+	// limited per step and ignored inside a small dead band, and after each change the measurements
+	// of frames that were already in flight at the old scale are skipped so the scale does not
+	// oscillate.
+	class VefpResolutionScaler {
+	public:
+		struct Settings {
+			float targetFrameMs = 1000.f / 60.f;
+			// per axis, relative to the swap chain extent
+			float minScale = 0.5f;
+			float maxScale = 1.f;
+			// aim this far below the budget so frame time noise does not cause misses
+			float headroom = 0.9f;
+		};
+
+		// measurements arrive latencyFrames frames after the frame they were taken in
+		VefpResolutionScaler(const Settings& settings, uint32_t latencyFrames);
+
+		// feeds the gpu time of a finished frame, returns the scale to render the next frame at
+		float update(float gpuFrameMs);
+
+		float getScale() const { return scale; }
+		// fullExtent scaled and rounded, never smaller than one pixel
+		VkExtent2D scaledExtent(VkExtent2D fullExtent) const;
+
+	private:
+		static constexpr float SMOOTHING = 0.2f;
+		static constexpr float MAX_STEP = 0.1f;
+		static constexpr float DEAD_BAND = 0.03f;
+
+		const Settings settings;
+		const uint32_t latencyFrames;
+		float scale;
+		float smoothedFrameMs = 0.f;
+		uint32_t skipFrames = 0;
+	};
+
+}
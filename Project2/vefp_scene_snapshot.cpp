@@ -0,0 +1,211 @@
+#include "vefp_scene_snapshot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace vefp {
+
+	static_assert(sizeof(glm::vec2) == 8 && sizeof(glm::vec3) == 12, "Snapshot sections expect tightly packed glm vectors");
+	static_assert(sizeof(VefpSceneSnapshot::FieldGrid) == 48, "FieldGrid is part of the file format");
+
+	// Puts from in place of to in a single step, to is never missing and never half written. Windows
+	// also waits for the rename to reach the disk so a crash right after keeps the new file.
+	static void replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+		if (!MoveFileExW(
+				std::filesystem::path{ from }.c_str(),
+				std::filesystem::path{ to }.c_str(),
+				MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+			throw std::runtime_error("failed to replace file: " + to);
+		}
+#else
+		std::error_code error;
+		std::filesystem::rename(from, to, error);
+		if (error) {
+			throw std::runtime_error("failed to replace file: " + to);
+		}
+#endif
+	}
+
+	// element size every known section type must have, unknown types are not checked
+	static uint32_t expectedElementSize(uint32_t type) {
+		using SectionType = VefpSceneSnapshot::SectionType;
+		switch (static_cast<SectionType>(type)) {
+			case SectionType::BodyPositions:
+			case SectionType::BodyVelocities:
+			case SectionType::BodyScales:
+				return sizeof(glm::vec2);
+			case SectionType::BodyMasses:
+				return sizeof(float);
+			case SectionType::BodyColors:
+				return sizeof(glm::vec3);
+			case SectionType::BodyModels:
+				return sizeof(uint32_t);
+			case SectionType::FieldGrids:
+				return sizeof(VefpSceneSnapshot::FieldGrid);
+			case SectionType::ModelRefs:
+				return sizeof(VefpSceneSnapshot::ModelRef);
+		}
+		return 0;
+	}
+
+	VefpSceneSnapshot::VefpSceneSnapshot(const std::string& filepath) : file{ filepath } {
+		validate(filepath);
+	}
+
+	void VefpSceneSnapshot::validate(const std::string& filepath) {
+		if (file.size() < sizeof(Header)) {
+			throw std::runtime_error("snapshot is truncated: " + filepath);
+		}
+		const auto* header = reinterpret_cast<const Header*>(file.data());
+		if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw std::runtime_error("file is not a scene snapshot: " + filepath);
+		}
+		if (header->version != VERSION) {
+			throw std::runtime_error("unsupported scene snapshot version: " + filepath);
+		}
+		if (header->fileSize != file.size() ||
+			header->sectionCount > (file.size() - sizeof(Header)) / sizeof(Section)) {
+			throw std::runtime_error("snapshot is truncated: " + filepath);
+		}
+
+		sections = {
+			reinterpret_cast<const Section*>(file.data() + sizeof(Header)), header->sectionCount };
+		for (const Section& section : sections) {
+			uint32_t expectedSize = expectedElementSize(section.type);
+			if (expectedSize != 0 && section.elementSize != expectedSize) {
+				throw std::runtime_error("snapshot section has the wrong element size: " + filepath);
+			}
+			if (section.offset % SECTION_ALIGNMENT != 0 ||
+				section.offset > file.size() ||
+				(section.elementSize != 0 && section.count > (file.size() - section.offset) / section.elementSize)) {
+				throw std::runtime_error("snapshot section is out of bounds: " + filepath);
+			}
+		}
+
+		// body sections are parallel arrays, anything that is present has to match the positions
+		size_t bodies = bodyPositions().size();
+		if ((!bodyVelocities().empty() && bodyVelocities().size() != bodies) ||
+			(!bodyMasses().empty() && bodyMasses().size() != bodies) ||
+			(!bodyScales().empty() && bodyScales().size() != bodies) ||
+			(!bodyColors().empty() && bodyColors().size() != bodies) ||
+			(!bodyModels().empty() && bodyModels().size() != bodies)) {
+			throw std::runtime_error("snapshot body sections differ in length: " + filepath);
+		}
+
+		const size_t models = modelRefs().size();
+		auto bodyModelRefs = bodyModels();
+		auto grids = fieldGrids();
+		if (std::any_of(bodyModelRefs.begin(), bodyModelRefs.end(), [&](uint32_t model) { return model >= models; }) ||
+			std::any_of(grids.begin(), grids.end(), [&](const FieldGrid& grid) { return grid.model >= models; })) {
+			throw std::runtime_error("snapshot references a model it does not contain: " + filepath);
+		}
+	}
+
+	const VefpSceneSnapshot::Section* VefpSceneSnapshot::findSection(SectionType type, size_t elementSize) const {
+		for (const Section& section : sections) {
+			if (section.type == static_cast<uint32_t>(type)) {
+				assert(section.elementSize == elementSize && "Section read with the wrong element type");
+				return &section;
+			}
+		}
+		return nullptr;
+	}
+
+	std::string VefpSceneSnapshot::modelName(uint32_t model) const {
+		const ModelRef& ref = modelRefs()[model];
+		return std::string(ref.name, strnlen(ref.name, MODEL_NAME_SIZE));
+	}
+
+	VefpSceneSnapshot::ModelRef VefpSceneSnapshot::makeModelRef(const std::string& name) {
+		if (name.size() > MODEL_NAME_SIZE) {
+			throw std::runtime_error("model name too long for scene snapshot: " + name);
+		}
+		ModelRef ref{};
+		std::memcpy(ref.name, name.data(), name.size());
+		return ref;
+	}
+
+	void VefpSceneSnapshot::write(const std::string& filepath, const Contents& contents) {
+		struct PendingSection {
+			SectionType type;
+			uint32_t elementSize;
+			size_t count;
+			const void* data;
+		};
+		std::vector<PendingSection> pending;
+		auto addSection = [&](SectionType type, auto span) {
+			if (!span.empty()) {
+				pending.push_back({ type, static_cast<uint32_t>(sizeof(span[0])), span.size(), span.data() });
+			}
+		};
+		addSection(SectionType::BodyPositions, contents.bodyPositions);
+		addSection(SectionType::BodyVelocities, contents.bodyVelocities);
+		addSection(SectionType::BodyMasses, contents.bodyMasses);
+		addSection(SectionType::BodyScales, contents.bodyScales);
+		addSection(SectionType::BodyColors, contents.bodyColors);
+		addSection(SectionType::BodyModels, contents.bodyModels);
+		addSection(SectionType::FieldGrids, contents.fieldGrids);
+		addSection(SectionType::ModelRefs, contents.modelRefs);
+
+		auto alignUp = [](uint64_t offset) { return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT; };
+
+		std::vector<Section> table;
+		uint64_t offset = alignUp(sizeof(Header) + pending.size() * sizeof(Section));
+		for (auto& section : pending) {
+			table.push_back({ static_cast<uint32_t>(section.type), section.elementSize, section.count, offset });
+			offset = alignUp(offset + section.elementSize * section.count);
+		}
+
+		Header header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.sectionCount = static_cast<uint32_t>(table.size());
+		header.fileSize = offset;
+
+		// written to a temporary first so a failed checkpoint never replaces a good one
+		const std::string tempPath = filepath + ".tmp";
+		try {
+			std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!out) {
+				throw std::runtime_error("failed to open file: " + tempPath);
+			}
+
+			static constexpr char padding[SECTION_ALIGNMENT]{};
+			auto pad = [&](uint64_t to) {
+				out.write(padding, static_cast<std::streamsize>(to - static_cast<uint64_t>(out.tellp())));
+			};
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(Section)));
+			for (size_t i = 0; i < pending.size(); i++) {
+				pad(table[i].offset);
+				out.write(static_cast<const char*>(pending[i].data), static_cast<std::streamsize>(pending[i].elementSize * pending[i].count));
+			}
+			pad(header.fileSize);
+
+			out.close();
+			if (!out) {
+				throw std::runtime_error("failed to write scene snapshot: " + tempPath);
+			}
+			replaceFile(tempPath, filepath);
+		}
+		catch (...) {
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+			throw;
+		}
+	}
+
+}
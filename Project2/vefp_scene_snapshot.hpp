@@ -0,0 +1,123 @@
+#pragma once
+
+#include "vefp_mapped_file.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace vefp {
+
+	// Binary scene file for initial conditions and checkpoints. Layout, little endian:
+	//   Header
+	//   Section[sectionCount]
+	//   section data, each section starting at a multiple of SECTION_ALIGNMENT
+	// Every section is a tightly packed array of a single type with one entry per body (or grid,
+	// or model), so a mapped snapshot is read in place without any parsing. Unknown sections are
+	// skipped, new ones can be added without bumping VERSION.
+	class VefpSceneSnapshot {
+	public:
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint64_t SECTION_ALIGNMENT = 64;
+		static constexpr size_t MODEL_NAME_SIZE = 32;
+
+		enum class SectionType : uint32_t {
+			BodyPositions = 1,  // glm::vec2
+			BodyVelocities = 2, // glm::vec2
+			BodyMasses = 3,     // float
+			BodyScales = 4,     // glm::vec2
+			BodyColors = 5,     // glm::vec3
+			BodyModels = 6,     // uint32_t index into ModelRefs
+			FieldGrids = 7,     // FieldGrid
+			ModelRefs = 8,      // ModelRef
+		};
+
+		// models are referenced by name, the application decides what a name stands for
+		struct ModelRef {
+			char name[MODEL_NAME_SIZE];
+		};
+
+		// regular grid of field sample points covering [min, max]
+		struct FieldGrid {
+			glm::vec2 min;
+			glm::vec2 max;
+			uint32_t columns;
+			uint32_t rows;
+			uint32_t model;
+			float pointScale;
+			glm::vec3 color;
+			uint32_t reserved;
+		};
+
+		// what write puts into a file, the body spans have to be of equal length
+		struct Contents {
+			std::span<const glm::vec2> bodyPositions;
+			std::span<const glm::vec2> bodyVelocities;
+			std::span<const float> bodyMasses;
+			std::span<const glm::vec2> bodyScales;
+			std::span<const glm::vec3> bodyColors;
+			std::span<const uint32_t> bodyModels;
+			std::span<const FieldGrid> fieldGrids;
+			std::span<const ModelRef> modelRefs;
+		};
+
+		// maps the file and validates the header and section table, the data itself is not touched
+		explicit VefpSceneSnapshot(const std::string& filepath);
+
+		VefpSceneSnapshot(const VefpSceneSnapshot&) = delete;
+		VefpSceneSnapshot& operator=(const VefpSceneSnapshot&) = delete;
+
+		static void write(const std::string& filepath, const Contents& contents);
+		static ModelRef makeModelRef(const std::string& name);
+
+		uint32_t bodyCount() const { return static_cast<uint32_t>(bodyPositions().size()); }
+		std::span<const glm::vec2> bodyPositions() const { return section<glm::vec2>(SectionType::BodyPositions); }
+		std::span<const glm::vec2> bodyVelocities() const { return section<glm::vec2>(SectionType::BodyVelocities); }
+		std::span<const float> bodyMasses() const { return section<float>(SectionType::BodyMasses); }
+		std::span<const glm::vec2> bodyScales() const { return section<glm::vec2>(SectionType::BodyScales); }
+		std::span<const glm::vec3> bodyColors() const { return section<glm::vec3>(SectionType::BodyColors); }
+		std::span<const uint32_t> bodyModels() const { return section<uint32_t>(SectionType::BodyModels); }
+		std::span<const FieldGrid> fieldGrids() const { return section<FieldGrid>(SectionType::FieldGrids); }
+		std::span<const ModelRef> modelRefs() const { return section<ModelRef>(SectionType::ModelRefs); }
+		// name of a model reference without the zero padding
+		std::string modelName(uint32_t model) const;
+
+	private:
+		static constexpr char MAGIC[8] = { 'V', 'E', 'F', 'P', 'S', 'N', 'A', 'P' };
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t sectionCount;
+			uint64_t fileSize;
+		};
+
+		struct Section {
+			uint32_t type;
+			uint32_t elementSize;
+			uint64_t count;
+			uint64_t offset;
+		};
+
+		template<typename T>
+		std::span<const T> section(SectionType type) const {
+			const Section* entry = findSection(type, sizeof(T));
+			if (entry == nullptr) {
+				return {};
+			}
+			return { reinterpret_cast<const T*>(file.data() + entry->offset), static_cast<size_t>(entry->count) };
+		}
+
+		const Section* findSection(SectionType type, size_t elementSize) const;
+		void validate(const std::string& filepath);
+
+		VefpMappedFile file;
+		std::span<const Section> sections;
+	};
+
+}
@@ -0,0 +1,127 @@
+#include "vefp_scene_target.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace vefp {
+
+	VefpSceneTarget::VefpSceneTarget(
+		VefpDevice& device,
+		VkExtent2D maxExtent,
+		VkFormat colorFormat,
+		VkFormat depthFormat,
+		uint32_t framesInFlight)
+		: vefpDevice{ device }, maxExtent{ maxExtent }, colorFormat{ colorFormat }, depthFormat{ depthFormat } {
+		assert(isSupported(device, colorFormat) && "Scene target format cannot be blitted");
+
+		// linear filtering is optional for blits, nearest still upscales, just blockier
+		VkFormatProperties properties = vefpDevice.getFormatProperties(colorFormat);
+		upscaleFilter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0
+			? VK_FILTER_LINEAR
+			: VK_FILTER_NEAREST;
+
+		frames.resize(framesInFlight);
+		for (auto& frame : frames) {
+			createAttachments(frame);
+		}
+	}
+
+	VefpSceneTarget::~VefpSceneTarget() {
+		for (auto& frame : frames) {
+			vkDestroyImageView(vefpDevice.device(), frame.colorImageView, nullptr);
+			vkDestroyImage(vefpDevice.device(), frame.colorImage, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.colorImageMemory, nullptr);
+			vkDestroyImageView(vefpDevice.device(), frame.depthImageView, nullptr);
+			vkDestroyImage(vefpDevice.device(), frame.depthImage, nullptr);
+			vkFreeMemory(vefpDevice.device(), frame.depthImageMemory, nullptr);
+		}
+	}
+
+	bool VefpSceneTarget::isSupported(VefpDevice& device, VkFormat colorFormat) {
+		VkFormatProperties properties = device.getFormatProperties(colorFormat);
+		const VkFormatFeatureFlags required =
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+		return (properties.optimalTilingFeatures & required) == required;
+	}
+
+	void VefpSceneTarget::createAttachments(FrameAttachments& frame) {
+		createImage(
+			colorFormat,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			frame.colorImage,
+			frame.colorImageMemory,
+			frame.colorImageView);
+		createImage(
+			depthFormat,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_DEPTH_BIT,
+			frame.depthImage,
+			frame.depthImageMemory,
+			frame.depthImageView);
+	}
+
+	void VefpSceneTarget::createImage(
+		VkFormat format,
+		VkImageUsageFlags usage,
+		VkImageAspectFlags aspect,
+		VkImage& image,
+		VkDeviceMemory& imageMemory,
+		VkImageView& imageView) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = maxExtent.width;
+		imageInfo.extent.height = maxExtent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vefpDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(vefpDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture image view!");
+		}
+	}
+
+	void VefpSceneTarget::upscale(
+		VkCommandBuffer commandBuffer,
+		int frameIndex,
+		VkExtent2D renderExtent,
+		VkImage target,
+		VkExtent2D targetExtent) {
+		assert(renderExtent.width <= maxExtent.width && renderExtent.height <= maxExtent.height && "Render extent exceeds the scene target");
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1] = { static_cast<int32_t>(targetExtent.width), static_cast<int32_t>(targetExtent.height), 1 };
+		vkCmdBlitImage(
+			commandBuffer,
+			frames[frameIndex].colorImage,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			target,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&blit,
+			upscaleFilter);
+	}
+
+}
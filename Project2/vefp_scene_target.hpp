@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vefp_device.hpp"
+
+#include <vector>
+
+namespace vefp {
+
+	// Offscreen color and depth attachments the scene is drawn into when it renders below the swap
+	// chain resolution. The images have the full swap chain extent and a frame only uses the top left
+	// renderExtent of them, so changing the resolution never reallocates. Formats match the swap
+	// chain, so render passes over them stay compatible with pipelines created for the swap chain
+	// pass. The render graph places the barriers around drawing into them and upscaling.
+	class VefpSceneTarget {
+	public:
+		VefpSceneTarget(
+			VefpDevice& device,
+			VkExtent2D maxExtent,
+			VkFormat colorFormat,
+			VkFormat depthFormat,
+			uint32_t framesInFlight);
+		~VefpSceneTarget();
+
+		VefpSceneTarget(const VefpSceneTarget&) = delete;
+		VefpSceneTarget& operator=(const VefpSceneTarget&) = delete;
+
+		// the color format has to be usable as a blit source and destination
+		static bool isSupported(VefpDevice& device, VkFormat colorFormat);
+
+		VkExtent2D getMaxExtent() const { return maxExtent; }
+		VkFormat getColorFormat() const { return colorFormat; }
+		VkFormat getDepthFormat() const { return depthFormat; }
+		VkImage getColorImage(int frameIndex) const { return frames[frameIndex].colorImage; }
+		VkImageView getColorImageView(int frameIndex) const { return frames[frameIndex].colorImageView; }
+		VkImage getDepthImage(int frameIndex) const { return frames[frameIndex].depthImage; }
+		VkImageView getDepthImageView(int frameIndex) const { return frames[frameIndex].depthImageView; }
+
+		// stretches the top left renderExtent of the color image over the target, the color image has
+		// to be in the transfer source layout and the target in the transfer destination layout
+		void upscale(
+			VkCommandBuffer commandBuffer,
+			int frameIndex,
+			VkExtent2D renderExtent,
+			VkImage target,
+			VkExtent2D targetExtent);
+
+	private:
+		struct FrameAttachments {
+			VkImage colorImage;
+			VkDeviceMemory colorImageMemory;
+			VkImageView colorImageView;
+			VkImage depthImage;
+			VkDeviceMemory depthImageMemory;
+			VkImageView depthImageView;
+		};
+
+		void createAttachments(FrameAttachments& frame);
+		void createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+			VkImage& image, VkDeviceMemory& imageMemory, VkImageView& imageView);
+
+		VefpDevice& vefpDevice;
+		const VkExtent2D maxExtent;
+		const VkFormat colorFormat;
+		const VkFormat depthFormat;
+		VkFilter upscaleFilter;
+		std::vector<FrameAttachments> frames;
+	};
+
+}
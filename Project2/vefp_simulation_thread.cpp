@@ -0,0 +1,115 @@
+#include "vefp_simulation_thread.hpp"
+
+#include "vefp_frame_pacer.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vefp {
+
+	VefpSimulationThread::VefpSimulationThread(const Snapshot& initial, StepFunction step)
+		: VefpSimulationThread(initial, std::move(step), Settings{}) {}
+
+	VefpSimulationThread::VefpSimulationThread(const Snapshot& initial, StepFunction step, const Settings& settings)
+		: settings{ settings }, step{ std::move(step) }, state{ initial }, snapshots{ initial }, previous{ initial }, blended{ initial } {
+		assert(settings.timeStep > 0.f && "Simulation time step must be positive");
+		assert(settings.maxCatchUpSteps > 0 && "Simulation has to be allowed at least one step per wake up");
+	}
+
+	VefpSimulationThread::~VefpSimulationThread() {
+		running = false;
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	void VefpSimulationThread::start() {
+		assert(!thread.joinable() && "Simulation thread is already running");
+		running = true;
+		thread = std::thread{ &VefpSimulationThread::simulationLoop, this };
+	}
+
+	void VefpSimulationThread::stop() {
+		running = false;
+		if (thread.joinable()) {
+			thread.join();
+		}
+		if (failed) {
+			std::rethrow_exception(failure);
+		}
+	}
+
+	const VefpSimulationThread::Snapshot& VefpSimulationThread::latest() {
+		if (failed.load(std::memory_order_acquire)) {
+			std::rethrow_exception(failure);
+		}
+		// the slot read so far goes back to the writer, keep it to interpolate from
+		if (snapshots.hasNew()) {
+			const Snapshot& current = snapshots.readSlot();
+			previous.step = current.step;
+			previous.time = current.time;
+			previous.positions.assign(current.positions.begin(), current.positions.end());
+			previous.velocities.assign(current.velocities.begin(), current.velocities.end());
+			previous.dueTime = current.dueTime;
+		}
+		newSnapshot = snapshots.acquire();
+		return snapshots.readSlot();
+	}
+
+	const VefpSimulationThread::Snapshot& VefpSimulationThread::interpolated() {
+		const Snapshot& newest = latest();
+		const double elapsed = std::chrono::duration<double>(Clock::now() - newest.dueTime).count();
+		const float alpha = static_cast<float>(std::clamp(elapsed / settings.timeStep, 0.0, 1.0));
+
+		blended.step = newest.step;
+		blended.time = previous.time + (newest.time - previous.time) * alpha;
+		blended.dueTime = newest.dueTime;
+		for (size_t i = 0; i < newest.positions.size(); i++) {
+			blended.positions[i] = glm::mix(previous.positions[i], newest.positions[i], alpha);
+			blended.velocities[i] = glm::mix(previous.velocities[i], newest.velocities[i], alpha);
+		}
+		return blended;
+	}
+
+	void VefpSimulationThread::simulationLoop() {
+		const auto timeStep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings.timeStep));
+
+		try {
+			auto nextStep = Clock::now();
+			while (running.load(std::memory_order_relaxed)) {
+				VefpFramePacer::sleepUntil(nextStep);
+
+				// catches up on steps missed while sleeping too long or stepping too slowly
+				uint32_t steps = 0;
+				const auto now = Clock::now();
+				while (nextStep <= now && steps < settings.maxCatchUpSteps) {
+					step(state, settings.timeStep);
+					state.step++;
+					state.time += settings.timeStep;
+
+					// assigning into the slot reuses its vectors once they have the size of the state
+					Snapshot& snapshot = snapshots.writeSlot();
+					snapshot.step = state.step;
+					snapshot.time = state.time;
+					snapshot.positions.assign(state.positions.begin(), state.positions.end());
+					snapshot.velocities.assign(state.velocities.begin(), state.velocities.end());
+					snapshot.dueTime = nextStep;
+					snapshots.publish();
+
+					nextStep += timeStep;
+					steps++;
+				}
+				if (nextStep <= now) {
+					const auto behind = (now - nextStep) / timeStep + 1;
+					droppedSteps.fetch_add(static_cast<uint64_t>(behind), std::memory_order_relaxed);
+					nextStep += behind * timeStep;
+				}
+			}
+		}
+		catch (...) {
+			failure = std::current_exception();
+			failed.store(true, std::memory_order_release);
+		}
+	}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "vefp_triple_buffer.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace vefp {
+
+	// Steps the simulation at a fixed rate on its own thread and publishes every step as a snapshot
+	// through a triple buffer, so rendering and simulation never wait on each other: a slow frame
+	// does not hold back physics, and a slow step only means the renderer draws the last snapshot
+	// again. The step function owns the simulation state, snapshots are copies of it. The renderer
+	// draws between the last two snapshots it got, so bodies move smoothly at any frame rate.
+	class VefpSimulationThread {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Snapshot {
+			uint64_t step = 0;
+			double time = 0.0;
+			std::vector<glm::vec2> positions;
+			std::vector<glm::vec2> velocities;
+			// when the step was scheduled to run, set when it is published
+			Clock::time_point dueTime{};
+		};
+
+		// advances state by timeStep, runs on the simulation thread only
+		using StepFunction = std::function<void(Snapshot& state, float timeStep)>;
+
+		struct Settings {
+			float timeStep = 1.f / 60;
+			// steps run back to back to catch up after a stall, time beyond that is dropped
+			uint32_t maxCatchUpSteps = 4;
+		};
+
+		VefpSimulationThread(const Snapshot& initial, StepFunction step);
+		VefpSimulationThread(const Snapshot& initial, StepFunction step, const Settings& settings);
+		~VefpSimulationThread();
+
+		VefpSimulationThread(const VefpSimulationThread&) = delete;
+		VefpSimulationThread& operator=(const VefpSimulationThread&) = delete;
+
+		void start();
+		// waits for the step in progress, rethrows what the step function threw
+		void stop();
+
+		// Render thread side. Returns the newest published snapshot, which stays valid and unchanged
+		// until the next call. Rethrows what the step function threw.
+		const Snapshot& latest();
+		// whether the last call to latest() got a snapshot it had not returned before
+		bool hasNewSnapshot() const { return newSnapshot; }
+		// Render thread side, calls latest(). The bodies between the snapshot latest() returned before
+		// and the newest one, by how much of a step has passed since the newest one was due. Lags the
+		// simulation by up to a step. Stays valid and unchanged until the next call.
+		const Snapshot& interpolated();
+
+		// steps skipped because the simulation fell more than maxCatchUpSteps behind
+		uint64_t getDroppedSteps() const { return droppedSteps.load(std::memory_order_relaxed); }
+
+	private:
+		void simulationLoop();
+
+		const Settings settings;
+		StepFunction step;
+		// only touched by the simulation thread while it runs
+		Snapshot state;
+		VefpTripleBuffer<Snapshot> snapshots;
+
+		// render thread side, sized like the state from the start so copying into them never allocates
+		Snapshot previous;
+		Snapshot blended;
+		bool newSnapshot = false;
+		std::atomic<bool> running{ false };
+		std::atomic<uint64_t> droppedSteps{ 0 };
+		// set by the simulation thread before it exits on an exception
+		std::atomic<bool> failed{ false };
+		std::exception_ptr failure;
+		std::thread thread;
+	};
+
+}
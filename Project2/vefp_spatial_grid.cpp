@@ -0,0 +1,81 @@
+#include "vefp_spatial_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vefp {
+
+	void VefpSpatialGrid::build(std::span<const Aabb2d> itemBounds) {
+		bounds = itemBounds;
+		cellStart.clear();
+		cellItems.clear();
+		if (bounds.empty()) {
+			return;
+		}
+
+		// the grid adapts to the union of all item centers
+		gridBounds = { bounds[0].center(), bounds[0].center() };
+		maxHalfExtent = glm::vec2{ 0.f };
+		for (auto& b : bounds) {
+			glm::vec2 c = b.center();
+			gridBounds.min = glm::min(gridBounds.min, c);
+			gridBounds.max = glm::max(gridBounds.max, c);
+			maxHalfExtent = glm::max(maxHalfExtent, b.halfExtent());
+		}
+
+		float cellsNeeded = static_cast<float>(bounds.size()) / static_cast<float>(targetItemsPerCell);
+		cellsPerAxis = std::clamp(static_cast<int>(std::ceil(std::sqrt(cellsNeeded))), 1, 256);
+		cellSize = glm::max((gridBounds.max - gridBounds.min) / static_cast<float>(cellsPerAxis), glm::vec2{ 1e-6f });
+
+		// counting sort of item indices by cell
+		const size_t cellCount = static_cast<size_t>(cellsPerAxis) * cellsPerAxis;
+		cellStart.assign(cellCount + 1, 0);
+		itemCell.resize(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++) {
+			glm::ivec2 coord = cellCoord(bounds[i].center());
+			itemCell[i] = coord.y * cellsPerAxis + coord.x;
+			cellStart[itemCell[i] + 1]++;
+		}
+		for (size_t c = 0; c < cellCount; c++) {
+			cellStart[c + 1] += cellStart[c];
+		}
+
+		cellItems.resize(bounds.size());
+		cursor.assign(cellStart.begin(), cellStart.end() - 1);
+		for (size_t i = 0; i < bounds.size(); i++) {
+			cellItems[cursor[itemCell[i]]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	void VefpSpatialGrid::query(const Aabb2d& region, std::pmr::vector<uint32_t>& out) const {
+		if (bounds.empty()) {
+			return;
+		}
+
+		const size_t firstResult = out.size();
+		glm::ivec2 lo = cellCoord(region.min - maxHalfExtent);
+		glm::ivec2 hi = cellCoord(region.max + maxHalfExtent);
+		for (int y = lo.y; y <= hi.y; y++) {
+			for (int x = lo.x; x <= hi.x; x++) {
+				const int cell = y * cellsPerAxis + x;
+				for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+					uint32_t item = cellItems[i];
+					if (bounds[item].overlaps(region)) {
+						out.push_back(item);
+					}
+				}
+			}
+		}
+
+		// keep submission order stable, draw order decides which of two overlapping objects wins
+		std::sort(out.begin() + firstResult, out.end());
+	}
+
+	glm::ivec2 VefpSpatialGrid::cellCoord(glm::vec2 point) const {
+		glm::vec2 local = (point - gridBounds.min) / cellSize;
+		return {
+			std::clamp(static_cast<int>(std::floor(local.x)), 0, cellsPerAxis - 1),
+			std::clamp(static_cast<int>(std::floor(local.y)), 0, cellsPerAxis - 1) };
+	}
+
+}
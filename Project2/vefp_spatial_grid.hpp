@@ -0,0 +1,48 @@
+#pragma once
+
+#include "vefp_bounds.hpp"
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace vefp {
+
+	// Loose uniform grid over a set of bounding boxes. Every item lives in the single cell that
+	// contains its center, queries widen the search region by the largest item extent so
+	// items straddling cell borders are still found. The cells are allocated from storage, pass a
+	// frame arena for grids that are rebuilt every frame.
+	class VefpSpatialGrid {
+	public:
+		explicit VefpSpatialGrid(
+			std::pmr::memory_resource* storage = std::pmr::get_default_resource(),
+			uint32_t itemsPerCell = 4)
+			: targetItemsPerCell{ itemsPerCell }, cellStart{ storage }, cellItems{ storage }, itemCell{ storage }, cursor{ storage } {}
+
+		// itemBounds is not copied and has to outlive the queries
+		void build(std::span<const Aabb2d> itemBounds);
+		// appends the indices of all items overlapping region to out, in ascending order
+		void query(const Aabb2d& region, std::pmr::vector<uint32_t>& out) const;
+
+		size_t itemCount() const { return bounds.size(); }
+
+	private:
+		glm::ivec2 cellCoord(glm::vec2 point) const;
+
+		uint32_t targetItemsPerCell;
+
+		Aabb2d gridBounds{};
+		glm::vec2 cellSize{ 1.f };
+		glm::vec2 maxHalfExtent{ 0.f };
+		int cellsPerAxis = 1;
+
+		std::span<const Aabb2d> bounds;
+		std::pmr::vector<uint32_t> cellStart;
+		std::pmr::vector<uint32_t> cellItems;
+		// scratch storage of build
+		std::pmr::vector<uint32_t> itemCell;
+		std::pmr::vector<uint32_t> cursor;
+	};
+
+}
@@ -1,7 +1,9 @@
 #include "vefp_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -11,13 +13,29 @@
 
 namespace vefp {
 
-    VefpSwapChain::VefpSwapChain(VefpDevice& deviceRef, VkExtent2D extent)
-        : device{ deviceRef }, windowExtent{ extent } {
+    VefpSwapChain::VefpSwapChain(
+        VefpDevice& deviceRef,
+        VkExtent2D extent,
+        uint32_t framesInFlight,
+        VkPresentModeKHR preferredPresentMode)
+        : device{ deviceRef },
+        windowExtent{ extent },
+        framesInFlight{ framesInFlight },
+        preferredPresentMode{ preferredPresentMode } {
+        assert(framesInFlight > 0 && "Need at least one frame in flight");
         init();
     }    
     
-    VefpSwapChain::VefpSwapChain(VefpDevice& deviceRef, VkExtent2D extent, std::shared_ptr<VefpSwapChain> previous)
-        : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
+    VefpSwapChain::VefpSwapChain(
+        VefpDevice& deviceRef,
+        VkExtent2D extent,
+        const VefpSwapChain& previous,
+        VkPresentModeKHR preferredPresentMode)
+        : device{ deviceRef },
+        windowExtent{ extent },
+        framesInFlight{ previous.framesInFlight },
+        preferredPresentMode{ preferredPresentMode },
+        oldSwapChain{ &previous } {
         init();
 
         oldSwapChain = nullptr;
@@ -56,20 +74,14 @@ namespace vefp {
         vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
         // cleanup synchronization objects
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < framesInFlight; i++) {
             vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device.device(), inFlightFences[i], nullptr);
         }
     }
 
     VkResult VefpSwapChain::acquireNextImage(uint32_t* imageIndex) {
-        vkWaitForFences(
-            device.device(),
-            1,
-            &inFlightFences[currentFrame],
-            VK_TRUE,
-            std::numeric_limits<uint64_t>::max());
+        frameTimeline->wait(frameSubmitValues[currentFrame]);
 
         VkResult result = vkAcquireNextImageKHR(
             device.device(),
@@ -83,11 +95,8 @@ namespace vefp {
     }
 
     VkResult VefpSwapChain::submitCommandBuffers(
-        const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-        if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-        }
-        imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+        const VkCommandBuffer* buffers, uint32_t* imageIndex, const std::vector<VefpTimeline::Wait>& waits) {
+        frameTimeline->wait(imageSubmitValues[*imageIndex]);
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -105,11 +114,9 @@ namespace vefp {
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
-        }
+        uint64_t submitValue = frameTimeline->submit(device.graphicsQueue(), submitInfo, waits.data(), waits.size());
+        frameSubmitValues[currentFrame] = submitValue;
+        imageSubmitValues[*imageIndex] = submitValue;
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -125,7 +132,7 @@ namespace vefp {
 
         auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % framesInFlight;
 
         return result;
     }
@@ -134,10 +141,11 @@ namespace vefp {
         SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+        // deeper pipelining needs an image for every frame being recorded plus one being presented
+        uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, framesInFlight + 1);
         if (swapChainSupport.capabilities.maxImageCount > 0 &&
             imageCount > swapChainSupport.capabilities.maxImageCount) {
             imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -152,7 +160,11 @@ namespace vefp {
         createInfo.imageColorSpace = surfaceFormat.colorSpace;
         createInfo.imageExtent = extent;
         createInfo.imageArrayLayers = 1;
-        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+            imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        }
+        createInfo.imageUsage = imageUsage;
 
         QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
         uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
@@ -349,24 +361,29 @@ namespace vefp {
     }
 
     void VefpSwapChain::createSyncObjects() {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+        imageAvailableSemaphores.resize(framesInFlight);
+        renderFinishedSemaphores.resize(framesInFlight);
+        imageSubmitValues.resize(imageCount(), 0);
+
+        // frame progress carries over from the previous swap chain, a value of 0 is always complete
+        if (oldSwapChain != nullptr) {
+            frameTimeline = oldSwapChain->frameTimeline;
+            frameSubmitValues = oldSwapChain->frameSubmitValues;
+            currentFrame = oldSwapChain->currentFrame;
+        }
+        else {
+            frameTimeline = std::make_shared<VefpTimeline>(device);
+            frameSubmitValues.resize(framesInFlight, 0);
+        }
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo = {};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < framesInFlight; i++) {
             if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
                 VK_SUCCESS ||
                 vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-                VK_SUCCESS ||
-                vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+                VK_SUCCESS) {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
@@ -387,23 +404,31 @@ namespace vefp {
     VkPresentModeKHR VefpSwapChain::chooseSwapPresentMode(
         const std::vector<VkPresentModeKHR>& availablePresentModes) {
         for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                std::cout << "Present mode: Mailbox" << std::endl;
+            if (availablePresentMode == preferredPresentMode) {
+                std::cout << "Present mode: " << presentModeName(availablePresentMode) << std::endl;
                 return availablePresentMode;
             }
         }
 
-        // for (const auto &availablePresentMode : availablePresentModes) {
-        //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-        //     std::cout << "Present mode: Immediate" << std::endl;
-        //     return availablePresentMode;
-        //   }
-        // }
-
-        std::cout << "Present mode: V-Sync" << std::endl;
+        std::cout << "Present mode: " << presentModeName(VK_PRESENT_MODE_FIFO_KHR) << std::endl;
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    const char* VefpSwapChain::presentModeName(VkPresentModeKHR mode) {
+        switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "Immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "Mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "V-Sync";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "V-Sync (relaxed)";
+        default:
+            return "Unknown";
+        }
+    }
+
     VkExtent2D VefpSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
             return capabilities.currentExtent;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vefp_device.hpp"
+#include "vefp_timeline.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -14,10 +15,23 @@ namespace vefp {
 
     class VefpSwapChain {
     public:
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-        VefpSwapChain(VefpDevice& deviceRef, VkExtent2D extent);
-        VefpSwapChain(VefpDevice& deviceRef, VkExtent2D extent, std::shared_ptr<VefpSwapChain> previous);
+        static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+        static constexpr VkPresentModeKHR DEFAULT_PRESENT_MODE = VK_PRESENT_MODE_MAILBOX_KHR;
+
+        // falls back to FIFO, which every device supports, when preferredPresentMode is not available
+        VefpSwapChain(
+            VefpDevice& deviceRef,
+            VkExtent2D extent,
+            uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT,
+            VkPresentModeKHR preferredPresentMode = DEFAULT_PRESENT_MODE);
+        // Replaces previous, keeping its frames in flight and frame timeline. previous is only used
+        // during construction, the caller must keep it alive until its submitted frames are done.
+        VefpSwapChain(
+            VefpDevice& deviceRef,
+            VkExtent2D extent,
+            const VefpSwapChain& previous,
+            VkPresentModeKHR preferredPresentMode);
         ~VefpSwapChain();
 
         VefpSwapChain(const VefpSwapChain&) = delete;
@@ -26,19 +40,36 @@ namespace vefp {
         VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
         VkRenderPass getRenderPass() { return renderPass; }
         VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+        VkImage getImage(int index) { return swapChainImages[index]; }
+        VkImage getDepthImage(int index) { return depthImages[index]; }
+        VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
         size_t imageCount() { return swapChainImages.size(); }
         VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
         VkExtent2D getSwapChainExtent() { return swapChainExtent; }
         uint32_t width() { return swapChainExtent.width; }
         uint32_t height() { return swapChainExtent.height; }
+        uint32_t getFramesInFlight() const { return framesInFlight; }
+        VkPresentModeKHR getPresentMode() const { return presentMode; }
+        static const char* presentModeName(VkPresentModeKHR mode);
 
         float extentAspectRatio() {
             return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
         }
         VkFormat findDepthFormat();
+        VkFormat getDepthFormat() const { return swapChainDepthFormat; }
+        // images can be blitted to, e.g. to upscale an offscreen scene
+        bool supportsTransferDst() const { return (imageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0; }
 
         VkResult acquireNextImage(uint32_t* imageIndex);
-        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+        // waits are added to the frame submit, e.g. uploads the frame's commands consume
+        VkResult submitCommandBuffers(
+            const VkCommandBuffer* buffers,
+            uint32_t* imageIndex,
+            const std::vector<VefpTimeline::Wait>& waits = {});
+
+        // shared with the swap chains this one is recreated into, so timeline values stay valid across resizes
+        VefpTimeline& getFrameTimeline() { return *frameTimeline; }
+        std::shared_ptr<VefpTimeline> shareFrameTimeline() { return frameTimeline; }
 
         bool compareSwapFormats(const VefpSwapChain& swapChain) const {
             return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
@@ -64,6 +95,7 @@ namespace vefp {
         VkFormat swapChainImageFormat;
         VkFormat swapChainDepthFormat;
         VkExtent2D swapChainExtent;
+        VkImageUsageFlags imageUsage;
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
         VkRenderPass renderPass;
@@ -76,14 +108,18 @@ namespace vefp {
 
         VefpDevice& device;
         VkExtent2D windowExtent;
+        uint32_t framesInFlight;
+        VkPresentModeKHR preferredPresentMode;
+        VkPresentModeKHR presentMode;
 
         VkSwapchainKHR swapChain;
-        std::shared_ptr<VefpSwapChain> oldSwapChain;
+        const VefpSwapChain* oldSwapChain = nullptr;
 
         std::vector<VkSemaphore> imageAvailableSemaphores;
         std::vector<VkSemaphore> renderFinishedSemaphores;
-        std::vector<VkFence> inFlightFences;
-        std::vector<VkFence> imagesInFlight;
+        std::shared_ptr<VefpTimeline> frameTimeline;
+        std::vector<uint64_t> frameSubmitValues;
+        std::vector<uint64_t> imageSubmitValues;
         size_t currentFrame = 0;
     };
 
@@ -0,0 +1,212 @@
+#include "vefp_task_graph.hpp"
+#include "vefp_alloc_counter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace vefp {
+
+	VefpTaskGraph::TaskBuilder& VefpTaskGraph::TaskBuilder::after(TaskId other) {
+		assert(other < task && "Tasks can only run after tasks added before them");
+		graph.tasks[task].after.push_back(other);
+		return *this;
+	}
+
+	VefpTaskGraph::VefpTaskGraph(VefpFrameAllocator& scratch) : VefpTaskGraph(scratch, Settings{}) {}
+
+	VefpTaskGraph::VefpTaskGraph(VefpFrameAllocator& scratch, const Settings& settings) : scratch{ scratch } {
+		uint32_t workerCount = settings.workerCount;
+		if (workerCount == 0) {
+			workerCount = std::clamp(std::thread::hardware_concurrency(), 2u, MAX_DEFAULT_WORKERS + 1) - 1;
+		}
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back(&VefpTaskGraph::workerLoop, this);
+		}
+	}
+
+	VefpTaskGraph::~VefpTaskGraph() {
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			changed.wait(lock, [&] { return remainingTasks == 0; });
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	VefpTaskGraph::TaskBuilder VefpTaskGraph::addTask(std::string name, TaskFunction function) {
+		assert(!running && "Tasks can not be added while the graph runs");
+		tasks.emplace_back();
+		tasks.back().name = std::move(name);
+		tasks.back().function = std::move(function);
+		dependenciesBuilt = false;
+		return TaskBuilder{ *this, static_cast<TaskId>(tasks.size() - 1) };
+	}
+
+	void VefpTaskGraph::buildDependencies() {
+		for (TaskId later = 0; later < tasks.size(); later++) {
+			Task& task = tasks[later];
+			task.dependencies = task.after;
+			for (TaskId earlier = 0; earlier < later; earlier++) {
+				const Task& other = tasks[earlier];
+				const bool conflict = (other.writes & (task.reads | task.writes)) != 0 || (other.reads & task.writes) != 0;
+				if (conflict) {
+					task.dependencies.push_back(earlier);
+				}
+			}
+			std::sort(task.dependencies.begin(), task.dependencies.end());
+			task.dependencies.erase(std::unique(task.dependencies.begin(), task.dependencies.end()), task.dependencies.end());
+		}
+
+		for (Task& task : tasks) {
+			task.successors.clear();
+		}
+		for (TaskId id = 0; id < tasks.size(); id++) {
+			for (TaskId dependency : tasks[id].dependencies) {
+				tasks[dependency].successors.push_back(id);
+			}
+		}
+		dependenciesBuilt = true;
+	}
+
+	void VefpTaskGraph::launch() {
+		assert(!running && "Graph is already running, wait for it first");
+		if (!dependenciesBuilt) {
+			buildDependencies();
+		}
+		launchTime = Clock::now();
+		running = true;
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			remainingTasks = static_cast<uint32_t>(tasks.size());
+			readyTasks.clear();
+			for (TaskId id = 0; id < tasks.size(); id++) {
+				tasks[id].pendingDependencies = static_cast<uint32_t>(tasks[id].dependencies.size());
+				if (tasks[id].pendingDependencies == 0) {
+					readyTasks.push_back(id);
+				}
+			}
+		}
+		changed.notify_all();
+	}
+
+	void VefpTaskGraph::wait() {
+		assert(running && "Graph was not launched");
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (remainingTasks > 0) {
+			if (!readyTasks.empty()) {
+				const TaskId task = readyTasks.back();
+				readyTasks.pop_back();
+				runTask(task, lock, false);
+				continue;
+			}
+			changed.wait(lock, [&] { return remainingTasks == 0 || !readyTasks.empty(); });
+		}
+		running = false;
+		std::exception_ptr taskFailure = std::exchange(failure, nullptr);
+		VefpAllocCounter::addThreadAllocations(std::exchange(workerAllocations, 0));
+		lock.unlock();
+
+		computeStats();
+		if (taskFailure) {
+			std::rethrow_exception(taskFailure);
+		}
+	}
+
+	void VefpTaskGraph::workerLoop() {
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (true) {
+			changed.wait(lock, [&] { return stopping || !readyTasks.empty(); });
+			if (stopping) {
+				return;
+			}
+			const TaskId task = readyTasks.back();
+			readyTasks.pop_back();
+			runTask(task, lock, true);
+		}
+	}
+
+	void VefpTaskGraph::runTask(TaskId id, std::unique_lock<std::mutex>& lock, bool worker) {
+		Task& task = tasks[id];
+		lock.unlock();
+		const uint64_t allocations = VefpAllocCounter::threadAllocations();
+		task.start = Clock::now();
+		std::exception_ptr taskFailure;
+		try {
+			task.function(scratch.arena());
+		}
+		catch (...) {
+			taskFailure = std::current_exception();
+		}
+		task.end = Clock::now();
+		lock.lock();
+
+		if (worker) {
+			workerAllocations += VefpAllocCounter::threadAllocations() - allocations;
+		}
+		if (taskFailure && !failure) {
+			failure = taskFailure;
+		}
+		bool released = false;
+		for (TaskId successor : task.successors) {
+			if (--tasks[successor].pendingDependencies == 0) {
+				readyTasks.push_back(successor);
+				released = true;
+			}
+		}
+		remainingTasks--;
+		if (released || remainingTasks == 0) {
+			changed.notify_all();
+		}
+	}
+
+	void VefpTaskGraph::computeStats() {
+		using Milliseconds = std::chrono::duration<float, std::milli>;
+		stats.tasks = static_cast<uint32_t>(tasks.size());
+		stats.workMs = 0.f;
+		stats.criticalPathMs = 0.f;
+		stats.criticalPath.clear();
+
+		// dependencies always come earlier, so one pass in order finds the longest chain ending at
+		// every task
+		Clock::time_point lastEnd = launchTime;
+		chainMs.resize(tasks.size());
+		chainPrevious.resize(tasks.size());
+		TaskId longest = 0;
+		for (TaskId id = 0; id < tasks.size(); id++) {
+			const Task& task = tasks[id];
+			const float durationMs = Milliseconds(task.end - task.start).count();
+			stats.workMs += durationMs;
+			lastEnd = std::max(lastEnd, task.end);
+
+			chainMs[id] = durationMs;
+			chainPrevious[id] = id;
+			for (TaskId dependency : task.dependencies) {
+				if (chainMs[dependency] + durationMs > chainMs[id]) {
+					chainMs[id] = chainMs[dependency] + durationMs;
+					chainPrevious[id] = dependency;
+				}
+			}
+			if (chainMs[id] > chainMs[longest]) {
+				longest = id;
+			}
+		}
+		stats.wallMs = Milliseconds(lastEnd - launchTime).count();
+
+		if (!tasks.empty()) {
+			stats.criticalPathMs = chainMs[longest];
+			for (TaskId id = longest;; id = chainPrevious[id]) {
+				stats.criticalPath.push_back(id);
+				if (chainPrevious[id] == id) {
+					break;
+				}
+			}
+			std::reverse(stats.criticalPath.begin(), stats.criticalPath.end());
+		}
+	}
+
+}
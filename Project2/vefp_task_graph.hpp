@@ -0,0 +1,152 @@
+#pragma once
+
+#include "vefp_ecs.hpp"
+#include "vefp_frame_arena.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vefp {
+
+	// Runs a fixed set of per frame tasks on a worker pool. Tasks declare which components they read
+	// and write; in the order they were added, a task waits for every earlier task that writes
+	// something it touches or reads something it writes, and anything else runs side by side.
+	//
+	// launch() starts a run and returns right away, wait() helps working through it on the calling
+	// thread and returns once every task finished. Launching the next frame's run right after
+	// recording a frame overlaps it with submitting, presenting and acquiring the next image, as long
+	// as nothing outside the graph touches the declared components until wait() returns.
+	//
+	// Tasks take their scratch memory from the renderer's frame allocator, so a pipelined run lives in
+	// the arenas of the frame that launched it and needs more than one frame in flight.
+	class VefpTaskGraph {
+	public:
+		using TaskId = uint32_t;
+		// scratch belongs to the thread running the task and lives until the frame slot that was
+		// current when the task started begins again
+		using TaskFunction = std::function<void(VefpFrameArena& scratch)>;
+
+		// systems spread their own loops over all cores, the workers only have to overlap the systems
+		static constexpr uint32_t MAX_DEFAULT_WORKERS = 4;
+
+		struct Settings {
+			// 0 uses all but one hardware thread up to MAX_DEFAULT_WORKERS, the thread calling wait()
+			// works as well
+			uint32_t workerCount = 0;
+		};
+
+		// of the last finished run
+		struct Stats {
+			uint32_t tasks = 0;
+			// from launch until the last task finished
+			float wallMs = 0.f;
+			// summed over all tasks
+			float workMs = 0.f;
+			// longest chain of dependent tasks, the fastest the run could go with unlimited workers
+			float criticalPathMs = 0.f;
+			std::vector<TaskId> criticalPath;
+		};
+
+		class TaskBuilder {
+		public:
+			template<typename... Ts>
+			TaskBuilder& reads() {
+				graph.tasks[task].reads |= componentMask<Ts...>();
+				return *this;
+			}
+			template<typename... Ts>
+			TaskBuilder& writes() {
+				graph.tasks[task].writes |= componentMask<Ts...>();
+				return *this;
+			}
+			// ordering for data that is not a component
+			TaskBuilder& after(TaskId other);
+
+			TaskId id() const { return task; }
+
+		private:
+			friend class VefpTaskGraph;
+			TaskBuilder(VefpTaskGraph& graph, TaskId task) : graph{ graph }, task{ task } {}
+
+			VefpTaskGraph& graph;
+			TaskId task;
+		};
+
+		explicit VefpTaskGraph(VefpFrameAllocator& scratch);
+		VefpTaskGraph(VefpFrameAllocator& scratch, const Settings& settings);
+		// waits for a launched run
+		~VefpTaskGraph();
+
+		VefpTaskGraph(const VefpTaskGraph&) = delete;
+		VefpTaskGraph& operator=(const VefpTaskGraph&) = delete;
+
+		// tasks can only be added while no run is in progress
+		TaskBuilder addTask(std::string name, TaskFunction function);
+
+		void launch();
+		// rethrows the first exception a task threw, the other tasks still run
+		void wait();
+		bool isRunning() const { return running; }
+
+		const Stats& getStats() const { return stats; }
+		const std::string& getTaskName(TaskId task) const { return tasks[task].name; }
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Task {
+			std::string name;
+			TaskFunction function;
+			ComponentMask reads = 0;
+			ComponentMask writes = 0;
+			std::vector<TaskId> after;
+
+			// set by buildDependencies
+			std::vector<TaskId> dependencies;
+			std::vector<TaskId> successors;
+
+			// of the current run
+			uint32_t pendingDependencies = 0;
+			Clock::time_point start;
+			Clock::time_point end;
+		};
+
+		void buildDependencies();
+		void workerLoop();
+		// runs the task without the lock and takes it again to release its successors, allocations
+		// of tasks run by a worker are charged to the thread calling wait()
+		void runTask(TaskId task, std::unique_lock<std::mutex>& lock, bool worker);
+		void computeStats();
+
+		std::vector<Task> tasks;
+		bool dependenciesBuilt = false;
+		VefpFrameAllocator& scratch;
+		Stats stats{};
+		Clock::time_point launchTime;
+		bool running = false;
+		// longest chain ending at every task and the task before it on that chain
+		std::vector<float> chainMs;
+		std::vector<TaskId> chainPrevious;
+
+		// shared with the workers
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::vector<TaskId> readyTasks;
+		uint32_t remainingTasks = 0;
+		std::exception_ptr failure;
+		// made by the workers during the run, charged to the thread calling wait()
+		uint64_t workerAllocations = 0;
+		bool stopping = false;
+
+		std::vector<std::thread> workers;
+	};
+
+}
@@ -0,0 +1,190 @@
+#include "vefp_timeline.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace vefp {
+
+    static constexpr size_t MAX_SUBMIT_SEMAPHORES = 8;
+
+    VefpTimeline::VefpTimeline(VefpDevice& deviceRef) : device{ deviceRef } {
+        if (!device.supportsTimelineSemaphores()) {
+            return;
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timeline semaphore!");
+        }
+    }
+
+    VefpTimeline::~VefpTimeline() {
+        if (semaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(device.device(), semaphore, nullptr);
+        }
+        for (auto& pending : pendingFences) {
+            vkDestroyFence(device.device(), pending.fence, nullptr);
+        }
+        for (auto fence : freeFences) {
+            vkDestroyFence(device.device(), fence, nullptr);
+        }
+    }
+
+    uint64_t VefpTimeline::submit(
+        VkQueue queue, const VkSubmitInfo& submitInfo, const Wait* waits, size_t waitCount) {
+        assert(submitInfo.pNext == nullptr && "VefpTimeline::submit owns the pNext chain of the submit info");
+        const uint64_t value = submittedValue + 1;
+
+        if (!usesTimelineSemaphore()) {
+            for (size_t i = 0; i < waitCount; i++) {
+                waits[i].timeline->wait(waits[i].value);
+            }
+
+            VkFence fence = acquireFence();
+            if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+                freeFences.push_back(fence);
+                throw std::runtime_error("failed to submit command buffer!");
+            }
+            pendingFences.push_back({ value, fence });
+            submittedValue = value;
+            return value;
+        }
+
+        assert(submitInfo.waitSemaphoreCount + waitCount <= MAX_SUBMIT_SEMAPHORES && "too many wait semaphores");
+        assert(submitInfo.signalSemaphoreCount + 1 <= MAX_SUBMIT_SEMAPHORES && "too many signal semaphores");
+
+        // values of binary semaphores are ignored, they only need a slot in the value arrays
+        std::array<VkSemaphore, MAX_SUBMIT_SEMAPHORES> waitSemaphores{};
+        std::array<uint64_t, MAX_SUBMIT_SEMAPHORES> waitValues{};
+        std::array<VkPipelineStageFlags, MAX_SUBMIT_SEMAPHORES> waitStages{};
+        uint32_t semaphoreWaitCount = 0;
+        for (uint32_t i = 0; i < submitInfo.waitSemaphoreCount; i++) {
+            waitSemaphores[semaphoreWaitCount] = submitInfo.pWaitSemaphores[i];
+            waitStages[semaphoreWaitCount] = submitInfo.pWaitDstStageMask[i];
+            semaphoreWaitCount++;
+        }
+        for (size_t i = 0; i < waitCount; i++) {
+            const Wait& wait = waits[i];
+            if (wait.timeline->isComplete(wait.value)) {
+                continue;
+            }
+            waitSemaphores[semaphoreWaitCount] = wait.timeline->getSemaphore();
+            waitValues[semaphoreWaitCount] = wait.value;
+            waitStages[semaphoreWaitCount] = wait.stage;
+            semaphoreWaitCount++;
+        }
+
+        std::array<VkSemaphore, MAX_SUBMIT_SEMAPHORES> signalSemaphores{};
+        std::array<uint64_t, MAX_SUBMIT_SEMAPHORES> signalValues{};
+        uint32_t signalCount = 0;
+        for (uint32_t i = 0; i < submitInfo.signalSemaphoreCount; i++) {
+            signalSemaphores[signalCount++] = submitInfo.pSignalSemaphores[i];
+        }
+        signalSemaphores[signalCount] = semaphore;
+        signalValues[signalCount] = value;
+        signalCount++;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = semaphoreWaitCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = signalCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo info = submitInfo;
+        info.pNext = &timelineInfo;
+        info.waitSemaphoreCount = semaphoreWaitCount;
+        info.pWaitSemaphores = waitSemaphores.data();
+        info.pWaitDstStageMask = waitStages.data();
+        info.signalSemaphoreCount = signalCount;
+        info.pSignalSemaphores = signalSemaphores.data();
+
+        if (vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit command buffer!");
+        }
+        submittedValue = value;
+        return value;
+    }
+
+    uint64_t VefpTimeline::completedValue() {
+        if (usesTimelineSemaphore()) {
+            uint64_t value = 0;
+            vkGetSemaphoreCounterValue(device.device(), semaphore, &value);
+            completed = std::max(completed, value);
+            return completed;
+        }
+
+        while (!pendingFences.empty() &&
+            vkGetFenceStatus(device.device(), pendingFences.front().fence) == VK_SUCCESS) {
+            retireFence();
+        }
+        return completed;
+    }
+
+    void VefpTimeline::wait(uint64_t value) {
+        assert(value <= submittedValue && "Cannot wait for a value that was never submitted");
+        if (value <= completed) {
+            return;
+        }
+
+        if (usesTimelineSemaphore()) {
+            VkSemaphoreWaitInfo waitInfo = {};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &semaphore;
+            waitInfo.pValues = &value;
+            vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
+            completed = value;
+            return;
+        }
+
+        while (!pendingFences.empty() && pendingFences.front().value <= value) {
+            vkWaitForFences(
+                device.device(),
+                1,
+                &pendingFences.front().fence,
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max());
+            retireFence();
+        }
+    }
+
+    VkFence VefpTimeline::acquireFence() {
+        if (!freeFences.empty()) {
+            VkFence fence = freeFences.back();
+            freeFences.pop_back();
+            return fence;
+        }
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence fence;
+        if (vkCreateFence(device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create fence!");
+        }
+        return fence;
+    }
+
+    void VefpTimeline::retireFence() {
+        PendingFence pending = pendingFences.front();
+        pendingFences.pop_front();
+
+        vkResetFences(device.device(), 1, &pending.fence);
+        freeFences.push_back(pending.fence);
+        completed = std::max(completed, pending.value);
+    }
+
+}  // namespace vefp
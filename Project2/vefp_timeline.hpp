@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vefp_device.hpp"
+
+// std lib headers
+#include <deque>
+#include <initializer_list>
+#include <vector>
+
+namespace vefp {
+
+    // Monotonic counter of gpu progress. Every submission made through the timeline signals the next
+    // value, so cpu work and other submissions can wait for exactly the work they depend on.
+    // Backed by a timeline semaphore when the device supports it, otherwise by one fence per submission.
+    class VefpTimeline {
+    public:
+        struct Wait {
+            VefpTimeline* timeline;
+            uint64_t value;
+            VkPipelineStageFlags stage;
+        };
+
+        VefpTimeline(VefpDevice& deviceRef);
+        ~VefpTimeline();
+
+        VefpTimeline(const VefpTimeline&) = delete;
+        VefpTimeline& operator=(const VefpTimeline&) = delete;
+
+        // Submits a single batch and returns the value reached once it completes. Binary semaphores in
+        // submitInfo are kept, waits on other timelines are added on top. With the fence fallback those
+        // waits are resolved on the cpu before submitting.
+        uint64_t submit(VkQueue queue, const VkSubmitInfo& submitInfo, std::initializer_list<Wait> waits = {}) {
+            return submit(queue, submitInfo, waits.begin(), waits.size());
+        }
+        uint64_t submit(VkQueue queue, const VkSubmitInfo& submitInfo, const Wait* waits, size_t waitCount);
+
+        uint64_t completedValue();
+        bool isComplete(uint64_t value) { return value <= completedValue(); }
+        void wait(uint64_t value);
+
+        uint64_t lastSubmittedValue() const { return submittedValue; }
+        bool usesTimelineSemaphore() const { return semaphore != VK_NULL_HANDLE; }
+        VkSemaphore getSemaphore() const { return semaphore; }
+
+    private:
+        struct PendingFence {
+            uint64_t value;
+            VkFence fence;
+        };
+
+        VkFence acquireFence();
+        void retireFence();
+
+        VefpDevice& device;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t submittedValue = 0;
+        uint64_t completed = 0;
+
+        // fence fallback
+        std::deque<PendingFence> pendingFences;
+        std::vector<VkFence> freeFences;
+    };
+
+}  // namespace vefp
@@ -0,0 +1,378 @@
+#include "vefp_trajectory.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vefp {
+
+	namespace trajectory {
+
+		static constexpr char MAGIC[8] = { 'V', 'E', 'F', 'P', 'T', 'R', 'A', 'J' };
+
+		static uint32_t zigzag(int32_t value) {
+			return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+		}
+
+		static int32_t unzigzag(uint32_t value) {
+			return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+		}
+
+		static void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+			while (value >= 0x80) {
+				out.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<uint8_t>(value));
+		}
+
+		static uint32_t readVarint(const uint8_t*& cursor, const uint8_t* end) {
+			uint32_t value = 0;
+			for (uint32_t shift = 0; shift < 35; shift += 7) {
+				if (cursor == end) {
+					throw std::runtime_error("trajectory block is truncated!");
+				}
+				uint8_t byte = *cursor++;
+				value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0) {
+					return value;
+				}
+			}
+			throw std::runtime_error("trajectory block is corrupted!");
+		}
+
+		static int32_t quantize(float value, float step) {
+			const double steps = std::round(static_cast<double>(value) / step);
+			if (std::isnan(steps)) {
+				return 0;
+			}
+			return static_cast<int32_t>(std::clamp(steps, -static_cast<double>(MAX_QUANTIZED), static_cast<double>(MAX_QUANTIZED)));
+		}
+
+	}
+
+	VefpTrajectoryRecorder::VefpTrajectoryRecorder(const std::string& filepath, uint32_t bodyCount, float timeStep)
+		: VefpTrajectoryRecorder(filepath, bodyCount, timeStep, Settings{}) {}
+
+	VefpTrajectoryRecorder::VefpTrajectoryRecorder(
+		const std::string& filepath,
+		uint32_t bodyCount,
+		float timeStep,
+		const Settings& settings)
+		: bodyCount{ bodyCount },
+		settings{ settings },
+		out{ filepath, std::ios::binary | std::ios::trunc } {
+		if (!out) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+		assert(settings.framesPerBlock > 0 && settings.maxQueuedBlocks > 0 && "Invalid trajectory settings");
+
+		trajectory::Header header{};
+		std::memcpy(header.magic, trajectory::MAGIC, sizeof(header.magic));
+		header.version = trajectory::VERSION;
+		header.bodyCount = bodyCount;
+		header.framesPerBlock = settings.framesPerBlock;
+		header.timeStep = timeStep;
+		header.positionStep = settings.positionStep;
+		header.velocityStep = settings.velocityStep;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!out) {
+			throw std::runtime_error("failed to write trajectory header: " + filepath);
+		}
+
+		// every block is allocated up front, recording never touches the heap
+		const size_t valuesPerFrame = static_cast<size_t>(bodyCount) * trajectory::VALUES_PER_BODY;
+		for (uint32_t i = 0; i < settings.maxQueuedBlocks + 1; i++) {
+			auto block = std::make_unique<Block>();
+			block->deltas.reserve(valuesPerFrame * settings.framesPerBlock);
+			freeBlocks.push_back(block.get());
+			blocks.push_back(std::move(block));
+		}
+		currentBlock = freeBlocks.back();
+		freeBlocks.pop_back();
+		previousValues.resize(valuesPerFrame);
+		values.resize(valuesPerFrame);
+
+		writer = std::thread{ &VefpTrajectoryRecorder::writerLoop, this };
+	}
+
+	VefpTrajectoryRecorder::~VefpTrajectoryRecorder() {
+		if (!finished) {
+			try {
+				finish();
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+	}
+
+	void VefpTrajectoryRecorder::finish() {
+		assert(!finished && "Trajectory recording is already finished");
+		finished = true;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (currentBlock->frameCount > 0) {
+				queuedBlocks.push_back(currentBlock);
+			}
+			stopping = true;
+		}
+		blockQueued.notify_one();
+		writer.join();
+		if (writeFailed) {
+			throw std::runtime_error("failed to write trajectory blocks!");
+		}
+
+		trajectory::Footer footer{};
+		footer.indexOffset = static_cast<uint64_t>(out.tellp());
+		footer.blockCount = static_cast<uint32_t>(index.size());
+		footer.frameCount = index.empty() ? 0 : index.back().firstFrame + index.back().frameCount;
+		std::memcpy(footer.magic, trajectory::MAGIC, sizeof(footer.magic));
+		out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(trajectory::IndexEntry));
+		out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+		out.flush();
+		if (!out) {
+			throw std::runtime_error("failed to write trajectory index!");
+		}
+	}
+
+	void VefpTrajectoryRecorder::record(std::span<const glm::vec2> positions, std::span<const glm::vec2> velocities) {
+		assert(positions.size() == bodyCount && velocities.size() == bodyCount && "Body count changed while recording");
+		assert(!finished && "Trajectory recording is already finished");
+		if (writeFailed.load(std::memory_order_relaxed)) {
+			throw std::runtime_error("failed to write trajectory!");
+		}
+
+		for (uint32_t i = 0; i < bodyCount; i++) {
+			values[i * 4 + 0] = trajectory::quantize(positions[i].x, settings.positionStep);
+			values[i * 4 + 1] = trajectory::quantize(positions[i].y, settings.positionStep);
+			values[i * 4 + 2] = trajectory::quantize(velocities[i].x, settings.velocityStep);
+			values[i * 4 + 3] = trajectory::quantize(velocities[i].y, settings.velocityStep);
+		}
+
+		// the first frame of a block is stored relative to zero so it can be decoded on its own
+		if (currentBlock->frameCount == 0) {
+			currentBlock->firstFrame = frameCount;
+			std::fill(previousValues.begin(), previousValues.end(), 0);
+		}
+		// both values are within MAX_QUANTIZED of zero, so the delta can not overflow
+		for (size_t i = 0; i < values.size(); i++) {
+			currentBlock->deltas.push_back(values[i] - previousValues[i]);
+		}
+		std::swap(values, previousValues);
+		currentBlock->frameCount++;
+		frameCount++;
+
+		if (currentBlock->frameCount == settings.framesPerBlock) {
+			currentBlock = submitBlock(currentBlock);
+		}
+	}
+
+	VefpTrajectoryRecorder::Block* VefpTrajectoryRecorder::submitBlock(Block* block) {
+		Block* next = block;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (!freeBlocks.empty()) {
+				queuedBlocks.push_back(block);
+				next = freeBlocks.back();
+				freeBlocks.pop_back();
+			}
+			else {
+				// the writer is maxQueuedBlocks behind, lose this block rather than wait for it
+				droppedFrames += block->frameCount;
+			}
+		}
+
+		if (next != block) {
+			blockQueued.notify_one();
+		}
+		next->frameCount = 0;
+		next->deltas.clear();
+		return next;
+	}
+
+	void VefpTrajectoryRecorder::writerLoop() {
+		while (true) {
+			Block* block = nullptr;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				blockQueued.wait(lock, [&]() { return stopping || !queuedBlocks.empty(); });
+				if (queuedBlocks.empty()) {
+					return;
+				}
+				block = queuedBlocks.front();
+				queuedBlocks.pop_front();
+			}
+
+			// after a failed write the stream position is lost, later blocks could only corrupt the file
+			if (!writeFailed.load(std::memory_order_relaxed)) {
+				writeBlock(*block);
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			freeBlocks.push_back(block);
+		}
+	}
+
+	void VefpTrajectoryRecorder::writeBlock(const Block& block) {
+		// byte 0 can only start the varint of a zero, so it marks a run of zeros followed by its length
+		encoded.clear();
+		uint32_t zeros = 0;
+		for (int32_t delta : block.deltas) {
+			if (delta == 0) {
+				zeros++;
+				continue;
+			}
+			if (zeros > 0) {
+				encoded.push_back(0);
+				trajectory::writeVarint(encoded, zeros - 1);
+				zeros = 0;
+			}
+			trajectory::writeVarint(encoded, trajectory::zigzag(delta));
+		}
+		if (zeros > 0) {
+			encoded.push_back(0);
+			trajectory::writeVarint(encoded, zeros - 1);
+		}
+
+		trajectory::BlockHeader blockHeader{};
+		blockHeader.firstFrame = block.firstFrame;
+		blockHeader.frameCount = block.frameCount;
+		blockHeader.byteSize = static_cast<uint32_t>(encoded.size());
+
+		index.push_back({ static_cast<uint64_t>(out.tellp()), block.firstFrame, block.frameCount });
+		out.write(reinterpret_cast<const char*>(&blockHeader), sizeof(blockHeader));
+		out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+		if (!out) {
+			writeFailed.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	VefpTrajectoryReader::VefpTrajectoryReader(const std::string& filepath) : file{ filepath } {
+		if (file.size() < sizeof(trajectory::Header)) {
+			throw std::runtime_error("trajectory is truncated: " + filepath);
+		}
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, trajectory::MAGIC, sizeof(header.magic)) != 0) {
+			throw std::runtime_error("file is not a trajectory: " + filepath);
+		}
+		if (header.version != trajectory::VERSION) {
+			throw std::runtime_error("unsupported trajectory version: " + filepath);
+		}
+		// replay divides by the time step and scales by the quantization steps
+		auto validStep = [](float step) { return std::isfinite(step) && step > 0.f; };
+		if (!validStep(header.timeStep) || !validStep(header.positionStep) || !validStep(header.velocityStep)) {
+			throw std::runtime_error("trajectory has invalid step sizes: " + filepath);
+		}
+
+		buildIndex();
+		values.resize(static_cast<size_t>(header.bodyCount) * trajectory::VALUES_PER_BODY);
+	}
+
+	void VefpTrajectoryReader::buildIndex() {
+		trajectory::Footer footer{};
+		if (file.size() >= sizeof(trajectory::Header) + sizeof(footer)) {
+			std::memcpy(&footer, file.data() + file.size() - sizeof(footer), sizeof(footer));
+		}
+
+		const uint64_t indexEnd = file.size() - sizeof(footer);
+		if (std::memcmp(footer.magic, trajectory::MAGIC, sizeof(footer.magic)) == 0 &&
+			footer.indexOffset <= indexEnd &&
+			footer.blockCount == (indexEnd - footer.indexOffset) / sizeof(trajectory::IndexEntry)) {
+			index.resize(footer.blockCount);
+			std::memcpy(index.data(), file.data() + footer.indexOffset, footer.blockCount * sizeof(trajectory::IndexEntry));
+		}
+		else {
+			// no footer, the recording was cut short: walk the blocks that made it to disk
+			uint64_t offset = sizeof(trajectory::Header);
+			while (offset + sizeof(trajectory::BlockHeader) <= file.size()) {
+				trajectory::BlockHeader blockHeader{};
+				std::memcpy(&blockHeader, file.data() + offset, sizeof(blockHeader));
+				uint64_t blockEnd = offset + sizeof(blockHeader) + blockHeader.byteSize;
+				if (blockEnd > file.size() || blockHeader.frameCount == 0) {
+					break;
+				}
+				index.push_back({ offset, blockHeader.firstFrame, blockHeader.frameCount });
+				offset = blockEnd;
+			}
+		}
+
+		for (auto& entry : index) {
+			trajectory::BlockHeader blockHeader{};
+			if (entry.offset + sizeof(blockHeader) > file.size()) {
+				throw std::runtime_error("trajectory index is corrupted!");
+			}
+			std::memcpy(&blockHeader, file.data() + entry.offset, sizeof(blockHeader));
+			if (entry.offset + sizeof(blockHeader) + blockHeader.byteSize > file.size()) {
+				throw std::runtime_error("trajectory index is corrupted!");
+			}
+		}
+		frames = index.empty() ? 0 : index.back().firstFrame + index.back().frameCount;
+	}
+
+	void VefpTrajectoryReader::readFrame(uint32_t frame, std::span<glm::vec2> positions, std::span<glm::vec2> velocities) {
+		assert(positions.size() >= header.bodyCount && velocities.size() >= header.bodyCount && "Spans too small for frame");
+		if (index.empty()) {
+			throw std::runtime_error("trajectory contains no frames!");
+		}
+
+		// last block starting at or before frame, gaps from dropped blocks resolve to its last frame
+		auto blockIter = std::upper_bound(index.begin(), index.end(), frame, [](uint32_t f, const trajectory::IndexEntry& entry) {
+			return f < entry.firstFrame;
+		});
+		size_t block = blockIter == index.begin() ? 0 : static_cast<size_t>(blockIter - index.begin()) - 1;
+		const auto& entry = index[block];
+		uint32_t frameInBlock = std::min(frame - std::min(frame, entry.firstFrame), entry.frameCount - 1);
+
+		if (block != currentBlock || frameInBlock + 1 < decodedFrames) {
+			beginBlock(block);
+		}
+		while (decodedFrames <= frameInBlock) {
+			decodeNextFrame();
+		}
+
+		for (uint32_t i = 0; i < header.bodyCount; i++) {
+			positions[i] = glm::vec2(values[i * 4 + 0], values[i * 4 + 1]) * header.positionStep;
+			velocities[i] = glm::vec2(values[i * 4 + 2], values[i * 4 + 3]) * header.velocityStep;
+		}
+	}
+
+	void VefpTrajectoryReader::beginBlock(size_t block) {
+		trajectory::BlockHeader blockHeader{};
+		std::memcpy(&blockHeader, file.data() + index[block].offset, sizeof(blockHeader));
+		cursor = reinterpret_cast<const uint8_t*>(file.data() + index[block].offset + sizeof(blockHeader));
+		blockEnd = cursor + blockHeader.byteSize;
+		currentBlock = block;
+		decodedFrames = 0;
+		pendingZeros = 0;
+		std::fill(values.begin(), values.end(), 0);
+	}
+
+	void VefpTrajectoryReader::decodeNextFrame() {
+		// wraps instead of overflowing on corrupted files, valid ones stay within MAX_QUANTIZED
+		for (int32_t& value : values) {
+			value = static_cast<int32_t>(static_cast<uint32_t>(value) + static_cast<uint32_t>(nextDelta()));
+		}
+		decodedFrames++;
+	}
+
+	int32_t VefpTrajectoryReader::nextDelta() {
+		if (pendingZeros > 0) {
+			pendingZeros--;
+			return 0;
+		}
+		if (cursor == blockEnd) {
+			throw std::runtime_error("trajectory block is truncated!");
+		}
+		if (*cursor == 0) {
+			cursor++;
+			pendingZeros = trajectory::readVarint(cursor, blockEnd);
+			return 0;
+		}
+		return trajectory::unzigzag(trajectory::readVarint(cursor, blockEnd));
+	}
+
+}
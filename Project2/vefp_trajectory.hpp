@@ -0,0 +1,181 @@
+#pragma once
+
+#include "vefp_mapped_file.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vefp {
+
+	// Trajectory files store the position and velocity of every body per simulation step. Layout:
+	//   Header
+	//   Block... each starting with a BlockHeader, followed by its encoded frames
+	//   IndexEntry[blockCount]
+	//   Footer
+	// Values are quantized to integers, clamped to MAX_QUANTIZED steps so the difference of any two
+	// fits 32 bits, and every frame is stored as the difference to the previous one. The first frame
+	// of a block is relative to zero, so blocks decode on their own and a seek never has to decode
+	// more than one block. Deltas are written as zigzag varints, runs of zero deltas (bodies at rest,
+	// or one axis not moving) collapse to two bytes.
+	namespace trajectory {
+
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t VALUES_PER_BODY = 4;  // position x, y, velocity x, y
+		static constexpr int32_t MAX_QUANTIZED = (1 << 30) - 1;
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t bodyCount;
+			uint32_t framesPerBlock;
+			float timeStep;
+			float positionStep;
+			float velocityStep;
+		};
+
+		struct BlockHeader {
+			uint32_t firstFrame;
+			uint32_t frameCount;
+			uint32_t byteSize;
+			uint32_t reserved;
+		};
+
+		struct IndexEntry {
+			uint64_t offset;  // of the BlockHeader
+			uint32_t firstFrame;
+			uint32_t frameCount;
+		};
+
+		struct Footer {
+			uint64_t indexOffset;
+			uint32_t blockCount;
+			uint32_t frameCount;
+			char magic[8];
+		};
+
+	}
+
+	// Streams body states to a trajectory file. record() only quantizes and stores deltas in the
+	// block being filled, encoding and writing happen on a background thread. Full blocks go through
+	// a bounded queue; when the writer falls behind that far the block is dropped instead of
+	// stalling the simulation, which leaves a gap in the file but no corruption. Once writing to the
+	// file failed nothing more is written and record() and finish() throw.
+	class VefpTrajectoryRecorder {
+	public:
+		struct Settings {
+			uint32_t framesPerBlock = 64;
+			// quantization steps in world units and world units per second, values are clamped to
+			// MAX_QUANTIZED steps, about 10000 world units at the default position step
+			float positionStep = 1e-5f;
+			float velocityStep = 1e-4f;
+			// blocks waiting for the writer before new ones are dropped
+			uint32_t maxQueuedBlocks = 8;
+		};
+
+		VefpTrajectoryRecorder(const std::string& filepath, uint32_t bodyCount, float timeStep);
+		VefpTrajectoryRecorder(const std::string& filepath, uint32_t bodyCount, float timeStep, const Settings& settings);
+		// finishes the file if finish() was not called, failures can then only be logged
+		~VefpTrajectoryRecorder();
+
+		VefpTrajectoryRecorder(const VefpTrajectoryRecorder&) = delete;
+		VefpTrajectoryRecorder& operator=(const VefpTrajectoryRecorder&) = delete;
+
+		void record(std::span<const glm::vec2> positions, std::span<const glm::vec2> velocities);
+		// writes the last partial block and the frame index, nothing can be recorded afterwards
+		void finish();
+
+		uint32_t getRecordedFrames() const { return frameCount; }
+		uint32_t getDroppedFrames() const { return droppedFrames; }
+
+	private:
+		struct Block {
+			uint32_t firstFrame = 0;
+			uint32_t frameCount = 0;
+			std::vector<int32_t> deltas;
+		};
+
+		void writerLoop();
+		void writeBlock(const Block& block);
+		// hands the filled block to the writer and returns the next one to fill
+		Block* submitBlock(Block* block);
+
+		const uint32_t bodyCount;
+		const Settings settings;
+		std::ofstream out;
+
+		std::vector<std::unique_ptr<Block>> blocks;
+		Block* currentBlock = nullptr;
+		std::vector<int32_t> previousValues;
+		std::vector<int32_t> values;
+		uint32_t frameCount = 0;
+		uint32_t droppedFrames = 0;
+		bool finished = false;
+
+		// shared with the writer thread
+		std::mutex mutex;
+		std::condition_variable blockQueued;
+		std::deque<Block*> queuedBlocks;
+		std::vector<Block*> freeBlocks;
+		bool stopping = false;
+		std::atomic<bool> writeFailed{ false };
+
+		// only touched by the writer thread until it has been joined
+		std::vector<uint8_t> encoded;
+		std::vector<trajectory::IndexEntry> index;
+
+		std::thread writer;
+	};
+
+	// Reads a trajectory file through a memory mapping. Sequential reads decode one frame at a time,
+	// any other frame is reached by looking up its block in the frame index and decoding from the
+	// start of that block. Files without an index (recording was interrupted) are indexed by
+	// scanning the blocks.
+	class VefpTrajectoryReader {
+	public:
+		explicit VefpTrajectoryReader(const std::string& filepath);
+
+		VefpTrajectoryReader(const VefpTrajectoryReader&) = delete;
+		VefpTrajectoryReader& operator=(const VefpTrajectoryReader&) = delete;
+
+		uint32_t bodyCount() const { return header.bodyCount; }
+		uint32_t frameCount() const { return frames; }
+		float timeStep() const { return header.timeStep; }
+
+		// Frames lost to dropped blocks read as the closest earlier frame. The spans have to hold
+		// bodyCount() elements.
+		void readFrame(uint32_t frame, std::span<glm::vec2> positions, std::span<glm::vec2> velocities);
+
+	private:
+		void buildIndex();
+		void beginBlock(size_t block);
+		void decodeNextFrame();
+		int32_t nextDelta();
+
+		VefpMappedFile file;
+		trajectory::Header header{};
+		std::vector<trajectory::IndexEntry> index;
+		uint32_t frames = 0;
+
+		// decoder position
+		size_t currentBlock = SIZE_MAX;
+		uint32_t decodedFrames = 0;  // of the current block
+		const uint8_t* cursor = nullptr;
+		const uint8_t* blockEnd = nullptr;
+		uint32_t pendingZeros = 0;
+		std::vector<int32_t> values;
+	};
+
+}
@@ -0,0 +1,38 @@
+#include "vefp_transient_buffer.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace vefp {
+
+	VefpTransientBuffer::VefpTransientBuffer(VefpDevice& device, VkDeviceSize size, VkBufferUsageFlags usage)
+		: vefpDevice{ device }, bufferSize{ size } {
+		vefpDevice.createBuffer(
+			bufferSize,
+			usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			buffer,
+			bufferMemory);
+
+		void* data;
+		vkMapMemory(vefpDevice.device(), bufferMemory, 0, bufferSize, 0, &data);
+		mapped = static_cast<char*>(data);
+	}
+
+	VefpTransientBuffer::~VefpTransientBuffer() {
+		vkUnmapMemory(vefpDevice.device(), bufferMemory);
+		vkDestroyBuffer(vefpDevice.device(), buffer, nullptr);
+		vkFreeMemory(vefpDevice.device(), bufferMemory, nullptr);
+	}
+
+	VefpTransientBuffer::Allocation VefpTransientBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+		VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+		if (offset + size > bufferSize) {
+			throw std::runtime_error("transient buffer is out of space for this frame!");
+		}
+		head = offset + size;
+		return { buffer, offset, mapped + offset };
+	}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vefp_device.hpp"
+
+namespace vefp {
+
+	// Persistently mapped host visible buffer that hands out aligned slices and is rewound once per
+	// frame. Keep one per frame in flight in a VefpFrameRing so the cpu never overwrites data the gpu
+	// may still be reading.
+	class VefpTransientBuffer {
+	public:
+		struct Allocation {
+			VkBuffer buffer;
+			VkDeviceSize offset;
+			void* mapped;
+		};
+
+		VefpTransientBuffer(VefpDevice& device, VkDeviceSize size, VkBufferUsageFlags usage);
+		~VefpTransientBuffer();
+
+		VefpTransientBuffer(const VefpTransientBuffer&) = delete;
+		VefpTransientBuffer& operator=(const VefpTransientBuffer&) = delete;
+
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+		void reset() { head = 0; }
+
+		VkBuffer getBuffer() const { return buffer; }
+		VkDeviceSize capacity() const { return bufferSize; }
+		VkDeviceSize used() const { return head; }
+
+	private:
+		VefpDevice& vefpDevice;
+		VkBuffer buffer;
+		VkDeviceMemory bufferMemory;
+		VkDeviceSize bufferSize;
+		VkDeviceSize head = 0;
+		char* mapped = nullptr;
+	};
+
+}
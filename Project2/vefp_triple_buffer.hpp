@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vefp {
+
+	// Hands values from one writer thread to one reader thread without either waiting on the other.
+	// Of the three slots the writer owns one, the reader owns one and the third holds the latest
+	// published value. Publishing swaps the writer's slot with the middle one, the reader swaps its
+	// slot with the middle one when something new was published since its last acquire. Values the
+	// reader did not get to in time are overwritten, it always sees the newest one.
+	template<typename T>
+	class VefpTripleBuffer {
+	public:
+		VefpTripleBuffer() = default;
+		// every slot starts as a copy, so slots holding vectors keep their size when reused
+		explicit VefpTripleBuffer(const T& initial) : slots{ initial, initial, initial } {}
+
+		VefpTripleBuffer(const VefpTripleBuffer&) = delete;
+		VefpTripleBuffer& operator=(const VefpTripleBuffer&) = delete;
+
+		// writer side. The slot holds an older value, not necessarily the last one written.
+		T& writeSlot() { return slots[writeIndex]; }
+		void publish() {
+			writeIndex = middle.exchange(writeIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		// reader side, whether the next acquire gets a new value
+		bool hasNew() const { return (middle.load(std::memory_order_relaxed) & FRESH_BIT) != 0; }
+		// reader side, false leaves the slot from the previous acquire in place
+		bool acquire() {
+			if ((middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+				return false;
+			}
+			readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		}
+		const T& readSlot() const { return slots[readIndex]; }
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 0x3;
+		static constexpr uint8_t FRESH_BIT = 0x4;
+
+		std::array<T, 3> slots{};
+		// index of the middle slot, with FRESH_BIT set while the reader has not taken it
+		alignas(64) std::atomic<uint8_t> middle{ 1 };
+		// each side's index on its own cache line so they do not bounce between the threads
+		alignas(64) uint8_t writeIndex = 0;
+		alignas(64) uint8_t readIndex = 2;
+	};
+
+}
@@ -0,0 +1,343 @@
+#include "vefp_upload_service.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace vefp {
+
+	// satisfies bufferOffset alignment of buffer to image copies for every color format
+	static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	VefpUploadService::VefpUploadService(VefpDevice& device, VkDeviceSize stagingSize)
+		: vefpDevice{ device }, timeline{ device }, stagingSize{ stagingSize } {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = vefpDevice.transferQueueFamily();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(vefpDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+	}
+
+	VefpUploadService::~VefpUploadService() {
+		timeline.wait(timeline.lastSubmittedValue());
+
+		if (recording) {
+			destroyStaging(recordingBatch);
+		}
+		for (auto& batch : submittedBatches) {
+			destroyStaging(batch);
+		}
+		for (auto& batch : freeBatches) {
+			destroyStaging(batch);
+		}
+		// frees the batch command buffers as well
+		vkDestroyCommandPool(vefpDevice.device(), commandPool, nullptr);
+	}
+
+	void VefpUploadService::uploadBuffer(
+		VkBuffer dstBuffer,
+		VkDeviceSize dstOffset,
+		const void* data,
+		VkDeviceSize size,
+		VkPipelineStageFlags dstStage,
+		VkAccessFlags dstAccess) {
+		Batch& batch = beginBatch(size);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = stage(batch, data, size);
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(batch.commandBuffer, batch.stagingBuffer, dstBuffer, 1, &copyRegion);
+
+		recordedBuffers.push_back({ dstBuffer, dstOffset, size, dstAccess });
+		recordedStages |= dstStage;
+	}
+
+	void VefpUploadService::uploadImage(
+		VkImage dstImage,
+		VkExtent2D extent,
+		uint32_t layerCount,
+		const void* data,
+		VkDeviceSize size,
+		VkImageLayout finalLayout,
+		VkPipelineStageFlags dstStage,
+		VkAccessFlags dstAccess) {
+		Batch& batch = beginBatch(size);
+
+		VkImageMemoryBarrier toTransferDst{};
+		toTransferDst.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		toTransferDst.srcAccessMask = 0;
+		toTransferDst.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toTransferDst.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		toTransferDst.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toTransferDst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransferDst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransferDst.image = dstImage;
+		toTransferDst.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount };
+		vkCmdPipelineBarrier(
+			batch.commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			1,
+			&toTransferDst);
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = stage(batch, data, size);
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, layerCount };
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { extent.width, extent.height, 1 };
+		vkCmdCopyBufferToImage(
+			batch.commandBuffer,
+			batch.stagingBuffer,
+			dstImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&region);
+
+		recordedImages.push_back({ dstImage, layerCount, finalLayout, dstAccess });
+		recordedStages |= dstStage;
+	}
+
+	uint64_t VefpUploadService::flush() {
+		if (!recording) {
+			return timeline.lastSubmittedValue();
+		}
+
+		recordReleaseBarriers(recordingBatch.commandBuffer);
+		if (vkEndCommandBuffer(recordingBatch.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer!");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recordingBatch.commandBuffer;
+		recordingBatch.timelineValue = timeline.submit(vefpDevice.transferQueue(), submitInfo);
+
+		submittedBatches.push_back(recordingBatch);
+		recordingBatch = {};
+		recording = false;
+
+		releasedBuffers.insert(releasedBuffers.end(), recordedBuffers.begin(), recordedBuffers.end());
+		releasedImages.insert(releasedImages.end(), recordedImages.begin(), recordedImages.end());
+		releasedStages |= recordedStages;
+		releasedValue = timeline.lastSubmittedValue();
+		recordedBuffers.clear();
+		recordedImages.clear();
+		recordedStages = 0;
+
+		return releasedValue;
+	}
+
+	VefpTimeline::Wait VefpUploadService::acquireUploads(VkCommandBuffer commandBuffer) {
+		flush();
+		if (releasedValue == 0) {
+			return { &timeline, 0, 0 };
+		}
+
+		// the acquire executes after the semaphore wait because both use the consuming stages
+		if (needsOwnershipTransfer()) {
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			bufferBarriers.reserve(releasedBuffers.size());
+			for (auto& transfer : releasedBuffers) {
+				VkBufferMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = transfer.dstAccess;
+				barrier.srcQueueFamilyIndex = vefpDevice.transferQueueFamily();
+				barrier.dstQueueFamilyIndex = vefpDevice.graphicsQueueFamily();
+				barrier.buffer = transfer.buffer;
+				barrier.offset = transfer.offset;
+				barrier.size = transfer.size;
+				bufferBarriers.push_back(barrier);
+			}
+
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			imageBarriers.reserve(releasedImages.size());
+			for (auto& transfer : releasedImages) {
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = transfer.dstAccess;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = transfer.finalLayout;
+				barrier.srcQueueFamilyIndex = vefpDevice.transferQueueFamily();
+				barrier.dstQueueFamilyIndex = vefpDevice.graphicsQueueFamily();
+				barrier.image = transfer.image;
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, transfer.layerCount };
+				imageBarriers.push_back(barrier);
+			}
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				releasedStages,
+				releasedStages,
+				0,
+				0,
+				nullptr,
+				static_cast<uint32_t>(bufferBarriers.size()),
+				bufferBarriers.data(),
+				static_cast<uint32_t>(imageBarriers.size()),
+				imageBarriers.data());
+		}
+
+		VefpTimeline::Wait wait{ &timeline, releasedValue, releasedStages };
+		releasedBuffers.clear();
+		releasedImages.clear();
+		releasedStages = 0;
+		releasedValue = 0;
+		return wait;
+	}
+
+	void VefpUploadService::waitIdle() {
+		timeline.wait(flush());
+	}
+
+	VefpUploadService::Batch& VefpUploadService::beginBatch(VkDeviceSize size) {
+		VkDeviceSize alignedSize = size + STAGING_ALIGNMENT;
+		if (recording && recordingBatch.head + alignedSize <= recordingBatch.capacity) {
+			return recordingBatch;
+		}
+		flush();
+
+		// staging of batches the transfer queue has finished can be reused
+		while (!submittedBatches.empty() && timeline.isComplete(submittedBatches.front().timelineValue)) {
+			submittedBatches.front().head = 0;
+			freeBatches.push_back(submittedBatches.front());
+			submittedBatches.pop_front();
+		}
+
+		if (!freeBatches.empty()) {
+			recordingBatch = freeBatches.back();
+			freeBatches.pop_back();
+		}
+		else {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(vefpDevice.device(), &allocInfo, &recordingBatch.commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate upload command buffer!");
+			}
+		}
+
+		// uploads larger than the staging size get a batch of their own
+		if (recordingBatch.capacity < alignedSize) {
+			destroyStaging(recordingBatch);
+			createStaging(recordingBatch, std::max(stagingSize, alignedSize));
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(recordingBatch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording upload command buffer!");
+		}
+
+		recording = true;
+		return recordingBatch;
+	}
+
+	VkDeviceSize VefpUploadService::stage(Batch& batch, const void* data, VkDeviceSize size) {
+		VkDeviceSize offset = (batch.head + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		assert(offset + size <= batch.capacity && "Upload does not fit into the staging buffer");
+		memcpy(batch.mapped + offset, data, static_cast<size_t>(size));
+		batch.head = offset + size;
+		return offset;
+	}
+
+	void VefpUploadService::createStaging(Batch& batch, VkDeviceSize size) {
+		vefpDevice.createBuffer(
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			batch.stagingBuffer,
+			batch.stagingMemory);
+
+		void* data;
+		vkMapMemory(vefpDevice.device(), batch.stagingMemory, 0, size, 0, &data);
+		batch.mapped = static_cast<char*>(data);
+		batch.capacity = size;
+		batch.head = 0;
+	}
+
+	void VefpUploadService::destroyStaging(Batch& batch) {
+		if (batch.stagingBuffer == VK_NULL_HANDLE) {
+			return;
+		}
+		vkUnmapMemory(vefpDevice.device(), batch.stagingMemory);
+		vkDestroyBuffer(vefpDevice.device(), batch.stagingBuffer, nullptr);
+		vkFreeMemory(vefpDevice.device(), batch.stagingMemory, nullptr);
+		batch.stagingBuffer = VK_NULL_HANDLE;
+		batch.stagingMemory = VK_NULL_HANDLE;
+		batch.mapped = nullptr;
+		batch.capacity = 0;
+	}
+
+	void VefpUploadService::recordReleaseBarriers(VkCommandBuffer commandBuffer) {
+		// without a dedicated family the barriers only make the copies available and move images to
+		// their final layout, the semaphore wait of the consuming submit does the rest
+		uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+		uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+		if (needsOwnershipTransfer()) {
+			srcFamily = vefpDevice.transferQueueFamily();
+			dstFamily = vefpDevice.graphicsQueueFamily();
+		}
+
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		bufferBarriers.reserve(recordedBuffers.size());
+		for (auto& transfer : recordedBuffers) {
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+			barrier.buffer = transfer.buffer;
+			barrier.offset = transfer.offset;
+			barrier.size = transfer.size;
+			bufferBarriers.push_back(barrier);
+		}
+
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		imageBarriers.reserve(recordedImages.size());
+		for (auto& transfer : recordedImages) {
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = transfer.finalLayout;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+			barrier.image = transfer.image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, transfer.layerCount };
+			imageBarriers.push_back(barrier);
+		}
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()),
+			bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()),
+			imageBarriers.data());
+	}
+
+}
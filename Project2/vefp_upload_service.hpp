@@ -0,0 +1,111 @@
+#pragma once
+
+#include "vefp_device.hpp"
+#include "vefp_timeline.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace vefp {
+
+	// Batches buffer and image uploads and runs them on the device's transfer queue, so loading data
+	// overlaps rendering instead of idling the graphics queue like VefpDevice::copyBuffer does.
+	// With a dedicated transfer family the copied resources are released by the transfer queue and
+	// have to be acquired on the graphics queue through acquireUploads before they are used.
+	// Targets must use VK_SHARING_MODE_EXCLUSIVE and are expected to be written in full, contents
+	// outside of the copied ranges are not preserved by the ownership transfer.
+	class VefpUploadService {
+	public:
+		static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 4 * 1024 * 1024;
+
+		VefpUploadService(VefpDevice& device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+		~VefpUploadService();
+
+		VefpUploadService(const VefpUploadService&) = delete;
+		VefpUploadService& operator=(const VefpUploadService&) = delete;
+
+		// data is copied to staging memory right away, the gpu copy is submitted by the next flush
+		void uploadBuffer(
+			VkBuffer dstBuffer,
+			VkDeviceSize dstOffset,
+			const void* data,
+			VkDeviceSize size,
+			VkPipelineStageFlags dstStage,
+			VkAccessFlags dstAccess);
+		// fills mip 0 of a color image and leaves it in finalLayout
+		void uploadImage(
+			VkImage dstImage,
+			VkExtent2D extent,
+			uint32_t layerCount,
+			const void* data,
+			VkDeviceSize size,
+			VkImageLayout finalLayout,
+			VkPipelineStageFlags dstStage,
+			VkAccessFlags dstAccess);
+
+		// submits the recorded copies on the transfer queue and returns their timeline value
+		uint64_t flush();
+		// Records the graphics queue half of the ownership transfers for everything uploaded so far
+		// into commandBuffer and returns the wait the submit of commandBuffer needs.
+		VefpTimeline::Wait acquireUploads(VkCommandBuffer commandBuffer);
+		// flushes and blocks until the copies are done, uploads still have to be acquired
+		void waitIdle();
+
+		VefpTimeline& getTimeline() { return timeline; }
+
+	private:
+		struct BufferTransfer {
+			VkBuffer buffer;
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			VkAccessFlags dstAccess;
+		};
+
+		struct ImageTransfer {
+			VkImage image;
+			uint32_t layerCount;
+			VkImageLayout finalLayout;
+			VkAccessFlags dstAccess;
+		};
+
+		struct Batch {
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkBuffer stagingBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+			char* mapped = nullptr;
+			VkDeviceSize capacity = 0;
+			VkDeviceSize head = 0;
+			uint64_t timelineValue = 0;
+		};
+
+		// returns the batch being recorded with room for size more staging bytes
+		Batch& beginBatch(VkDeviceSize size);
+		VkDeviceSize stage(Batch& batch, const void* data, VkDeviceSize size);
+		void createStaging(Batch& batch, VkDeviceSize size);
+		void destroyStaging(Batch& batch);
+		void recordReleaseBarriers(VkCommandBuffer commandBuffer);
+		bool needsOwnershipTransfer() const { return vefpDevice.hasDedicatedTransferQueue(); }
+
+		VefpDevice& vefpDevice;
+		VefpTimeline timeline;
+		VkCommandPool commandPool;
+		const VkDeviceSize stagingSize;
+
+		bool recording = false;
+		Batch recordingBatch{};
+		std::deque<Batch> submittedBatches;
+		std::vector<Batch> freeBatches;
+
+		// written by the batch being recorded, released when it is flushed
+		std::vector<BufferTransfer> recordedBuffers;
+		std::vector<ImageTransfer> recordedImages;
+		VkPipelineStageFlags recordedStages = 0;
+
+		// flushed but not yet acquired by the graphics queue
+		std::vector<BufferTransfer> releasedBuffers;
+		std::vector<ImageTransfer> releasedImages;
+		VkPipelineStageFlags releasedStages = 0;
+		uint64_t releasedValue = 0;
+	};
+
+}
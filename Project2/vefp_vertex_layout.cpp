@@ -0,0 +1,54 @@
+#include "vefp_vertex_layout.hpp"
+
+namespace vefp {
+
+	std::vector<VkVertexInputBindingDescription> VefpVertexLayout::getBindingDescriptions() const {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = stride();
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VefpVertexLayout::getAttributeDescriptions() const {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+		VkVertexInputAttributeDescription positionAttribute{};
+		positionAttribute.binding = 0;
+		positionAttribute.location = 0;
+		positionAttribute.format = position == PositionFormat::Float32 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R16G16_SNORM;
+		positionAttribute.offset = 0;
+		attributeDescriptions.push_back(positionAttribute);
+
+		if (color) {
+			VkVertexInputAttributeDescription colorAttribute{};
+			colorAttribute.binding = 0;
+			colorAttribute.location = 1;
+			colorAttribute.format = VK_FORMAT_R8G8B8A8_UNORM;
+			colorAttribute.offset = colorOffset();
+			attributeDescriptions.push_back(colorAttribute);
+		}
+
+		if (uv) {
+			VkVertexInputAttributeDescription uvAttribute{};
+			uvAttribute.binding = 0;
+			uvAttribute.location = 2;
+			uvAttribute.format = VK_FORMAT_R16G16_SFLOAT;
+			uvAttribute.offset = uvOffset();
+			attributeDescriptions.push_back(uvAttribute);
+		}
+		return attributeDescriptions;
+	}
+
+	std::string VefpVertexLayout::shaderSuffix() const {
+		std::string suffix;
+		if (color) {
+			suffix += "_color";
+		}
+		if (uv) {
+			suffix += "_uv";
+		}
+		return suffix;
+	}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vefp_device.hpp"
+
+#include <string>
+#include <vector>
+
+namespace vefp {
+
+	// Which attributes a model stores per vertex and how. Attribute locations are fixed (0 position,
+	// 1 color, 2 uv) whether an attribute is present or not, so shader variants only differ in the
+	// inputs they declare.
+	struct VefpVertexLayout {
+		enum class PositionFormat : uint32_t {
+			Float32,  // R32G32_SFLOAT, 8 bytes
+			Snorm16,  // R16G16_SNORM, 4 bytes, scaled by VefpModel::getPositionScale()
+		};
+
+		PositionFormat position = PositionFormat::Float32;
+		bool color = false;  // R8G8B8A8_UNORM, modulates the push constant color
+		bool uv = false;     // R16G16_SFLOAT
+
+		uint32_t positionSize() const { return position == PositionFormat::Float32 ? 8 : 4; }
+		uint32_t colorOffset() const { return positionSize(); }
+		uint32_t uvOffset() const { return colorOffset() + (color ? 4 : 0); }
+		uint32_t stride() const { return uvOffset() + (uv ? 4 : 0); }
+
+		std::vector<VkVertexInputBindingDescription> getBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
+
+		// "", "_color", "_uv" or "_color_uv", appended to shader names to pick the matching variant
+		std::string shaderSuffix() const;
+
+		bool operator==(const VefpVertexLayout&) const = default;
+	};
+
+}
@@ -28,6 +28,15 @@ namespace vefp {
 		}
 	}
 
+	void VefpWindow::setTitleSuffix(std::string_view suffix) {
+		title = windowName;
+		if (!suffix.empty()) {
+			title += " | ";
+			title += suffix;
+		}
+		glfwSetWindowTitle(window, title.c_str());
+	}
+
 	void VefpWindow::frameBufferResizeCallback(GLFWwindow* window, int width, int height) {
 		auto vefpWindow = reinterpret_cast<VefpWindow*>(glfwGetWindowUserPointer(window));
 		vefpWindow->frameBufferResized = true;
@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 
 #include <string>
+#include <string_view>
 
 namespace vefp {
 	class VefpWindow {
@@ -16,6 +17,8 @@ namespace vefp {
 		bool frameBufferResized = false;
 
 		std::string windowName;
+		// kept so updating the title every frame reuses its storage
+		std::string title;
 		GLFWwindow* window;
 	 public:
 		VefpWindow(int w, int h, std::string name);
@@ -27,7 +30,10 @@ namespace vefp {
 		bool shouldClose() { return glfwWindowShouldClose(window); }
 		VkExtent2D getExtend() { return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) }; }
 		bool wasWindowResized() { return frameBufferResized; }
+		bool isMinimized() { return width == 0 || height == 0; }
 		void resetWindowResizedFlag() { frameBufferResized = false; }
+		GLFWwindow* getGLFWwindow() const { return window; }
+		void setTitleSuffix(std::string_view suffix);
 
 		void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 	};